@@ -80,6 +80,74 @@ static struct
 	}				prev;
 }					demo_rewind;
 
+// Demo seeking: a full snapshot of the client state every few seconds of
+// demo time, so demoseek only has to replay the messages after the nearest
+// one.  The index only covers the current level, map changes reset it.
+#define DEMO_KEYFRAME_INTERVAL	10.0
+#define DEMO_MAX_KEYFRAMES		128		// then every other one is dropped
+
+// Only the entities of the last message are kept, every other one gets its
+// model cleared by CL_RelinkEntities anyway, and the next update rebuilds it
+// from the baseline.  Baselines don't change after the signon.
+typedef struct
+{
+	int				num;
+	vec3_t			msg_origins[2];
+	vec3_t			msg_angles[2];
+	struct qmodel_s	*model;
+	byte			*colormap;
+	float			syncbase;
+	float			lerpfinish;
+	int				frame;
+	int				skinnum;
+	int				effects;
+	byte			alpha;
+	byte			scale;
+	byte			lerpflags;
+} demoentity_t;
+
+typedef struct
+{
+	char			name[MAX_SCOREBOARDNAME];
+	float			entertime;
+	int				frags;
+	int				colors;
+} demoscore_t;
+
+typedef struct
+{
+	long			fileofs;		// of the first message to replay
+	double			mtime[2];
+	double			time;
+	vec3_t			mviewangles[2];
+	vec3_t			mvelocity[2];
+	vec3_t			punchangle;
+	int				stats[MAX_CL_STATS];
+	float			statsf[MAX_CL_STATS];
+	int				items;
+	float			item_gettime[32];
+	float			faceanimtime;
+	cshift_t		cshifts[NUM_CSHIFTS];
+	cshift_t		cshift_empty;
+	float			idealpitch;
+	float			viewheight;
+	qboolean		paused;
+	qboolean		onground;
+	qboolean		inwater;
+	int				intermission;
+	int				completed_time;
+	qboolean		forceunderwater;
+	int				deltaack;
+	int				num_entities;
+	demoentity_t	*entities;		// [num_entities]
+	demoscore_t		*scores;		// [cl.maxclients]
+	deltaframe_t	*deltaframes;	// [DELTA_BACKUP], NULL without PRFL_DELTAFRAMES
+	lightstyle_t	lightstyles[MAX_LIGHTSTYLES];
+} demokeyframe_t;
+
+static demokeyframe_t	*demo_keyframes;
+static double			demo_keyinterval = DEMO_KEYFRAME_INTERVAL;	// grows as the index is thinned out
+
 /*
 ==============
 CL_ClearSignons
@@ -92,6 +160,61 @@ void CL_ClearSignons (void)
 	cls.signon = 0;
 }
 
+/*
+==============
+CL_FreeDemoKeyframe
+==============
+*/
+static void CL_FreeDemoKeyframe (demokeyframe_t *key)
+{
+	int		i;
+
+	free (key->entities);
+	free (key->scores);
+	if (key->deltaframes)
+	{
+		for (i = 0; i < DELTA_BACKUP; i++)
+			Delta_FreeFrame (&key->deltaframes[i]);
+		free (key->deltaframes);
+	}
+}
+
+/*
+==============
+CL_ClearDemoKeyframes
+==============
+*/
+static void CL_ClearDemoKeyframes (void)
+{
+	size_t	i;
+
+	for (i = 0; i < VEC_SIZE (demo_keyframes); i++)
+		CL_FreeDemoKeyframe (&demo_keyframes[i]);
+	VEC_CLEAR (demo_keyframes);
+	demo_keyinterval = DEMO_KEYFRAME_INTERVAL;
+}
+
+/*
+==============
+CL_ThinDemoKeyframes
+
+Keeps the memory used by long levels bounded: drops every other keyframe
+and doubles the interval for the following ones
+==============
+*/
+static void CL_ThinDemoKeyframes (void)
+{
+	size_t	i, count;
+
+	count = VEC_SIZE (demo_keyframes);
+	for (i = 1; i < count; i += 2)
+		CL_FreeDemoKeyframe (&demo_keyframes[i]);
+	for (i = 2; i < count; i += 2)
+		demo_keyframes[i / 2] = demo_keyframes[i];
+	VEC_POP_N (demo_keyframes, count / 2);
+	demo_keyinterval *= 2.0;
+}
+
 /*
 ==============
 CL_StopPlayback
@@ -119,6 +242,8 @@ void CL_StopPlayback (void)
 	VEC_CLEAR (demo_rewind.pending_sounds);
 	demo_rewind.backstop = false;
 
+	CL_ClearDemoKeyframes ();
+
 	if (cls.timedemo)
 		CL_FinishTimeDemo ();
 }
@@ -232,6 +357,196 @@ void CL_AdvanceTime (void)
 }
 
 
+/*
+====================
+CL_AddDemoKeyframe
+
+Snapshots the client state before the message at fileofs is read
+====================
+*/
+static void CL_AddDemoKeyframe (long fileofs)
+{
+	demokeyframe_t	key;
+	demoentity_t	*dst;
+	int				i;
+
+	if (VEC_SIZE (demo_keyframes) >= DEMO_MAX_KEYFRAMES)
+		CL_ThinDemoKeyframes ();
+
+	memset (&key, 0, sizeof (key));
+	key.fileofs = fileofs;
+	key.mtime[0] = cl.mtime[0];
+	key.mtime[1] = cl.mtime[1];
+	key.time = cl.time;
+	VectorCopy (cl.mviewangles[0], key.mviewangles[0]);
+	VectorCopy (cl.mviewangles[1], key.mviewangles[1]);
+	VectorCopy (cl.mvelocity[0], key.mvelocity[0]);
+	VectorCopy (cl.mvelocity[1], key.mvelocity[1]);
+	VectorCopy (cl.punchangle, key.punchangle);
+	memcpy (key.stats, cl.stats, sizeof (key.stats));
+	memcpy (key.statsf, cl.statsf, sizeof (key.statsf));
+	key.items = cl.items;
+	memcpy (key.item_gettime, cl.item_gettime, sizeof (key.item_gettime));
+	key.faceanimtime = cl.faceanimtime;
+	memcpy (key.cshifts, cl.cshifts, sizeof (key.cshifts));
+	key.cshift_empty = cshift_empty;
+	key.idealpitch = cl.idealpitch;
+	key.viewheight = cl.viewheight;
+	key.paused = cl.paused;
+	key.onground = cl.onground;
+	key.inwater = cl.inwater;
+	key.intermission = cl.intermission;
+	key.completed_time = cl.completed_time;
+	key.forceunderwater = cl.forceunderwater;
+	key.deltaack = cl.deltaack;
+	memcpy (key.lightstyles, cl_lightstyle, sizeof (key.lightstyles));
+
+	for (i = 1; i < cl.num_entities; i++)
+		if (cl_entities[i].msgtime == cl.mtime[0])
+			key.num_entities++;
+	key.entities = (demoentity_t *) malloc (q_max (key.num_entities, 1) * sizeof (demoentity_t));
+	key.scores = (demoscore_t *) malloc (q_max (cl.maxclients, 1) * sizeof (demoscore_t));
+	if (!key.entities || !key.scores)
+		Sys_Error ("CL_AddDemoKeyframe: out of memory");
+	for (i = 1, dst = key.entities; i < cl.num_entities; i++)
+	{
+		const entity_t *ent = &cl_entities[i];
+
+		if (ent->msgtime != cl.mtime[0])
+			continue;
+		dst->num = i;
+		VectorCopy (ent->msg_origins[0], dst->msg_origins[0]);
+		VectorCopy (ent->msg_origins[1], dst->msg_origins[1]);
+		VectorCopy (ent->msg_angles[0], dst->msg_angles[0]);
+		VectorCopy (ent->msg_angles[1], dst->msg_angles[1]);
+		dst->model = ent->model;
+		dst->colormap = ent->colormap;
+		dst->syncbase = ent->syncbase;
+		dst->lerpfinish = ent->lerpfinish;
+		dst->frame = ent->frame;
+		dst->skinnum = ent->skinnum;
+		dst->effects = ent->effects;
+		dst->alpha = ent->alpha;
+		dst->scale = ent->scale;
+		dst->lerpflags = ent->lerpflags;
+		dst++;
+	}
+	for (i = 0; i < cl.maxclients; i++)
+	{
+		q_strlcpy (key.scores[i].name, cl.scores[i].name, MAX_SCOREBOARDNAME);
+		key.scores[i].entertime = cl.scores[i].entertime;
+		key.scores[i].frags = cl.scores[i].frags;
+		key.scores[i].colors = cl.scores[i].colors;
+	}
+
+	if (cl.protocolflags & PRFL_DELTAFRAMES)
+	{
+		key.deltaframes = (deltaframe_t *) calloc (DELTA_BACKUP, sizeof (deltaframe_t));
+		if (!key.deltaframes)
+			Sys_Error ("CL_AddDemoKeyframe: out of memory");
+		CL_SaveDeltaFrames (key.deltaframes);
+	}
+
+	VEC_PUSH (demo_keyframes, key);
+}
+
+/*
+====================
+CL_RestoreDemoKeyframe
+====================
+*/
+static void CL_RestoreDemoKeyframe (const demokeyframe_t *key)
+{
+	const demoentity_t	*src;
+	int					i;
+
+	fseek (cls.demofile, key->fileofs, SEEK_SET);
+
+	cl.mtime[0] = key->mtime[0];
+	cl.mtime[1] = key->mtime[1];
+	cl.time = cl.oldtime = key->time;
+	VectorCopy (key->mviewangles[0], cl.mviewangles[0]);
+	VectorCopy (key->mviewangles[1], cl.mviewangles[1]);
+	VectorCopy (key->mvelocity[0], cl.mvelocity[0]);
+	VectorCopy (key->mvelocity[1], cl.mvelocity[1]);
+	VectorCopy (key->punchangle, cl.punchangle);
+	memcpy (cl.stats, key->stats, sizeof (cl.stats));
+	memcpy (cl.statsf, key->statsf, sizeof (cl.statsf));
+	cl.items = key->items;
+	memcpy (cl.item_gettime, key->item_gettime, sizeof (cl.item_gettime));
+	cl.faceanimtime = key->faceanimtime;
+	memcpy (cl.cshifts, key->cshifts, sizeof (cl.cshifts));
+	cshift_empty = key->cshift_empty;
+	cl.idealpitch = key->idealpitch;
+	cl.viewheight = key->viewheight;
+	cl.paused = key->paused;
+	cl.onground = key->onground;
+	cl.inwater = key->inwater;
+	cl.intermission = key->intermission;
+	cl.completed_time = key->completed_time;
+	cl.forceunderwater = key->forceunderwater;
+	cl.deltaack = key->deltaack;
+	memcpy (cl_lightstyle, key->lightstyles, sizeof (cl_lightstyle));
+
+	// entities missing from the keyframe are left as CL_RelinkEntities
+	// leaves entities without an update, animation and movement lerping
+	// restart from the restored positions
+	for (i = 1, src = key->entities; i < cl.num_entities; i++)
+	{
+		entity_t *ent = &cl_entities[i];
+
+		ent->lerpflags |= LERP_RESETANIM|LERP_RESETMOVE;
+		if (src == key->entities + key->num_entities || src->num != i)
+		{
+			ent->msgtime = 0;
+			ent->model = NULL;
+			ent->forcelink = true;
+			continue;
+		}
+		ent->msgtime = key->mtime[0];
+		VectorCopy (src->msg_origins[0], ent->msg_origins[0]);
+		VectorCopy (src->msg_origins[1], ent->msg_origins[1]);
+		VectorCopy (src->msg_angles[0], ent->msg_angles[0]);
+		VectorCopy (src->msg_angles[1], ent->msg_angles[1]);
+		VectorCopy (src->msg_origins[0], ent->origin);
+		VectorCopy (src->msg_angles[0], ent->angles);
+		ent->model = src->model;
+		ent->colormap = src->colormap;
+		ent->syncbase = src->syncbase;
+		ent->lerpfinish = src->lerpfinish;
+		ent->frame = src->frame;
+		ent->skinnum = src->skinnum;
+		ent->effects = src->effects;
+		ent->alpha = src->alpha;
+		ent->scale = src->scale;
+		ent->lerpflags = src->lerpflags | LERP_RESETANIM|LERP_RESETMOVE;
+		ent->forcelink = true;
+		src++;
+	}
+
+	for (i = 0; i < cl.maxclients; i++)
+	{
+		scoreboard_t *sb = &cl.scores[i];
+
+		q_strlcpy (sb->name, key->scores[i].name, MAX_SCOREBOARDNAME);
+		sb->entertime = key->scores[i].entertime;
+		sb->frags = key->scores[i].frags;
+		if (sb->colors != key->scores[i].colors)
+		{
+			sb->colors = key->scores[i].colors;
+			CL_NewTranslation (i);
+		}
+	}
+
+	if (key->deltaframes)
+		CL_RestoreDeltaFrames (key->deltaframes);
+
+	// effects in flight don't belong to the new position
+	memset (cl_dlights, 0, sizeof (cl_dlights));
+	memset (cl_beams, 0, sizeof (cl_beams));
+	R_ClearParticles ();
+}
+
 /*
 ====================
 CL_NextDemoFrame
@@ -251,10 +566,12 @@ static qboolean CL_NextDemoFrame (void)
 		{
 			VEC_CLEAR (demo_rewind.frames);
 			VEC_CLEAR (demo_rewind.frame_events);
+			CL_ClearDemoKeyframes ();
 		}
 		else
 		{
 			demoframe_t newframe;
+			size_t		numkeys;
 
 			memset (&newframe, 0, sizeof (newframe));
 			newframe.fileofs = ftell (cls.demofile);
@@ -262,6 +579,13 @@ static qboolean CL_NextDemoFrame (void)
 			newframe.forceunderwater = cl.forceunderwater;
 			VEC_PUSH (demo_rewind.frames, newframe);
 
+			// Extend the keyframe index, unless we're replaying an indexed stretch
+			numkeys = VEC_SIZE (demo_keyframes);
+			if (!cls.timedemo && (!numkeys ||
+				(newframe.fileofs > demo_keyframes[numkeys - 1].fileofs &&
+				 cl.mtime[0] >= demo_keyframes[numkeys - 1].mtime[0] + demo_keyinterval)))
+				CL_AddDemoKeyframe (newframe.fileofs);
+
 			// Take a snapshot of the tracked data at the beginning of this frame
 			for (i = 0; i < MAX_LIGHTSTYLES; i++)
 				q_strlcpy (demo_rewind.prev.lightstyles[i], cl_lightstyle[i].map, MAX_STYLESTRING);
@@ -417,11 +741,46 @@ void CL_FinishDemoFrame (void)
 	}
 }
 
-static int CL_GetDemoMessage (void)
+/*
+====================
+CL_ReadDemoMessage
+
+Reads the next message into net_message, returns false if the demo ended
+====================
+*/
+static qboolean CL_ReadDemoMessage (void)
 {
 	int		i;
 	float	f;
 
+	if (!CL_NextDemoFrame ())
+		return false;
+
+	if (fread (&net_message.cursize, 4, 1, cls.demofile) != 1)
+		goto readerror;
+	VectorCopy (cl.mviewangles[0], cl.mviewangles[1]);
+	for (i = 0 ; i < 3 ; i++)
+	{
+		if (fread (&f, 4, 1, cls.demofile) != 1)
+			goto readerror;
+		cl.mviewangles[0][i] = LittleFloat (f);
+	}
+
+	net_message.cursize = LittleLong (net_message.cursize);
+	if (net_message.cursize > MAX_MSGLEN)
+		Sys_Error ("Demo message > MAX_MSGLEN");
+	if (fread (net_message.data, net_message.cursize, 1, cls.demofile) != 1)
+	{
+	readerror:
+		CL_StopPlayback ();
+		return false;
+	}
+
+	return true;
+}
+
+static int CL_GetDemoMessage (void)
+{
 	if (!cls.demospeed || demo_rewind.backstop)
 		return 0;
 
@@ -445,30 +804,7 @@ static int CL_GetDemoMessage (void)
 	}
 
 // get the next message
-	if (!CL_NextDemoFrame ())
-		return 0;
-
-	if (fread (&net_message.cursize, 4, 1, cls.demofile) != 1)
-		goto readerror;
-	VectorCopy (cl.mviewangles[0], cl.mviewangles[1]);
-	for (i = 0 ; i < 3 ; i++)
-	{
-		if (fread (&f, 4, 1, cls.demofile) != 1)
-			goto readerror;
-		cl.mviewangles[0][i] = LittleFloat (f);
-	}
-
-	net_message.cursize = LittleLong (net_message.cursize);
-	if (net_message.cursize > MAX_MSGLEN)
-		Sys_Error ("Demo message > MAX_MSGLEN");
-	if (fread (net_message.data, net_message.cursize, 1, cls.demofile) != 1)
-	{
-	readerror:
-		CL_StopPlayback ();
-		return 0;
-	}
-
-	return 1;
+	return CL_ReadDemoMessage ();
 }
 
 /*
@@ -547,6 +883,133 @@ void CL_Stop_f (void)
 	DemoList_Rebuild ();
 }
 
+/*
+====================
+CL_WriteDemoEntity
+
+Codes the state of entity num against its baseline, like the server does
+in a frame without a reference
+====================
+*/
+static void CL_WriteDemoEntity (sizebuf_t *msg, int num, const entity_state_t *state)
+{
+	const entity_state_t	*base = &cl_entities[num].baseline;
+	int						i, bits;
+
+	bits = 0;
+	for (i = 0; i < 3; i++)
+		if (state->origin[i] != base->origin[i])
+			bits |= U_ORIGIN1 << i;
+	if (state->angles[0] != base->angles[0])
+		bits |= U_ANGLE1;
+	if (state->angles[1] != base->angles[1])
+		bits |= U_ANGLE2;
+	if (state->angles[2] != base->angles[2])
+		bits |= U_ANGLE3;
+	if (state->colormap != base->colormap)
+		bits |= U_COLORMAP;
+	if (state->skin != base->skin)
+		bits |= U_SKIN;
+	if (state->frame != base->frame)
+		bits |= U_FRAME;
+	if (state->effects != base->effects)
+		bits |= U_EFFECTS;
+	if (state->modelindex != base->modelindex)
+		bits |= U_MODEL;
+
+	if (cl.protocol != PROTOCOL_NETQUAKE)
+	{
+		if (state->alpha != base->alpha) bits |= U_ALPHA;
+		if (state->scale != base->scale) bits |= U_SCALE;
+		if (bits & U_FRAME && state->frame & 0xFF00) bits |= U_FRAME2;
+		if (bits & U_MODEL && state->modelindex & 0xFF00) bits |= U_MODEL2;
+		if (bits >= 65536) bits |= U_EXTEND1;
+		if (bits >= 16777216) bits |= U_EXTEND2;
+	}
+
+	if (num >= 256)
+		bits |= U_LONGENTITY;
+	if (bits >= 256)
+		bits |= U_MOREBITS;
+
+	MSG_WriteByte (msg, bits | U_SIGNAL);
+	if (bits & U_MOREBITS)
+		MSG_WriteByte (msg, bits >> 8);
+	if (bits & U_EXTEND1)
+		MSG_WriteByte (msg, bits >> 16);
+	if (bits & U_EXTEND2)
+		MSG_WriteByte (msg, bits >> 24);
+
+	if (bits & U_LONGENTITY)
+		MSG_WriteShort (msg, num);
+	else
+		MSG_WriteByte (msg, num);
+
+	if (bits & U_MODEL)
+		MSG_WriteByte (msg, state->modelindex);
+	if (bits & U_FRAME)
+		MSG_WriteByte (msg, state->frame);
+	if (bits & U_COLORMAP)
+		MSG_WriteByte (msg, state->colormap);
+	if (bits & U_SKIN)
+		MSG_WriteByte (msg, state->skin);
+	if (bits & U_EFFECTS)
+		MSG_WriteByte (msg, state->effects);
+	if (bits & U_ORIGIN1)
+		MSG_WriteCoord (msg, state->origin[0], cl.protocolflags);
+	if (bits & U_ANGLE1)
+		MSG_WriteAngle (msg, state->angles[0], cl.protocolflags);
+	if (bits & U_ORIGIN2)
+		MSG_WriteCoord (msg, state->origin[1], cl.protocolflags);
+	if (bits & U_ANGLE2)
+		MSG_WriteAngle (msg, state->angles[1], cl.protocolflags);
+	if (bits & U_ORIGIN3)
+		MSG_WriteCoord (msg, state->origin[2], cl.protocolflags);
+	if (bits & U_ANGLE3)
+		MSG_WriteAngle (msg, state->angles[2], cl.protocolflags);
+
+	if (bits & U_ALPHA)
+		MSG_WriteByte (msg, state->alpha);
+	if (bits & U_SCALE)
+		MSG_WriteByte (msg, state->scale);
+	if (bits & U_FRAME2)
+		MSG_WriteByte (msg, state->frame >> 8);
+	if (bits & U_MODEL2)
+		MSG_WriteByte (msg, state->modelindex >> 8);
+}
+
+/*
+====================
+CL_WriteDemoDeltaFrames
+
+A recording client acknowledges no frames, but the datagrams already on
+their way are still relative to frames it got before the demo started.
+Those frames are written to the demo first, coded against the baselines,
+so that playback decodes the first round trip the way the client did.
+====================
+*/
+static void CL_WriteDemoDeltaFrames (void)
+{
+	const deltaframe_t	*frame;
+	int					sequence, i;
+
+	for (sequence = q_max (cl.deltaack - DELTA_BACKUP + 1, 1); sequence <= cl.deltaack; sequence++)
+	{
+		frame = CL_FindDeltaFrame (sequence);
+		if (!frame)
+			continue;
+
+		SZ_Clear (&net_message);
+		MSG_WriteByte (&net_message, svc_deltaframe);
+		MSG_WriteLong (&net_message, frame->sequence);
+		MSG_WriteLong (&net_message, 0);
+		// stop short of the end, a full update takes at most 40 bytes
+		for (i = 0; i < frame->numents && net_message.cursize + 40 <= net_message.maxsize; i++)
+			CL_WriteDemoEntity (&net_message, frame->ents[i].num, &frame->ents[i].state);
+		CL_WriteDemoMessage ();
+	}
+}
+
 /*
 ====================
 CL_Record_f
@@ -742,6 +1205,10 @@ void CL_Record_f (void)
 
 		CL_WriteDemoMessage();
 
+		// frames the next datagrams may be relative to
+		if (cl.protocolflags & PRFL_DELTAFRAMES)
+			CL_WriteDemoDeltaFrames ();
+
 		// restore net_message
 		net_message.data = data;
 		net_message.cursize = cursize;
@@ -868,3 +1335,71 @@ void CL_TimeDemo_f (void)
 	cls.td_lastframe = -1;	// get a new message this frame
 }
 
+/*
+====================
+CL_DemoSeek_f
+
+demoseek [+|-]<seconds>
+====================
+*/
+void CL_DemoSeek_f (void)
+{
+	const char		*arg;
+	double			target;
+	float			speed;
+	size_t			i;
+	demokeyframe_t	*key;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc () != 2)
+	{
+		Con_Printf ("demoseek <time> : jumps to <time> seconds of the current level, +/- seeks relative to the current time\n");
+		return;
+	}
+
+	if (!cls.demoplayback || cls.timedemo || cls.signon != SIGNONS)
+	{
+		Con_Printf ("Not playing a demo.\n");
+		return;
+	}
+
+	arg = Cmd_Argv (1);
+	target = Q_atof (*arg == '+' ? arg + 1 : arg);
+	if (*arg == '+' || *arg == '-')
+		target += cl.mtime[0];
+
+	// the newest keyframe at or before the target, or the first one
+	// if the target lies before the start of the index
+	key = NULL;
+	for (i = 0; i < VEC_SIZE (demo_keyframes) && (!key || demo_keyframes[i].mtime[0] <= target); i++)
+		key = &demo_keyframes[i];
+
+	// seeking forward from past the keyframe is cheaper without it
+	if (key && (target < cl.mtime[0] || key->mtime[0] > cl.mtime[0]))
+		CL_RestoreDemoKeyframe (key);
+
+	// the rewind history restarts here
+	VEC_CLEAR (demo_rewind.frames);
+	VEC_CLEAR (demo_rewind.frame_events);
+	VEC_CLEAR (demo_rewind.pending_sounds);
+	demo_rewind.backstop = false;
+
+	// replay the remaining messages without rendering anything
+	speed = cls.demospeed;
+	cls.demospeed = 1.f;
+	while (cls.demoplayback && cls.signon == SIGNONS && cl.mtime[0] < target)
+	{
+		if (!CL_ReadDemoMessage ())
+			break;
+		CL_ParseServerMessage ();
+	}
+	cls.demospeed = speed;
+
+	if (!cls.demoplayback)
+		return;
+
+	cl.time = cl.oldtime = CLAMP (cl.mtime[1], target, cl.mtime[0]);
+	S_StopDynamicSounds ();
+}
@@ -430,6 +430,25 @@ void CL_SendMove (const usercmd_t *cmd)
 
 		MSG_WriteByte (&buf, in_impulse);
 		in_impulse = 0;
+
+	//
+	// acknowledge the newest delta frame; demos don't get deltas against
+	// older frames so that playback can start at any message
+	//
+		if (cl.protocolflags & PRFL_DELTAFRAMES)
+		{
+			MSG_WriteByte (&buf, clc_ackframe);
+			MSG_WriteLong (&buf, cls.demorecording ? 0 : cl.deltaack);
+		}
+
+	//
+	// number the move so the server can tell which ones svc_playerstate includes
+	//
+		if (cl.protocolflags & PRFL_MOVESEQ)
+		{
+			MSG_WriteByte (&buf, clc_moveseq);
+			MSG_WriteLong (&buf, CL_PredictRecordMove (cmd, bits));
+		}
 	}
 
 //
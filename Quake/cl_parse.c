@@ -95,12 +95,20 @@ const char *svc_strings[] =
 	"svc_chat", // 53
 	"svc_levelcompleted", // 54
 	"svc_backtolobby", // 55
-	"svc_localsound" // 56
+	"svc_localsound", // 56
+	"svc_deltaframe", // 57
+	"svc_playerstate", // 58
+	"svc_deflate", // 59
+	"svc_movevars", // 60
 };
 #define NUM_SVC_STRINGS Q_COUNTOF(svc_strings)
 
 qboolean warn_about_nehahra_protocol; //johnfitz
 
+static deltaframe_t			cl_deltaframes[DELTA_BACKUP];
+static deltaframe_t			*cl_deltacur;	// frame being parsed, if the message has one
+static const deltaframe_t	*cl_deltaref;	// frame the current updates are relative to
+
 extern vec3_t	v_punchangles[2]; //johnfitz
 
 //=============================================================================
@@ -301,6 +309,15 @@ void CL_ParseServerInfo (void)
 //
 	CL_ClearState ();
 
+// the server restarts delta frame sequences for every map
+	for (i = 0; i < DELTA_BACKUP; i++)
+		cl_deltaframes[i].sequence = 0;
+	cl_deltacur = NULL;
+	cl_deltaref = NULL;
+
+// and move sequences
+	CL_ClearPrediction ();
+
 // parse protocol version number
 	i = MSG_ReadLong ();
 	//johnfitz -- support multiple protocols
@@ -313,7 +330,7 @@ void CL_ParseServerInfo (void)
 
 	if (cl.protocol == PROTOCOL_RMQ)
 	{
-		const unsigned int supportedflags = (PRFL_SHORTANGLE | PRFL_FLOATANGLE | PRFL_24BITCOORD | PRFL_FLOATCOORD | PRFL_EDICTSCALE | PRFL_INT32COORD);
+		const unsigned int supportedflags = (PRFL_SHORTANGLE | PRFL_FLOATANGLE | PRFL_24BITCOORD | PRFL_FLOATCOORD | PRFL_EDICTSCALE | PRFL_INT32COORD | PRFL_DELTAFRAMES | PRFL_MOVESEQ | PRFL_DEFLATE);
 		
 		// mh - read protocol flags from server so that we know what protocol features to expect
 		cl.protocolflags = (unsigned int) MSG_ReadLong ();
@@ -458,6 +475,9 @@ void CL_ParseUpdate (int bits)
 	entity_t	*ent;
 	int		num;
 	int		skin;
+	int		colormap;
+	const entity_state_t	*base;
+	entity_state_t			*state;
 
 	if (cls.signon == SIGNONS - 1)
 	{	// first update is the final signon stage
@@ -488,6 +508,11 @@ void CL_ParseUpdate (int bits)
 
 	ent = CL_EntityNum (num);
 
+	// with delta frames, missing fields come from the reference frame
+	base = cl_deltaref ? Delta_FindEntity (cl_deltaref, num) : NULL;
+	if (!base)
+		base = &ent->baseline;
+
 	if (ent->msgtime != cl.mtime[1])
 		forcelink = true;	// no previous frame to lerp from
 	else
@@ -507,29 +532,29 @@ void CL_ParseUpdate (int bits)
 			Host_Error ("CL_ParseModel: bad modnum");
 	}
 	else
-		modnum = ent->baseline.modelindex;
+		modnum = base->modelindex;
 
 	if (bits & U_FRAME)
 		ent->frame = MSG_ReadByte ();
 	else
-		ent->frame = ent->baseline.frame;
+		ent->frame = base->frame;
 
 	if (bits & U_COLORMAP)
-		i = MSG_ReadByte();
+		colormap = MSG_ReadByte();
 	else
-		i = ent->baseline.colormap;
-	if (!i)
+		colormap = base->colormap;
+	if (!colormap)
 		ent->colormap = vid.colormap;
 	else
 	{
-		if (i > cl.maxclients)
+		if (colormap > cl.maxclients)
 			Sys_Error ("i >= cl.maxclients");
-		ent->colormap = cl.scores[i-1].translations;
+		ent->colormap = cl.scores[colormap-1].translations;
 	}
 	if (bits & U_SKIN)
 		skin = MSG_ReadByte();
 	else
-		skin = ent->baseline.skin;
+		skin = base->skin;
 	if (skin != ent->skinnum)
 	{
 		ent->skinnum = skin;
@@ -539,7 +564,7 @@ void CL_ParseUpdate (int bits)
 	if (bits & U_EFFECTS)
 		ent->effects = MSG_ReadByte();
 	else
-		ent->effects = ent->baseline.effects;
+		ent->effects = base->effects;
 
 // shift the known values for interpolation
 	VectorCopy (ent->msg_origins[0], ent->msg_origins[1]);
@@ -548,29 +573,29 @@ void CL_ParseUpdate (int bits)
 	if (bits & U_ORIGIN1)
 		ent->msg_origins[0][0] = MSG_ReadCoord (cl.protocolflags);
 	else
-		ent->msg_origins[0][0] = ent->baseline.origin[0];
+		ent->msg_origins[0][0] = base->origin[0];
 	if (bits & U_ANGLE1)
 		ent->msg_angles[0][0] = MSG_ReadAngle(cl.protocolflags);
 	else
-		ent->msg_angles[0][0] = ent->baseline.angles[0];
+		ent->msg_angles[0][0] = base->angles[0];
 
 	if (bits & U_ORIGIN2)
 		ent->msg_origins[0][1] = MSG_ReadCoord (cl.protocolflags);
 	else
-		ent->msg_origins[0][1] = ent->baseline.origin[1];
+		ent->msg_origins[0][1] = base->origin[1];
 	if (bits & U_ANGLE2)
 		ent->msg_angles[0][1] = MSG_ReadAngle(cl.protocolflags);
 	else
-		ent->msg_angles[0][1] = ent->baseline.angles[1];
+		ent->msg_angles[0][1] = base->angles[1];
 
 	if (bits & U_ORIGIN3)
 		ent->msg_origins[0][2] = MSG_ReadCoord (cl.protocolflags);
 	else
-		ent->msg_origins[0][2] = ent->baseline.origin[2];
+		ent->msg_origins[0][2] = base->origin[2];
 	if (bits & U_ANGLE3)
 		ent->msg_angles[0][2] = MSG_ReadAngle(cl.protocolflags);
 	else
-		ent->msg_angles[0][2] = ent->baseline.angles[2];
+		ent->msg_angles[0][2] = base->angles[2];
 
 	//johnfitz -- lerping for movetype_step entities
 	if (bits & U_STEP)
@@ -588,11 +613,11 @@ void CL_ParseUpdate (int bits)
 		if (bits & U_ALPHA)
 			ent->alpha = MSG_ReadByte();
 		else
-			ent->alpha = ent->baseline.alpha;
+			ent->alpha = base->alpha;
 		if (bits & U_SCALE)
 			ent->scale = MSG_ReadByte();
 		else
-			ent->scale = ent->baseline.scale;
+			ent->scale = base->scale;
 		if (bits & U_FRAME2)
 			ent->frame = (ent->frame & 0x00FF) | (MSG_ReadByte() << 8);
 		if (bits & U_MODEL2)
@@ -625,11 +650,26 @@ void CL_ParseUpdate (int bits)
 			ent->alpha = ENTALPHA_ENCODE(b);
 		}
 		else
-			ent->alpha = ent->baseline.alpha;
-		ent->scale = ent->baseline.scale;
+			ent->alpha = base->alpha;
+		ent->scale = base->scale;
 	}
 	//johnfitz
 
+	// remember what we ended up with for the updates relative to this frame
+	if (cl_deltacur)
+	{
+		state = Delta_AddEntity (cl_deltacur, num);
+		VectorCopy (ent->msg_origins[0], state->origin);
+		VectorCopy (ent->msg_angles[0], state->angles);
+		state->modelindex = modnum;
+		state->frame = ent->frame;
+		state->colormap = colormap;
+		state->skin = skin;
+		state->effects = ent->effects;
+		state->alpha = ent->alpha;
+		state->scale = ent->scale;
+	}
+
 	//johnfitz -- moved here from above
 	model = cl.model_precache[modnum];
 	if (model != ent->model)
@@ -1054,6 +1094,149 @@ static void CL_ParseStuffText(const char *msg)
 	}
 }
 
+/*
+=====================
+CL_ParseDeltaFrame
+
+Starts recording the entity updates that follow, and picks the frame they
+are relative to
+=====================
+*/
+static void CL_ParseDeltaFrame (void)
+{
+	int		sequence, ref;
+
+	sequence = MSG_ReadLong ();
+	ref = MSG_ReadLong ();
+	if (sequence <= 0 || cl_deltacur)
+		Host_Error ("CL_ParseDeltaFrame: bad frame %d", sequence);
+
+	cl_deltaref = NULL;
+	if (ref)
+	{
+		cl_deltaref = &cl_deltaframes[ref & DELTA_MASK];
+		if (cl_deltaref->sequence != ref)
+		{
+			// only expected when a demo starts recording mid-game
+			Con_DPrintf ("CL_ParseDeltaFrame: frame %d is gone, using baselines\n", ref);
+			cl_deltaref = NULL;
+		}
+	}
+
+	cl_deltacur = &cl_deltaframes[sequence & DELTA_MASK];
+	Delta_BeginFrame (cl_deltacur, sequence);
+}
+
+/*
+=====================
+CL_SaveDeltaFrames
+
+Copies the delta frame history into frames[DELTA_BACKUP] for a demo keyframe
+=====================
+*/
+void CL_SaveDeltaFrames (deltaframe_t *frames)
+{
+	int		i;
+
+	for (i = 0; i < DELTA_BACKUP; i++)
+		Delta_CopyFrame (&frames[i], &cl_deltaframes[i]);
+}
+
+/*
+=====================
+CL_RestoreDeltaFrames
+
+Only valid between messages
+=====================
+*/
+void CL_RestoreDeltaFrames (const deltaframe_t *frames)
+{
+	int		i;
+
+	for (i = 0; i < DELTA_BACKUP; i++)
+		Delta_CopyFrame (&cl_deltaframes[i], &frames[i]);
+	cl_deltacur = NULL;
+	cl_deltaref = NULL;
+}
+
+/*
+=====================
+CL_FindDeltaFrame
+
+Returns the frame with the given sequence, or NULL if it is gone
+=====================
+*/
+const deltaframe_t *CL_FindDeltaFrame (int sequence)
+{
+	const deltaframe_t *frame = &cl_deltaframes[sequence & DELTA_MASK];
+
+	if (sequence <= 0 || frame->sequence != sequence)
+		return NULL;
+	return frame;
+}
+
+/*
+=====================
+CL_ParseDeflate
+
+Replaces the rest of net_message with the inflated messages it carries
+=====================
+*/
+static void CL_ParseDeflate (void)
+{
+	static byte	buf[NET_MAXMESSAGE];
+	int			size, insize;
+
+	size = MSG_ReadLong ();
+	if (size <= 0 || size > (int) sizeof (buf) || size > net_message.maxsize)
+		Host_Error ("CL_ParseDeflate: bad size %d", size);
+
+	insize = net_message.cursize - msg_readcount;
+	if (COM_Inflate (net_message.data + msg_readcount, insize, buf, size) != size)
+		Host_Error ("CL_ParseDeflate: corrupt message");
+
+	if (!cl.deflatedmsgs++)
+		cl.deflatefirst = realtime;
+	cl.deflatelast = realtime;
+	cl.deflatedbytes += net_message.cursize;
+	cl.inflatedbytes += size;
+
+	SZ_Clear (&net_message);
+	SZ_Write (&net_message, buf, size);
+	MSG_BeginReading ();
+}
+
+/*
+=====================
+CL_ReportDeflate
+
+Prints how much svc_deflate saved during the signon
+=====================
+*/
+void CL_ReportDeflate (void)
+{
+	double	elapsed, saved;
+
+	if (!cl.deflatedmsgs || cls.demoplayback)
+		return;
+
+	Con_Printf ("Signon data deflated from %i to %i KB (%.1f:1)",
+		(cl.inflatedbytes + 1023) / 1024, (cl.deflatedbytes + 1023) / 1024,
+		(double) cl.inflatedbytes / q_max (cl.deflatedbytes, 1));
+
+	// estimate the time the uncompressed data would have taken at the rate the
+	// compressed messages came in, which needs at least two of them
+	elapsed = cl.deflatelast - cl.deflatefirst;
+	if (cl.deflatedmsgs > 1 && elapsed > 0.0)
+	{
+		saved = elapsed * (cl.inflatedbytes - cl.deflatedbytes) / cl.deflatedbytes;
+		Con_Printf (", ~%.2f s of connect time saved", saved);
+	}
+	Con_Printf ("\n");
+
+	cl.deflatedmsgs = 0;
+}
+
 /*
 =====================
 CL_ParseServerMessage
@@ -1081,6 +1264,9 @@ void CL_ParseServerMessage (void)
 //
 	MSG_BeginReading ();
 
+	cl_deltacur = NULL;
+	cl_deltaref = NULL;
+
 	lastcmd = 0;
 	while (1)
 	{
@@ -1093,6 +1279,13 @@ void CL_ParseServerMessage (void)
 		{
 			SHOWNET("END OF MESSAGE");
 
+			if (cl_deltacur)
+			{
+				Delta_EndFrame (cl_deltacur);
+				cl.deltaack = cl_deltacur->sequence;
+				cl_deltacur = NULL;
+			}
+
 			if (*cl.stuffcmdbuf && net_message.cursize < 512)
 				CL_ParseStuffText("\n");	//there's a few mods that forget to write \ns, that then fuck up other things too. So make sure it gets flushed to the cbuf. the cursize check is to reduce backbuffer overflows that would give a false positive.
 
@@ -1130,6 +1323,22 @@ void CL_ParseServerMessage (void)
 			cl.fixangle = false;
 			break;
 
+		case svc_deltaframe:
+			CL_ParseDeltaFrame ();
+			break;
+
+		case svc_playerstate:
+			CL_ParsePlayerState ();
+			break;
+
+		case svc_movevars:
+			CL_ParseMovevars ();
+			break;
+
+		case svc_deflate:
+			CL_ParseDeflate ();
+			break;
+
 		case svc_clientdata:
 			CL_ParseClientdata (); //johnfitz -- removed bits parameter, we will read this inside CL_ParseClientdata()
 			break;
@@ -0,0 +1,539 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// cl_pred.c -- client side player movement prediction
+//
+// With PRFL_MOVESEQ every clc_move is followed by its sequence number, and the
+// server puts the player's origin and velocity after the last move it ran into
+// each datagram (svc_playerstate), while the physics settings come on the
+// reliable stream (svc_movevars).  Starting from that state the client replays
+// the moves the server hasn't seen yet through the player movement it shares
+// with the server (pmove.c), clipped against the world and the brush models it
+// knows about, so the view doesn't lag a round trip behind the input.  When a
+// new server state disagrees with what was predicted for the same moves, the
+// difference is blended out over cl_predict_smooth seconds instead of snapping.
+
+#include "quakedef.h"
+
+cvar_t	cl_predict = {"cl_predict", "1", CVAR_ARCHIVE};
+cvar_t	cl_predict_smooth = {"cl_predict_smooth", "0.1", CVAR_ARCHIVE};	// seconds to blend out corrections
+
+#define PRED_BACKUP		64		// moves remembered, must be a power of two
+#define PRED_MASK		(PRED_BACKUP - 1)
+#define PRED_MAXERROR	64		// larger corrections are teleports, don't smooth them
+#define PRED_MAXTIME	0.1		// longest time step, like host_frametime on the server
+
+#define MAX_PHYSENTS	64
+
+typedef struct
+{
+	int			sequence;
+	double		senttime;		// realtime
+	float		frametime;		// time the move covers
+	vec3_t		viewangles;
+	float		forwardmove, sidemove, upmove;
+	int			buttons;
+} predcmd_t;
+
+typedef struct
+{
+	int			sequence;		// last move the server ran
+	int			flags;			// PS_* bits
+	int			movetype;
+	vec3_t		origin;
+	vec3_t		velocity;
+} predstate_t;
+
+typedef struct
+{
+	vec3_t		origin;
+	vec3_t		velocity;
+	vec3_t		angles;			// as the server derives them from the view angles
+	vec3_t		v_angle;
+	float		flags;			// FL_* bits, like the edict fields pm points at on the server
+	float		waterlevel;
+	float		watertype;
+	float		movetype;
+	pmove_t		pm;				// points at the fields above
+} predplayer_t;
+
+static vec3_t	player_mins = {-16, -16, -24};	// the player box is hull 1
+static vec3_t	player_maxs = {16, 16, 32};
+
+static struct
+{
+	predcmd_t	cmds[PRED_BACKUP];
+	int			outgoing;		// sequence of the next move
+
+	predstate_t	state;			// last server state the prediction starts from
+	predstate_t	incoming;		// newer state, picked up by the next CL_PredictMove
+	qboolean	valid, hasincoming;
+	float		movevars[NUM_MOVEVARS];
+	qboolean	movevarsvalid;
+
+	vec3_t		error;			// displayed minus predicted origin, decays to zero
+
+	entity_t	*physents[MAX_PHYSENTS];
+	int			numphysents;
+} pred;
+
+/*
+=================
+CL_ClearPrediction
+
+The server restarts move sequences for every map
+=================
+*/
+void CL_ClearPrediction (void)
+{
+	memset (&pred, 0, sizeof (pred));
+	pred.outgoing = 1;
+}
+
+/*
+=================
+CL_PredictRecordMove
+
+Remembers a move for replaying and returns its sequence number
+=================
+*/
+int CL_PredictRecordMove (const usercmd_t *cmd, int buttons)
+{
+	predcmd_t	*pc = &pred.cmds[pred.outgoing & PRED_MASK];
+
+	pc->sequence = pred.outgoing;
+	pc->senttime = realtime;
+	pc->frametime = q_min (host_frametime, PRED_MAXTIME);
+	VectorCopy (cl.viewangles, pc->viewangles);
+	pc->forwardmove = cmd->forwardmove;
+	pc->sidemove = cmd->sidemove;
+	pc->upmove = cmd->upmove;
+	pc->buttons = buttons;
+
+	return pred.outgoing++;
+}
+
+/*
+=================
+CL_ParsePlayerState
+=================
+*/
+void CL_ParsePlayerState (void)
+{
+	predstate_t	*st = &pred.incoming;
+	int			i;
+
+	st->sequence = MSG_ReadLong ();
+	st->flags = MSG_ReadByte ();
+	st->movetype = MSG_ReadByte ();
+	for (i = 0; i < 3; i++)
+		st->origin[i] = MSG_ReadFloat ();
+	for (i = 0; i < 3; i++)
+		st->velocity[i] = MSG_ReadFloat ();
+
+	pred.hasincoming = true;
+}
+
+/*
+=================
+CL_ParseMovevars
+
+Nothing is predicted until the first ones arrive
+=================
+*/
+void CL_ParseMovevars (void)
+{
+	int		i;
+
+	for (i = 0; i < NUM_MOVEVARS; i++)
+		pred.movevars[i] = MSG_ReadFloat ();
+	pred.movevarsvalid = true;
+}
+
+/*
+===============================================================================
+
+PLAYER MOVEMENT
+
+The movement itself is pmove.c, the same code the server runs.  What the
+client supplies is the world to clip against and the parts of a move the
+server leaves to the progs.
+
+===============================================================================
+*/
+
+/*
+==================
+CL_PredGatherPhysents
+
+Brush models that were in one of the last two messages.  Rotated ones are
+left out since CL_PredClipMoveToHull only offsets the trace.  Triggers have
+no model on the client, so what's left is mostly doors, plats and the like.
+==================
+*/
+static void CL_PredGatherPhysents (void)
+{
+	entity_t	*ent;
+	int			i;
+
+	pred.numphysents = 0;
+	for (i = 1, ent = cl_entities + 1; i < cl.num_entities && pred.numphysents < MAX_PHYSENTS; i++, ent++)
+	{
+		if (!ent->model || ent->model->type != mod_brush || ent->model->name[0] != '*')
+			continue;
+		if (ent->msgtime < cl.mtime[1])
+			continue;
+		if (ent->angles[0] || ent->angles[1] || ent->angles[2])
+			continue;
+		pred.physents[pred.numphysents++] = ent;
+	}
+}
+
+/*
+==================
+CL_PredClipMoveToHull
+==================
+*/
+static void CL_PredClipMoveToHull (hull_t *hull, const vec3_t offset, const vec3_t start, const vec3_t end, trace_t *trace)
+{
+	vec3_t		start_l, end_l;
+
+	memset (trace, 0, sizeof (*trace));
+	trace->fraction = 1;
+	trace->allsolid = true;
+	VectorCopy (end, trace->endpos);
+
+	VectorSubtract (start, offset, start_l);
+	VectorSubtract (end, offset, end_l);
+
+	SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start_l, end_l, trace);
+
+	if (trace->fraction != 1)
+		VectorAdd (trace->endpos, offset, trace->endpos);
+}
+
+/*
+==================
+CL_PredTrace
+
+Traces a point or the player box through the world and the physents, like
+SV_Move.  There are no monsters to leave out, so the move type doesn't matter.
+==================
+*/
+static trace_t CL_PredTrace (pmove_t *pm, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type)
+{
+	trace_t		trace, t;
+	int			i, hullnum;
+
+	hullnum = (maxs[0] - mins[0] < 3) ? 0 : 1;
+
+	CL_PredClipMoveToHull (&cl.worldmodel->hulls[hullnum], vec3_origin, start, end, &trace);
+
+	for (i = 0; i < pred.numphysents; i++)
+	{
+		if (trace.allsolid)
+			break;
+		CL_PredClipMoveToHull (&pred.physents[i]->model->hulls[hullnum], pred.physents[i]->origin, start, end, &t);
+		if (t.allsolid || t.startsolid || t.fraction < trace.fraction)
+		{
+			if (trace.startsolid)
+			{
+				trace = t;
+				trace.startsolid = true;
+			}
+			else
+				trace = t;
+		}
+	}
+
+	return trace;
+}
+
+/*
+==================
+CL_PredPointContents
+==================
+*/
+static int CL_PredPointContents (pmove_t *pm, vec3_t p)
+{
+	int		cont;
+
+	cont = SV_HullPointContents (&cl.worldmodel->hulls[0], 0, p);
+	if (cont <= CONTENTS_CURRENT_0 && cont >= CONTENTS_CURRENT_DOWN)
+		cont = CONTENTS_WATER;
+	return cont;
+}
+
+/*
+==================
+CL_PredGround
+
+Everything the client clips against is a brush model, so anything is ground
+==================
+*/
+static void CL_PredGround (pmove_t *pm, const trace_t *trace)
+{
+	*pm->flags = (int)*pm->flags | FL_ONGROUND;
+}
+
+/*
+==================
+CL_PredInitPlayer
+==================
+*/
+static void CL_PredInitPlayer (predplayer_t *pl, const predstate_t *st)
+{
+	pmove_t		*pm = &pl->pm;
+
+	memset (pl, 0, sizeof (*pl));
+	VectorCopy (st->origin, pl->origin);
+	VectorCopy (st->velocity, pl->velocity);
+	if (st->flags & PS_ONGROUND)
+		pl->flags = (int)pl->flags | FL_ONGROUND;
+	if (st->flags & PS_JUMPRELEASED)
+		pl->flags = (int)pl->flags | FL_JUMPRELEASED;
+	if (st->flags & PS_WATERJUMP)
+		pl->flags = (int)pl->flags | FL_WATERJUMP;
+	pl->movetype = st->movetype;
+
+	pm->origin = pl->origin;
+	pm->velocity = pl->velocity;
+	pm->flags = &pl->flags;
+	pm->waterlevel = &pl->waterlevel;
+	pm->watertype = &pl->watertype;
+	pm->movetype = &pl->movetype;
+	pm->mins = player_mins;
+	pm->maxs = player_maxs;
+	pm->angles = pl->angles;
+	pm->v_angle = pl->v_angle;
+	pm->viewheight = cl.viewheight;
+	pm->solid = SOLID_SLIDEBOX;
+	pm->pushtype = MOVE_NORMAL;
+	memcpy (pm->movevars, pred.movevars, sizeof (pm->movevars));
+
+	pm->move = CL_PredTrace;
+	pm->pointcontents = CL_PredPointContents;
+	pm->ground = CL_PredGround;
+
+	PM_CheckWater (pm);
+}
+
+/*
+===================
+CL_PredJump
+
+What PlayerPreThink in the standard progs does with the jump button.  The
+server sends a jump velocity of 0 when its progs do something else.
+===================
+*/
+static void CL_PredJump (predplayer_t *pl, const predcmd_t *cmd)
+{
+	float	jumpvelocity = pl->pm.movevars[MV_JUMPVELOCITY];
+
+	if (!jumpvelocity)
+		return;
+
+	if (!(cmd->buttons & 2))
+	{
+		pl->flags = (int)pl->flags | FL_JUMPRELEASED;
+		return;
+	}
+
+	if ((int)pl->flags & FL_WATERJUMP)
+		return;
+
+	if (pl->waterlevel >= 2)
+	{
+		if (pl->watertype == CONTENTS_WATER)
+			pl->velocity[2] = 100;
+		else if (pl->watertype == CONTENTS_SLIME)
+			pl->velocity[2] = 80;
+		else
+			pl->velocity[2] = 50;
+		return;
+	}
+
+	if (!((int)pl->flags & FL_ONGROUND) || !((int)pl->flags & FL_JUMPRELEASED))
+		return;
+
+	pl->flags = (int)pl->flags & ~(FL_JUMPRELEASED | FL_ONGROUND);
+	pl->velocity[2] += jumpvelocity;
+}
+
+/*
+===================
+CL_PredPlayerMove
+
+One move in the order the server runs it: SV_ClientThink from the client
+message, then PlayerPreThink and SV_Physics_Client
+===================
+*/
+static void CL_PredPlayerMove (predplayer_t *pl, const predcmd_t *cmd, float frametime)
+{
+	pmove_t		*pm = &pl->pm;
+
+	pm->frametime = frametime;
+	if (frametime <= 0)
+		return;
+
+	VectorCopy (cmd->viewangles, pl->v_angle);
+	pl->angles[ROLL] = V_CalcRoll (pl->angles, pl->velocity)*4;
+	pl->angles[PITCH] = -cmd->viewangles[PITCH]/3;
+	pl->angles[YAW] = cmd->viewangles[YAW];
+
+	VectorCopy (cmd->viewangles, pm->cmd.viewangles);
+	pm->cmd.forwardmove = cmd->forwardmove;
+	pm->cmd.sidemove = cmd->sidemove;
+	pm->cmd.upmove = cmd->upmove;
+
+	if (!((int)pl->flags & FL_WATERJUMP))
+	{
+		if (pl->waterlevel >= 2)
+			PM_WaterMove (pm);
+		else
+			PM_AirMove (pm);
+	}
+
+	CL_PredJump (pl, cmd);
+
+	if (!PM_CheckWater (pm) && !((int)pl->flags & FL_WATERJUMP))
+		pl->velocity[2] -= pm->movevars[MV_GRAVITY] * frametime;
+
+	PM_WalkMove (pm);
+}
+
+//============================================================================
+
+/*
+=================
+CL_PredictActive
+=================
+*/
+static qboolean CL_PredictActive (void)
+{
+	if (!cl_predict.value || sv.active || cls.demoplayback)
+		return false;
+	if (!(cl.protocolflags & PRFL_MOVESEQ) || cls.signon != SIGNONS || !cl.worldmodel)
+		return false;
+	if (cl.intermission || cl.stats[STAT_HEALTH] <= 0)
+		return false;
+	return true;
+}
+
+/*
+=================
+CL_PredictFromState
+
+Replays all moves the state doesn't include, and part of the next one for
+the time since the last move was sent
+=================
+*/
+static void CL_PredictFromState (const predstate_t *st, predplayer_t *pl)
+{
+	predcmd_t	*cmd;
+	int			seq, last;
+
+	CL_PredInitPlayer (pl, st);
+
+	last = pred.outgoing - 1;
+	seq = q_max (st->sequence + 1, pred.outgoing - PRED_BACKUP + 1);
+	for (; seq <= last; seq++)
+	{
+		cmd = &pred.cmds[seq & PRED_MASK];
+		if (cmd->sequence != seq)
+			continue;
+		CL_PredPlayerMove (pl, cmd, cmd->frametime);
+	}
+
+	cmd = &pred.cmds[last & PRED_MASK];
+	if (cmd->sequence == last && last > st->sequence)
+		CL_PredPlayerMove (pl, cmd, q_min (realtime - cmd->senttime, PRED_MAXTIME));
+}
+
+/*
+=================
+CL_PredictMove
+
+Called every frame after the entities are relinked, moves the view entity
+to where the player will be once the server has run the pending moves
+=================
+*/
+void CL_PredictMove (void)
+{
+	entity_t	*ent;
+	predplayer_t	pl, old;
+	vec3_t		delta;
+	float		frac;
+
+	if (!CL_PredictActive () || !pred.movevarsvalid)
+	{
+		pred.valid = false;
+		return;
+	}
+
+	CL_PredGatherPhysents ();
+
+	if (pred.hasincoming)
+	{
+		// the difference between what the old and the new state predict for
+		// the same moves is the correction, which gets blended out
+		if (pred.valid)
+			CL_PredictFromState (&pred.state, &old);
+		pred.state = pred.incoming;
+		pred.hasincoming = false;
+		if (pred.valid)
+		{
+			CL_PredictFromState (&pred.state, &pl);
+			VectorSubtract (old.origin, pl.origin, delta);
+			VectorAdd (pred.error, delta, pred.error);
+			if (VectorLength (pred.error) > PRED_MAXERROR || cl_predict_smooth.value <= 0.f)
+				VectorCopy (vec3_origin, pred.error);
+		}
+		else
+			VectorCopy (vec3_origin, pred.error);
+		pred.valid = true;
+	}
+
+	if (!pred.valid || pred.state.movetype != MOVETYPE_WALK)
+		return;
+
+	CL_PredictFromState (&pred.state, &pl);
+
+	if (cl_predict_smooth.value > 0.f)
+	{
+		frac = 1.f - host_frametime / cl_predict_smooth.value;
+		VectorScale (pred.error, q_max (frac, 0.f), pred.error);
+	}
+
+	ent = &cl_entities[cl.viewentity];
+	VectorAdd (pl.origin, pred.error, ent->origin);
+	VectorCopy (pl.velocity, cl.velocity);
+}
+
+/*
+=================
+CL_InitPrediction
+=================
+*/
+void CL_InitPrediction (void)
+{
+	Cvar_RegisterVariable (&cl_predict);
+	Cvar_RegisterVariable (&cl_predict_smooth);
+	CL_ClearPrediction ();
+}
@@ -246,6 +246,13 @@ typedef struct
 
 	unsigned	protocol; //johnfitz
 	unsigned	protocolflags;
+	int			deltaack;		// newest svc_deltaframe parsed, sent back with clc_ackframe
+
+// PRFL_DEFLATE signon statistics
+	int			deflatedbytes;	// svc_deflate messages as received
+	int			inflatedbytes;	// and after inflating them
+	int			deflatedmsgs;
+	double		deflatefirst, deflatelast;	// realtime of the first and last one
 
 	qboolean	sendprespawn;
 
@@ -265,6 +272,7 @@ typedef struct
 //
 extern	cvar_t	cl_name;
 extern	cvar_t	cl_color;
+extern	cvar_t	cl_rate;
 
 extern	cvar_t	cl_upspeed;
 extern	cvar_t	cl_forwardspeed;
@@ -379,11 +387,16 @@ void CL_Stop_f (void);
 void CL_Record_f (void);
 void CL_PlayDemo_f (void);
 void CL_TimeDemo_f (void);
+void CL_DemoSeek_f (void);
 
 //
 // cl_parse.c
 //
 void CL_ParseServerMessage (void);
+void CL_ReportDeflate (void);
+void CL_SaveDeltaFrames (deltaframe_t *frames);
+void CL_RestoreDeltaFrames (const deltaframe_t *frames);
+const deltaframe_t *CL_FindDeltaFrame (int sequence);
 void CL_NewTranslation (int slot);
 
 //
@@ -396,6 +409,18 @@ void V_RenderView (void);
 void V_ParseDamage (void);
 void V_SetContentsColor (int contents);
 
+//
+// cl_pred
+//
+extern	cvar_t	cl_predict;
+
+void CL_InitPrediction (void);
+void CL_ClearPrediction (void);
+int CL_PredictRecordMove (const usercmd_t *cmd, int buttons);
+void CL_ParsePlayerState (void);
+void CL_ParseMovevars (void);
+void CL_PredictMove (void);
+
 //
 // cl_tent
 //
@@ -0,0 +1,223 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// deflate.c -- raw deflate streams for PRFL_DEFLATE messages
+//
+// The vendored miniz is built with MINIZ_NO_DEFLATE_APIS, so compression is
+// done by the small greedy LZ77 coder below, which emits a single block
+// using the fixed Huffman codes of RFC 1951.  That is enough for the highly
+// repetitive signon data; decompression goes through miniz's tinfl.
+
+#include "quakedef.h"
+#include "miniz.h"
+
+#define DEFL_WINDOW		32768
+#define DEFL_HASHBITS	14
+#define DEFL_HASHSIZE	(1 << DEFL_HASHBITS)
+#define DEFL_MINMATCH	3
+#define DEFL_MAXMATCH	258
+#define DEFL_MAXCHAIN	48
+
+static const unsigned short defl_lengthbase[29] =
+{
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const byte defl_lengthextra[29] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short defl_distbase[30] =
+{
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const byte defl_distextra[30] =
+{
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+typedef struct
+{
+	byte			*out, *end;
+	unsigned int	bits;
+	int				numbits;
+	qboolean		overflow;
+} deflbits_t;
+
+static void Defl_PutBits (deflbits_t *b, unsigned int value, int count)
+{
+	b->bits |= value << b->numbits;
+	b->numbits += count;
+	while (b->numbits >= 8)
+	{
+		if (b->out == b->end)
+		{
+			b->overflow = true;
+			b->bits = b->numbits = 0;
+			return;
+		}
+		*b->out++ = b->bits & 255;
+		b->bits >>= 8;
+		b->numbits -= 8;
+	}
+}
+
+// Huffman codes are stored most significant bit first
+static void Defl_PutCode (deflbits_t *b, unsigned int code, int len)
+{
+	unsigned int	rev;
+	int				i;
+
+	for (i = 0, rev = 0; i < len; i++, code >>= 1)
+		rev = (rev << 1) | (code & 1);
+	Defl_PutBits (b, rev, len);
+}
+
+static void Defl_PutSymbol (deflbits_t *b, int sym)
+{
+	if (sym < 144)
+		Defl_PutCode (b, 0x30 + sym, 8);
+	else if (sym < 256)
+		Defl_PutCode (b, 0x190 + sym - 144, 9);
+	else if (sym < 280)
+		Defl_PutCode (b, sym - 256, 7);
+	else
+		Defl_PutCode (b, 0xc0 + sym - 280, 8);
+}
+
+static void Defl_PutMatch (deflbits_t *b, int len, int dist)
+{
+	int		i;
+
+	for (i = 28; defl_lengthbase[i] > len; i--)
+		;
+	Defl_PutSymbol (b, 257 + i);
+	if (defl_lengthextra[i])
+		Defl_PutBits (b, len - defl_lengthbase[i], defl_lengthextra[i]);
+
+	for (i = 29; defl_distbase[i] > dist; i--)
+		;
+	Defl_PutCode (b, i, 5);
+	if (defl_distextra[i])
+		Defl_PutBits (b, dist - defl_distbase[i], defl_distextra[i]);
+}
+
+static unsigned int Defl_Hash (const byte *p)
+{
+	return ((p[0] | (p[1] << 8) | (p[2] << 16)) * 2654435761u) >> (32 - DEFL_HASHBITS);
+}
+
+/*
+==================
+COM_Deflate
+
+Not reentrant, only the server's main thread compresses
+==================
+*/
+int COM_Deflate (const byte *in, int inlen, byte *out, int outsize)
+{
+	static int	head[DEFL_HASHSIZE];
+	static int	prev[DEFL_WINDOW];
+	deflbits_t	b;
+	int			pos, cand, chain, len, maxlen, bestlen, bestdist, end;
+	unsigned int	h;
+
+	memset (head, 0xff, sizeof (head));
+
+	b.out = out;
+	b.end = out + outsize;
+	b.bits = 0;
+	b.numbits = 0;
+	b.overflow = false;
+
+	Defl_PutBits (&b, 1, 1);	// BFINAL
+	Defl_PutBits (&b, 1, 2);	// BTYPE = fixed Huffman codes
+
+	for (pos = 0; pos < inlen && !b.overflow; )
+	{
+		bestlen = bestdist = 0;
+		if (pos + DEFL_MINMATCH <= inlen)
+		{
+			maxlen = q_min (DEFL_MAXMATCH, inlen - pos);
+			chain = DEFL_MAXCHAIN;
+			for (cand = head[Defl_Hash (in + pos)]; cand >= 0 && pos - cand <= DEFL_WINDOW && chain--; cand = prev[cand & (DEFL_WINDOW - 1)])
+			{
+				if (in[cand + bestlen] != in[pos + bestlen])
+					continue;
+				for (len = 0; len < maxlen && in[cand + len] == in[pos + len]; len++)
+					;
+				if (len > bestlen)
+				{
+					bestlen = len;
+					bestdist = pos - cand;
+					if (len == maxlen)
+						break;
+				}
+			}
+		}
+
+		if (bestlen >= DEFL_MINMATCH)
+			Defl_PutMatch (&b, bestlen, bestdist);
+		else
+		{
+			Defl_PutSymbol (&b, in[pos]);
+			bestlen = 1;
+		}
+
+		// every position covered goes into the hash chains
+		for (end = pos + bestlen; pos < end; pos++)
+		{
+			if (pos + DEFL_MINMATCH > inlen)
+				continue;
+			h = Defl_Hash (in + pos);
+			prev[pos & (DEFL_WINDOW - 1)] = head[h];
+			head[h] = pos;
+		}
+	}
+
+	Defl_PutSymbol (&b, 256);	// end of block
+	Defl_PutBits (&b, 0, 7);	// flush the last partial byte
+	if (b.overflow)
+		return 0;
+
+	return (int)(b.out - out);
+}
+
+/*
+==================
+COM_Inflate
+==================
+*/
+int COM_Inflate (const byte *in, int inlen, byte *out, int outsize)
+{
+	static tinfl_decompressor	inflator;
+	size_t			insize = inlen;
+	size_t			outlen = outsize;
+	tinfl_status	status;
+
+	tinfl_init (&inflator);
+	status = tinfl_decompress (&inflator, in, &insize, out, out, &outlen, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+	if (status != TINFL_STATUS_DONE)
+		return -1;
+
+	return (int) outlen;
+}
@@ -0,0 +1,31 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _QUAKE_DEFLATE_H
+#define _QUAKE_DEFLATE_H
+
+// deflate.h -- raw deflate streams for PRFL_DEFLATE messages
+
+// returns the compressed size, or 0 if the result would not fit in outsize
+int COM_Deflate (const byte *in, int inlen, byte *out, int outsize);
+
+// returns the inflated size, or -1 on a corrupt stream or if it does not fit
+int COM_Inflate (const byte *in, int inlen, byte *out, int outsize);
+
+#endif	/* _QUAKE_DEFLATE_H */
@@ -0,0 +1,148 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// delta.c -- entity frames kept by both ends of a PRFL_DELTAFRAMES connection
+//
+// With PRFL_DELTAFRAMES every datagram starts its entity updates with
+// svc_deltaframe, carrying the sequence number of the frame and of the
+// frame the updates are relative to (0 for the baselines).  Both sides keep
+// the state of each entity in the last DELTA_BACKUP frames exactly as the
+// client decoded it, and the client acknowledges the newest frame it got
+// with clc_ackframe.  An entity missing from the reference frame is coded
+// against its baseline, so both sides always agree on the starting point.
+//
+// A client recording a demo acknowledges frame 0, so once the server has
+// seen that, every frame in the demo is relative to the baselines and
+// playback can start at any message.  CL_Record_f writes the frames the
+// datagrams still in flight may refer to.  Demos recorded this way contain
+// svc_deltaframe and PRFL_DELTAFRAMES in svc_serverinfo, which older
+// engines refuse, so servers whose demos must play elsewhere should run
+// with sv_deltaframes 0.
+
+#include "quakedef.h"
+
+/*
+==================
+Delta_BeginFrame
+==================
+*/
+void Delta_BeginFrame (deltaframe_t *frame, int sequence)
+{
+	frame->sequence = sequence;
+	frame->numents = 0;
+}
+
+/*
+==================
+Delta_AddEntity
+
+Returns the state to fill in for entity num
+==================
+*/
+entity_state_t *Delta_AddEntity (deltaframe_t *frame, int num)
+{
+	deltaent_t	*ent;
+
+	if (frame->numents == frame->maxents)
+	{
+		frame->maxents = q_max (frame->maxents * 2, 64);
+		frame->ents = (deltaent_t *) realloc (frame->ents, frame->maxents * sizeof (deltaent_t));
+		if (!frame->ents)
+			Sys_Error ("Delta_AddEntity: realloc() failed on %d entities", frame->maxents);
+	}
+
+	ent = &frame->ents[frame->numents++];
+	ent->num = num;
+	return &ent->state;
+}
+
+static int Delta_CompareEnts (const void *a, const void *b)
+{
+	return ((const deltaent_t *)a)->num - ((const deltaent_t *)b)->num;
+}
+
+/*
+==================
+Delta_EndFrame
+==================
+*/
+void Delta_EndFrame (deltaframe_t *frame)
+{
+	qsort (frame->ents, frame->numents, sizeof (frame->ents[0]), Delta_CompareEnts);
+}
+
+/*
+==================
+Delta_FindEntity
+
+Returns NULL if entity num isn't part of the frame
+==================
+*/
+const entity_state_t *Delta_FindEntity (const deltaframe_t *frame, int num)
+{
+	int		lo, hi, mid;
+
+	lo = 0;
+	hi = frame->numents - 1;
+	while (lo <= hi)
+	{
+		mid = (lo + hi) >> 1;
+		if (frame->ents[mid].num == num)
+			return &frame->ents[mid].state;
+		if (frame->ents[mid].num < num)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return NULL;
+}
+
+/*
+==================
+Delta_CopyFrame
+
+dst keeps its own entity buffer, zero it before the first copy
+==================
+*/
+void Delta_CopyFrame (deltaframe_t *dst, const deltaframe_t *src)
+{
+	dst->sequence = src->sequence;
+	dst->numents = src->sequence ? src->numents : 0;
+	if (dst->numents > dst->maxents)
+	{
+		dst->maxents = dst->numents;
+		dst->ents = (deltaent_t *) realloc (dst->ents, dst->maxents * sizeof (deltaent_t));
+		if (!dst->ents)
+			Sys_Error ("Delta_CopyFrame: realloc() failed on %d entities", dst->maxents);
+	}
+	if (dst->numents)
+		memcpy (dst->ents, src->ents, dst->numents * sizeof (deltaent_t));
+}
+
+/*
+==================
+Delta_FreeFrame
+==================
+*/
+void Delta_FreeFrame (deltaframe_t *frame)
+{
+	free (frame->ents);
+	memset (frame, 0, sizeof (*frame));
+}
@@ -0,0 +1,49 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _QUAKE_DELTA_H
+#define _QUAKE_DELTA_H
+
+// delta.h -- entity frames kept by both ends of a PRFL_DELTAFRAMES connection
+
+#define DELTA_BACKUP	32		// frames kept on each side, must be a power of two
+#define DELTA_MASK		(DELTA_BACKUP - 1)
+
+typedef struct
+{
+	int				num;
+	entity_state_t	state;		// as the client decoded it
+} deltaent_t;
+
+typedef struct
+{
+	int				sequence;	// 0 = unused
+	int				numents;
+	int				maxents;
+	deltaent_t		*ents;		// sorted by num once the frame is finished
+} deltaframe_t;
+
+void Delta_BeginFrame (deltaframe_t *frame, int sequence);
+entity_state_t *Delta_AddEntity (deltaframe_t *frame, int num);
+void Delta_EndFrame (deltaframe_t *frame);
+const entity_state_t *Delta_FindEntity (const deltaframe_t *frame, int num);
+void Delta_CopyFrame (deltaframe_t *dst, const deltaframe_t *src);
+void Delta_FreeFrame (deltaframe_t *frame);
+
+#endif	/* _QUAKE_DELTA_H */
@@ -45,6 +45,22 @@ static int	mod_novis_capacity;
 static byte	*mod_decompressed;
 static int	mod_decompressed_capacity;
 
+// set-associative LRU cache of decompressed leaf PVS rows
+#define VISCACHE_SETS	64
+#define VISCACHE_WAYS	4
+
+typedef struct
+{
+	qmodel_t	*model;
+	int			leafnum;
+	unsigned	lastused;
+} viscacheentry_t;
+
+static viscacheentry_t	mod_viscache[VISCACHE_SETS][VISCACHE_WAYS];
+static byte				*mod_viscache_rows;
+static int				mod_viscache_rowsize;
+static unsigned			mod_viscache_clock;
+
 #define	MAX_MOD_KNOWN	4096 /*johnfitz -- was 512 */
 static qmodel_t	mod_known[MAX_MOD_KNOWN];
 static int		mod_numknown;
@@ -130,26 +146,21 @@ mleaf_t *Mod_PointInLeaf (vec3_t p, qmodel_t *model)
 
 /*
 ===================
-Mod_DecompressVis
+Mod_DecompressVisRow
+
+Only touches out, so it is safe to call from worker threads
 ===================
 */
-static byte *Mod_DecompressVis (byte *in, qmodel_t *model)
+static void Mod_DecompressVisRow (byte *in, qmodel_t *model, byte *out)
 {
 	int		c;
-	byte	*out;
+	byte	*start;
 	byte	*outend;
 	int		row;
 
 	row = (model->numleafs+7)>>3;
-	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
-	{
-		mod_decompressed_capacity = (row + 15) & ~15;
-		mod_decompressed = (byte *) realloc (mod_decompressed, mod_decompressed_capacity);
-		if (!mod_decompressed)
-			Sys_Error ("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
-	}
-	out = mod_decompressed;
-	outend = mod_decompressed + row;
+	start = out;
+	outend = out + row;
 
 	if (!in)
 	{	// no vis info, so make all visible
@@ -158,7 +169,7 @@ static byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 			*out++ = 0xff;
 			row--;
 		}
-		return mod_decompressed;
+		return;
 	}
 
 	do
@@ -171,8 +182,8 @@ static byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 
 		c = in[1];
 		in += 2;
-		if (c > row - (out - mod_decompressed))
-			c = row - (out - mod_decompressed);	//now that we're dynamically allocating pvs buffers, we have to be more careful to avoid heap overflows with buggy maps.
+		if (c > row - (out - start))
+			c = row - (out - start);	//now that we're dynamically allocating pvs buffers, we have to be more careful to avoid heap overflows with buggy maps.
 		while (c)
 		{
 			if (out == outend)
@@ -181,21 +192,111 @@ static byte *Mod_DecompressVis (byte *in, qmodel_t *model)
 					model->viswarn = true;
 					Con_Warning("Mod_DecompressVis: output overrun on model \"%s\"\n", model->name);
 				}
-				return mod_decompressed;
+				return;
 			}
 			*out++ = 0;
 			c--;
 		}
-	} while (out - mod_decompressed < row);
+	} while (out - start < row);
+}
+
+/*
+===================
+Mod_DecompressVis
+===================
+*/
+static byte *Mod_DecompressVis (byte *in, qmodel_t *model)
+{
+	int		row;
+
+	row = (model->numleafs+7)>>3;
+	if (mod_decompressed == NULL || row > mod_decompressed_capacity)
+	{
+		mod_decompressed_capacity = (row + 15) & ~15;
+		mod_decompressed = (byte *) realloc (mod_decompressed, mod_decompressed_capacity);
+		if (!mod_decompressed)
+			Sys_Error ("Mod_DecompressVis: realloc() failed on %d bytes", mod_decompressed_capacity);
+	}
+	Mod_DecompressVisRow (in, model, mod_decompressed);
 
 	return mod_decompressed;
 }
 
+/*
+===================
+Mod_DecompressLeafPVS
+
+Writes the PVS of leaf to out, which must hold (numleafs+7)>>3 bytes.
+Unlike Mod_LeafPVS it doesn't use the cache, so it is safe to call from
+worker threads.
+===================
+*/
+void Mod_DecompressLeafPVS (mleaf_t *leaf, qmodel_t *model, byte *out)
+{
+	if (leaf == model->leafs)
+		memset (out, 0xff, (model->numleafs+7)>>3);
+	else
+		Mod_DecompressVisRow (leaf->compressed_vis, model, out);
+}
+
+/*
+===================
+Mod_ClearVisCache
+===================
+*/
+static void Mod_ClearVisCache (void)
+{
+	memset (mod_viscache, 0, sizeof (mod_viscache));
+}
+
+/*
+===================
+Mod_LeafPVS
+
+The returned row stays valid until VISCACHE_WAYS more rows that map to the
+same cache set have been decompressed
+===================
+*/
 byte *Mod_LeafPVS (mleaf_t *leaf, qmodel_t *model)
 {
+	viscacheentry_t	*set, *victim;
+	byte			*row;
+	int				i, leafnum, rowsize;
+
 	if (leaf == model->leafs)
 		return Mod_NoVisPVS (model);
-	return Mod_DecompressVis (leaf->compressed_vis, model);
+
+	rowsize = (((model->numleafs + 7) >> 3) + 15) & ~15;
+	if (rowsize > mod_viscache_rowsize)
+	{
+		mod_viscache_rowsize = rowsize;
+		mod_viscache_rows = (byte *) realloc (mod_viscache_rows, VISCACHE_SETS * VISCACHE_WAYS * rowsize);
+		if (!mod_viscache_rows)
+			Sys_Error ("Mod_LeafPVS: realloc() failed on %d bytes", VISCACHE_SETS * VISCACHE_WAYS * rowsize);
+		Mod_ClearVisCache ();
+	}
+
+	leafnum = leaf - model->leafs;
+	set = mod_viscache[leafnum & (VISCACHE_SETS - 1)];
+	victim = &set[0];
+	for (i = 0; i < VISCACHE_WAYS; i++)
+	{
+		if (set[i].model == model && set[i].leafnum == leafnum)
+		{
+			set[i].lastused = ++mod_viscache_clock;
+			return mod_viscache_rows + ((set + i) - &mod_viscache[0][0]) * mod_viscache_rowsize;
+		}
+		if (set[i].lastused < victim->lastused)
+			victim = &set[i];
+	}
+
+	row = mod_viscache_rows + (victim - &mod_viscache[0][0]) * mod_viscache_rowsize;
+	memcpy (row, Mod_DecompressVis (leaf->compressed_vis, model), (model->numleafs + 7) >> 3);
+	victim->model = model;
+	victim->leafnum = leafnum;
+	victim->lastused = ++mod_viscache_clock;
+
+	return row;
 }
 
 byte *Mod_NoVisPVS (qmodel_t *model)
@@ -234,6 +335,8 @@ void Mod_ClearAll (void)
 			TexMgr_FreeTexturesForOwner (mod); //johnfitz
 		}
 	}
+
+	Mod_ClearVisCache ();
 }
 
 void Mod_ResetAll (void)
@@ -251,6 +354,8 @@ void Mod_ResetAll (void)
 		memset(mod, 0, sizeof(qmodel_t));
 	}
 	mod_numknown = 0;
+
+	Mod_ClearVisCache ();
 }
 
 /*
@@ -2286,6 +2391,8 @@ static void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 	dmodel_t 	*bm;
 	float		radius; //johnfitz
 
+	Mod_ClearVisCache ();
+
 	loadmodel->type = mod_brush;
 
 	header = (dheader_t *)buffer;
@@ -31,6 +31,7 @@ int			r_visframecount;	// bumped when going to a new PVS
 int			r_framecount;		// used for dlight push checking
 
 mplane_t	frustum[4];
+static frustum4_t	frustum4;
 float		r_matview[16];
 float		r_matproj[16];
 float		r_matviewproj[16];
@@ -352,21 +353,7 @@ Returns true if the box is completely outside the frustum
 */
 qboolean R_CullBox (vec3_t emins, vec3_t emaxs)
 {
-	int i;
-	mplane_t *p;
-	byte signbits;
-	float vec[3];
-	for (i = 0;i < 4;i++)
-	{
-		p = frustum + i;
-		signbits = p->signbits;
-		vec[0] = ((signbits & 1) ? emins : emaxs)[0];
-		vec[1] = ((signbits & 2) ? emins : emaxs)[1];
-		vec[2] = ((signbits & 4) ? emins : emaxs)[2];
-		if (p->normal[0]*vec[0] + p->normal[1]*vec[1] + p->normal[2]*vec[2] < p->dist)
-			return true;
-	}
-	return false;
+	return Frustum_CullBox (&frustum4, emins, emaxs);
 }
 
 /*
@@ -568,6 +555,9 @@ static uint32_t visedict_keys[MAX_VISEDICTS];
 static uint16_t visedict_order[2][MAX_VISEDICTS];
 static entity_t *cl_sorted_visedicts[MAX_VISEDICTS + 1]; // +1 for worldspawn
 static int cl_modtype_ofs[mod_numtypes*2 + 1]; // x2: opaque/translucent; +1: total in last slot
+static vec3_t visedict_mins[MAX_VISEDICTS];
+static vec3_t visedict_maxs[MAX_VISEDICTS];
+static byte visedict_culled[MAX_VISEDICTS];
 
 typedef struct framesetup_s
 {
@@ -598,12 +588,33 @@ static void R_SortEntities (void)
 		entity_t *ent = cl_visedicts[i];
 		if (!ent->model || ent->alpha == ENTALPHA_ZERO)
 			continue;
-		if (ent->model->type == mod_brush && R_CullModelForEntity (ent))
-			continue;
 		cl_visedicts[j++] = ent;
 	}
 	cl_numvisedicts = j;
 
+	// frustum cull brush entities in one batch
+	for (i = 0, j = 0; i < cl_numvisedicts; i++)
+	{
+		entity_t *ent = cl_visedicts[i];
+		if (ent->model->type == mod_brush)
+		{
+			R_GetEntityBounds (ent, visedict_mins[j], visedict_maxs[j]);
+			j++;
+		}
+	}
+	if (j && Frustum_CullBoxes (&frustum4, (const vec3_t *) visedict_mins, (const vec3_t *) visedict_maxs, j, visedict_culled))
+	{
+		int brushnum = 0;
+		for (i = 0, j = 0; i < cl_numvisedicts; i++)
+		{
+			entity_t *ent = cl_visedicts[i];
+			if (ent->model->type == mod_brush && visedict_culled[brushnum++])
+				continue;
+			cl_visedicts[j++] = ent;
+		}
+		cl_numvisedicts = j;
+	}
+
 	memset (typebins, 0, sizeof(typebins));
 	if (r_drawworld.value)
 		typebins[mod_brush * 2 + 0]++; // count worldspawn
@@ -810,6 +821,7 @@ void R_SetFrustum (void)
 	ExtractFrustumPlane (r_matviewproj, 0, -1.f, false, &frustum[1]); // left
 	ExtractFrustumPlane (r_matviewproj, 1, -1.f, false, &frustum[2]); // bottom
 	ExtractFrustumPlane (r_matviewproj, 1,  1.f, true,  &frustum[3]); // top
+	Frustum_Setup (&frustum4, frustum);
 
 	logznear = log2f (znear);
 	logzfar = log2f (zfar);
@@ -1580,6 +1592,50 @@ void R_WarpScaleView (void)
 	GL_EndGroup ();
 }
 
+/*
+============
+V_PolyBlend -- johnfitz -- moved here from gl_rmain.c
+
+Lives with the renderer so that view.c stays free of GL calls
+============
+*/
+void V_PolyBlend (void)
+{
+	if (!gl_polyblend.value || !v_blend[3])
+		return;
+
+	if (softemu)
+	{
+		// If softemu is active then it's generally best to perform color shifting through
+		// palette remapping, which is consistent with the old software renderers, and also
+		// avoids palettization artifacts (e.g. underwater).
+
+		// However, a black v_cshift is sometimes used as a background for centerprint text
+		// to make it easier to read (e.g. books in Arcane Dimensions). Applying the effect
+		// at the end of the frame would defeat its purpose (and make the UI harder to use),
+		// so we detect this case and apply the effect here.
+		int maxcolor = q_max (cshift_empty.destcolor[0], q_max (cshift_empty.destcolor[1], cshift_empty.destcolor[2]));
+		if (!cshift_empty.percent || maxcolor > 0)
+			return;
+	}
+	else
+	{
+		// If we're already rendering to an intermediate FBO (for warp/scale/MSAA)
+		// then we can apply the color blending when blitting the intermediate texture
+		// (to save the memory bandwidth an extra full-screen alpha blend would consume)
+		if (GL_NeedsSceneEffects ())
+			return;
+	}
+
+	GL_UseProgram (glprogs.viewblend);
+	GL_SetState (GLS_BLEND_ALPHA | GLS_NO_ZTEST | GLS_NO_ZWRITE | GLS_CULL_NONE | GLS_ATTRIBS(0));
+	GL_Uniform4fvFunc (0, 1, v_blend);
+
+	glDrawArrays (GL_TRIANGLES, 0, 3);
+
+	v_blend[3] = 0.f; // make sure this doesn't get applied again later in the pipeline
+}
+
 /*
 ================
 R_RenderView
@@ -51,6 +51,7 @@ extern cvar_t r_oit;
 extern cvar_t r_simd;
 #endif
 qboolean use_simd;
+qboolean use_avx2;
 
 extern gltexture_t *playertextures[MAX_SCOREBOARD]; //johnfitz
 
@@ -147,6 +148,100 @@ static void R_SIMD_f (cvar_t *var)
 #else
 	#error not implemented
 #endif
+#if defined(USE_AVX2)
+	use_avx2 = use_simd && SDL_HasAVX2();
+#endif
+}
+
+/*
+====================
+R_SIMDBench_f
+
+Times the scalar and vectorized frustum culling paths on the same random
+boxes and checks that they agree
+====================
+*/
+static void R_SIMDBench_f (void)
+{
+	enum { NUMBOXES = 4096, NUMLEVELS = 3 };
+	static const char *levelnames[NUMLEVELS] = {"scalar", "sse2", "avx2"};
+	static vec3_t mins[NUMBOXES], maxs[NUMBOXES];
+	static byte culled[NUMLEVELS][NUMBOXES];
+	qboolean saved_simd = use_simd, saved_avx2 = use_avx2;
+	qboolean available[NUMLEVELS];
+	qboolean mismatch;
+	mplane_t planes[4];
+	frustum4_t f;
+	double start, batchtime, singletime;
+	unsigned int seed = 0x12345678;
+	int i, j, iter, level, iterations, total, single;
+
+	iterations = Cmd_Argc () > 1 ? q_max (Q_atoi (Cmd_Argv (1)), 1) : 1000;
+
+	// 90 degree frustum looking down +x
+	for (i = 0; i < 4; i++)
+	{
+		VectorCopy (vec3_origin, planes[i].normal);
+		planes[i].normal[0] = 0.70710678f;
+		planes[i].normal[1 + (i >> 1)] = (i & 1) ? -0.70710678f : 0.70710678f;
+		planes[i].dist = 0.f;
+		planes[i].type = PLANE_ANYZ;
+		planes[i].signbits = SignbitsForPlane (&planes[i]);
+	}
+	Frustum_Setup (&f, planes);
+
+	for (i = 0; i < NUMBOXES; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			mins[i][j] = (float)((seed >> 8) % 4096) - 2048.f;
+			maxs[i][j] = mins[i][j] + (float)((seed >> 20) % 128) + 1.f;
+		}
+	}
+
+	available[0] = true;
+	available[1] = SDL_HasSSE () && SDL_HasSSE2 ();
+#if defined(USE_AVX2)
+	available[2] = available[1] && SDL_HasAVX2 ();
+#else
+	available[2] = false;
+#endif
+
+	for (level = 0; level < NUMLEVELS; level++)
+	{
+		if (!available[level])
+		{
+			Con_Printf ("%-6s: not available\n", levelnames[level]);
+			continue;
+		}
+		use_simd = level >= 1;
+		use_avx2 = level >= 2;
+
+		start = Sys_DoubleTime ();
+		for (iter = 0, total = 0; iter < iterations; iter++)
+			total = Frustum_CullBoxes (&f, (const vec3_t *) mins, (const vec3_t *) maxs, NUMBOXES, culled[level]);
+		batchtime = Sys_DoubleTime () - start;
+
+		start = Sys_DoubleTime ();
+		for (iter = 0, mismatch = false; iter < iterations; iter++)
+		{
+			for (i = 0, single = 0; i < NUMBOXES; i++)
+				single += Frustum_CullBox (&f, mins[i], maxs[i]);
+			mismatch |= single != total;	// per pass, a running sum overflows
+		}
+		singletime = Sys_DoubleTime () - start;
+
+		Con_Printf ("%-6s: batch %7.3f ns/box, single %7.3f ns/box, %d/%d culled%s\n",
+			levelnames[level],
+			batchtime * 1e9 / ((double) iterations * NUMBOXES),
+			singletime * 1e9 / ((double) iterations * NUMBOXES),
+			total, NUMBOXES,
+			(memcmp (culled[level], culled[0], NUMBOXES) || mismatch) ? " MISMATCH" : "");
+	}
+
+	use_simd = saved_simd;
+	use_avx2 = saved_avx2;
 }
 #endif
 
@@ -242,6 +337,7 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_simd);
 	Cvar_SetCallback (&r_simd, R_SIMD_f);
 	R_SIMD_f(&r_simd);
+	Cmd_AddCommand ("r_simdbench", R_SIMDBench_f);
 #endif
 	Cvar_RegisterVariable (&r_speeds);
 	Cvar_RegisterVariable (&r_pos);
@@ -435,6 +531,7 @@ R_NewMap
 */
 void R_NewMap (void)
 {
+	extern fatpvs_t r_waterfatpvs;
 	int		i;
 
 	for (i=0 ; i<256 ; i++)
@@ -442,6 +539,7 @@ void R_NewMap (void)
 
 	R_ClearEfrags ();
 	r_viewleaf = NULL;
+	SV_ClearFatPVS (&r_waterfatpvs);
 	R_ClearParticles ();
 
 	GL_BuildLightmaps ();
@@ -877,7 +877,7 @@ SCR_DrawDevStats
 void SCR_DrawDevStats (void)
 {
 	char	str[40];
-	int		y = 25-10; //10=number of lines to print
+	int		y = 25-12; //12=number of lines to print
 	int		x = 0; //margin
 
 	if (!devstats.value)
@@ -885,7 +885,7 @@ void SCR_DrawDevStats (void)
 
 	GL_SetCanvas (CANVAS_BOTTOMLEFT);
 
-	Draw_Fill (x, y*8, 21*8, 10*8, 0, 0.5); //dark rectangle
+	Draw_Fill (x, y*8, 21*8, 12*8, 0, 0.5); //dark rectangle
 
 	sprintf (str, "devstats | Curr  Peak");
 	Draw_String (x, (y++)*8-x, str);
@@ -916,6 +916,12 @@ void SCR_DrawDevStats (void)
 
 	sprintf (str, "GL upload|%4iK %4iK", dev_stats.gpu_upload/1024, dev_peakstats.gpu_upload/1024);
 	Draw_String (x, (y++)*8-x, str);
+
+	sprintf (str, "Relinks  |%5i %5i", dev_stats.relinks, dev_peakstats.relinks);
+	Draw_String (x, (y++)*8-x, str);
+
+	sprintf (str, "Skipped  |%5i %5i", dev_stats.relinks_skipped, dev_peakstats.relinks_skipped);
+	Draw_String (x, (y++)*8-x, str);
 }
 
 /*
@@ -69,6 +69,7 @@ extern	int		r_framecount;
 extern	mplane_t	frustum[4];
 
 extern	qboolean use_simd;
+extern	qboolean use_avx2;
 
 //
 // view origin
@@ -330,6 +331,8 @@ typedef struct {
 	int		beams;
 	int		dlights;
 	int		gpu_upload;
+	int		relinks;
+	int		relinks_skipped;
 } devstats_t;
 extern devstats_t dev_stats, dev_peakstats;
 
@@ -417,6 +420,7 @@ extern gpuframedata_t r_framedata;
 void R_AnimateLight (void);
 void R_MarkSurfaces (void);
 qboolean R_CullBox (vec3_t emins, vec3_t emaxs);
+int SignbitsForPlane (mplane_t *out);
 qboolean R_CullModelForEntity (entity_t *e);
 void R_EntityMatrix (float matrix[16], vec3_t origin, vec3_t angles, unsigned char scale);
 
@@ -615,6 +619,8 @@ void GL_AcquireFrameResources (void);
 void GL_ReleaseFrameResources (void);
 void GL_AddGarbageBuffer (GLuint handle);
 
+void V_PolyBlend (void);
+
 qboolean GL_NeedsSceneEffects (void);
 qboolean GL_NeedsPostprocess (void);
 void GL_PostProcess (void);
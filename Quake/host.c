@@ -66,6 +66,8 @@ cvar_t	max_edicts = {"max_edicts", "16384", CVAR_NONE}; //johnfitz //ericw -- ch
 cvar_t	cl_nocsqc = {"cl_nocsqc", "0", CVAR_NONE};	//spike -- blocks the loading of any csqc modules
 
 cvar_t	sys_ticrate = {"sys_ticrate","0.05",CVAR_NONE}; // dedicated server
+cvar_t	sys_eventloop = {"sys_eventloop","1",CVAR_NONE}; // dedicated server, wake up as soon as packets arrive
+cvar_t	sys_minticrate = {"sys_minticrate","0.01",CVAR_NONE}; // dedicated server, shortest time between reads of client input woken up by packets
 cvar_t	serverprofile = {"serverprofile","0",CVAR_NONE};
 
 cvar_t	fraglimit = {"fraglimit","0",CVAR_NOTIFY|CVAR_SERVERINFO};
@@ -190,7 +192,10 @@ void Host_Error (const char *error, ...)
 	Con_Printf ("Host_Error: %s\n",string);
 
 	if (sv.active)
+	{
+		SV_MetricsFlush ();
 		Host_ShutdownServer (false);
+	}
 
 	if (cls.state == ca_dedicated)
 		Sys_Error ("Host_Error: %s\n",string);	// dedicated servers exit
@@ -352,6 +357,8 @@ void Host_InitLocal (void)
 	Cvar_RegisterVariable (&cl_titlestats);
 
 	Cvar_RegisterVariable (&sys_ticrate);
+	Cvar_RegisterVariable (&sys_eventloop);
+	Cvar_RegisterVariable (&sys_minticrate);
 	Cvar_RegisterVariable (&serverprofile);
 
 	Cvar_RegisterVariable (&fraglimit);
@@ -917,11 +924,26 @@ void Host_ServerFrame (void)
 	int		i, active; //johnfitz
 	edict_t	*ent; //johnfitz
 
+// an empty hibernating server only accepts new clients
+	if (SV_UpdateHibernation ())
+	{
+		SV_ClearDatagram ();
+		SV_CheckForNewClients ();
+		return;
+	}
+
+	SV_RecordTick ();
+	SV_MetricsBeginTick ();
+	SV_ProfileBeginTick ();
+
 // run the world state
 	pr_global_struct->frametime = host_frametime;
 
 // set the time and clear the general datagram
 	SV_ClearDatagram ();
+	dev_stats.relinks = dev_stats.relinks_skipped = 0;
+
+	SV_ProfileEnter (SVPROF_CLIENTS);
 
 // check for new clients
 	SV_CheckForNewClients ();
@@ -929,6 +951,8 @@ void Host_ServerFrame (void)
 // read client messages
 	SV_RunClients ();
 
+	SV_ProfileLeave ();
+
 // move things around and think
 // always pause in single player if in console or menus
 	if (!sv.paused && (svs.maxclients > 1 || key_dest == key_game) )
@@ -947,13 +971,48 @@ void Host_ServerFrame (void)
 			Con_DWarning ("%i edicts exceeds standard limit of 600 (max = %d).\n", active, qcvm->max_edicts);
 		dev_stats.edicts = active;
 		dev_peakstats.edicts = q_max(active, dev_peakstats.edicts);
+		dev_peakstats.relinks = q_max(dev_stats.relinks, dev_peakstats.relinks);
+		dev_peakstats.relinks_skipped = q_max(dev_stats.relinks_skipped, dev_peakstats.relinks_skipped);
 	}
 //johnfitz
 
 // send all messages to the clients
+	SV_ProfileEnter (SVPROF_SEND);
 	SV_SendClientMessages ();
+	SV_ProfileLeave ();
 
 	Host_CheckAutosave ();
+
+	SV_ProfileEndTick ();
+	SV_MetricsEndTick ();
+}
+
+/*
+==================
+Host_ServerInput
+
+Runs when a dedicated server wakes up between ticks: executes console
+commands and reads what the clients sent.  The world is still only run
+and sent to the clients every sys_ticrate, by Host_Frame.
+==================
+*/
+void Host_ServerInput (void)
+{
+	if (setjmp (host_abortserver) )
+		return;			// something bad happened, or the server disconnected
+
+	Host_GetConsoleCommands ();
+	Cbuf_Execute ();
+
+	NET_Poll ();
+
+	// recordings must see every move in the tick it is run in
+	if (!sv.active || SV_BenchRecording ())
+		return;
+
+	PR_SwitchQCVM (&sv.qcvm);
+	SV_ReadClients ();
+	PR_SwitchQCVM (NULL);
 }
 
 typedef struct summary_s {
@@ -1180,6 +1239,8 @@ void _Host_Frame (double time)
 		CL_LoadCSProgs();
 
 		cl.sendprespawn = false;
+		if (cl.protocolflags & PRFL_DEFLATE)
+			MSG_WriteByte (&cls.message, clc_deflate);	// before prespawn, so the signon buffers can be compressed
 		MSG_WriteByte (&cls.message, clc_stringcmd);
 		MSG_WriteString (&cls.message, "prespawn");
 		vid.recalc_refdef = true;
@@ -1207,6 +1268,7 @@ void _Host_Frame (double time)
 		{
 			PR_SwitchQCVM(&sv.qcvm);
 			Host_ServerFrame ();
+			SV_MetricsFrame ();
 			PR_SwitchQCVM(NULL);
 		}
 		host_frametime = realframetime;
@@ -1351,6 +1413,7 @@ void Host_Init (void)
 	PR_Init ();
 	Mod_Init ();
 	NET_Init ();
+	Tasks_Init ();
 	SV_Init ();
 
 	Con_Printf ("Exe: " __TIME__ " " __DATE__ " (%s %d-bit)\n", SDL_GetPlatform (), (int)sizeof(void*)*8);
@@ -1440,7 +1503,9 @@ void Host_Shutdown(void)
 // stop downloads before shutting down networking
 	Modlist_ShutDown ();
 
+	SV_MetricsShutdown ();
 	NET_Shutdown ();
+	Tasks_Shutdown ();
 
 	if (cls.state != ca_dedicated)
 	{
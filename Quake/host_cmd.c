@@ -1594,6 +1594,8 @@ static void Host_Status_f (void)
 	if (ipxAvailable)
 		print_fn ("ipx:     %s\n", my_ipx_address);
 	print_fn ("map:     %s\n", sv.name);
+	if (svs.hibernating || svs.hibernatetotal)
+		print_fn ("asleep:  %s, %.0f seconds in total\n", svs.hibernating ? "hibernating" : "awake", SV_HibernationTime ());
 	print_fn ("players: %i active (%i max)\n\n", net_activeconnections, svs.maxclients);
 	for (j = 0, client = svs.clients; j < svs.maxclients; j++, client++)
 	{
@@ -2659,6 +2661,7 @@ static void Host_Loadgame_f (void)
 
 	qcvm->num_edicts = entnum;
 	qcvm->time = time;
+	sv.physlistsvalid = false;	// edicts were restored without ED_Alloc
 	sv.autosave.time = time;
 
 	free (start);
@@ -2727,6 +2730,32 @@ static void Host_Name_f (void)
 	MSG_WriteString (&sv.reliable_datagram, host_client->name);
 }
 
+/*
+======================
+Host_Rate_f
+
+Sets the bytes per second the server may send, 0 for its default
+======================
+*/
+static void Host_Rate_f (void)
+{
+	if (Cmd_Argc () == 1)
+	{
+		Con_Printf ("\"rate\" is \"%s\"\n", cl_rate.string);
+		return;
+	}
+
+	if (cmd_source == src_command)
+	{
+		Cvar_Set ("_cl_rate", Cmd_Argv (1));
+		if (cls.state == ca_connected)
+			Cmd_ForwardToServer ();
+		return;
+	}
+
+	host_client->rate = q_max (0, atoi (Cmd_Argv (1)));
+}
+
 static void Host_Say(qboolean teamonly)
 {
 	int		j;
@@ -3738,6 +3767,7 @@ void Host_InitCommands (void)
 	Cmd_AddCommand ("connect", Host_Connect_f);
 	Cmd_AddCommand_Console ("reconnect", Host_Reconnect_f);
 	Cmd_AddCommand_ClientCommand ("name", Host_Name_f);
+	Cmd_AddCommand_ClientCommand ("rate", Host_Rate_f);
 	Cmd_AddCommand_ClientCommand ("noclip", Host_Noclip_f);
 	Cmd_AddCommand_ClientCommand ("setpos", Host_SetPos_f); //QuakeSpasm
 
@@ -0,0 +1,62 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// in_null.c -- input backend for builds without a window
+
+#include "quakedef.h"
+
+void IN_Init (void)
+{
+}
+
+void IN_Shutdown (void)
+{
+}
+
+void IN_Commands (void)
+{
+}
+
+void IN_SendKeyEvents (void)
+{
+}
+
+void IN_UpdateInputMode (void)
+{
+}
+
+enum textmode_t IN_GetTextMode (void)
+{
+	return TEXTMODE_OFF;
+}
+
+void IN_Move (usercmd_t *cmd)
+{
+}
+
+void IN_Activate (void)
+{
+}
+
+void IN_DeactivateForConsole (void)
+{
+}
+
+void IN_DeactivateForMenu (void)
+{
+}
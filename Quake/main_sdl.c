@@ -114,8 +114,74 @@ static double Sys_Throttle (double oldtime)
 	return Sys_WaitUntil (oldtime + Host_GetFrameInterval ());
 }
 
+#define HIBERNATE_TICRATE	1.0	// seconds between frames of a hibernating server
+
+static double Sys_TicRate (void)
+{
+	return svs.hibernating ? HIBERNATE_TICRATE : sys_ticrate.value;
+}
+
+/*
+==================
+Sys_WaitForTick
+
+Lets a dedicated server sleep until its next tick, waking up early when a
+packet or a console command arrives at least sys_minticrate after the
+previous wakeup.  Returns false if the input can't be waited for, the
+caller then sleeps until the tick.
+==================
+*/
+static qboolean Sys_WaitForTick (double oldtime, double lastwake)
+{
+#ifdef _WIN32
+	return false;
+#else
+	int		fds[64];
+	int		numfds;
+
+	if (!sys_eventloop.value)
+		return false;
+
+	Sys_WaitUntil (q_min (lastwake + sys_minticrate.value, oldtime + Sys_TicRate ()));
+
+	numfds = NET_GetPollSockets (fds, countof (fds));
+	if (numfds < 0)
+		return false;
+	return Sys_WaitForInput (fds, numfds, oldtime + Sys_TicRate ());
+#endif
+}
+
 #define DEFAULT_MEMORY (384 * 1024 * 1024) // ericw -- was 72MB (64-bit) / 64MB (32-bit)
 
+#ifdef SERVERONLY
+/*
+==================
+Sys_ForceDedicated
+
+Server-only builds have no video, input or sound backend, so they always
+run as if started with -dedicated
+==================
+*/
+static char **Sys_ForceDedicated (int *argc, char **argv)
+{
+	static char	*dedargv[MAX_NUM_ARGVS + 1];
+	int			i;
+
+	for (i = 1; i < *argc; i++)
+		if (!strcmp (argv[i], "-dedicated"))
+			return argv;
+
+	dedargv[0] = argv[0];
+	dedargv[1] = (char *) "-dedicated";
+	for (i = 1; i < *argc && i < MAX_NUM_ARGVS - 1; i++)
+		dedargv[i + 1] = argv[i];
+	*argc = i + 1;
+	dedargv[*argc] = NULL;
+
+	return dedargv;
+}
+#endif
+
 static quakeparms_t	parms;
 
 // On OS X we call SDL_main from the launcher, but SDL2 doesn't redefine main
@@ -127,7 +193,11 @@ static quakeparms_t	parms;
 int main(int argc, char *argv[])
 {
 	int		t;
-	double		time, oldtime, newtime;
+	double		time, oldtime, newtime, waketime;
+
+#ifdef SERVERONLY
+	argv = Sys_ForceDedicated (&argc, argv);
+#endif
 
 	host_parms = &parms;
 	parms.basedir = ".";
@@ -166,23 +236,38 @@ int main(int argc, char *argv[])
 	oldtime = Sys_DoubleTime();
 	if (isDedicated)
 	{
+		waketime = oldtime;
 		while (1)
 		{
-			newtime = Sys_DoubleTime ();
-			time = newtime - oldtime;
-
-			while (time < sys_ticrate.value )
+			if (Sys_WaitForTick (oldtime, waketime))
+			{
+				// input between ticks is only read, the world still
+				// runs and goes out to the clients every sys_ticrate
+				waketime = Sys_DoubleTime ();
+				if (waketime - oldtime < Sys_TicRate ())
+				{
+					Host_ServerInput ();
+					continue;
+				}
+			}
+			else
 			{
-				SDL_Delay(1);
 				newtime = Sys_DoubleTime ();
 				time = newtime - oldtime;
+
+				while (time < Sys_TicRate ())
+				{
+					SDL_Delay(1);
+					newtime = Sys_DoubleTime ();
+					time = newtime - oldtime;
+				}
 			}
 
 			newtime = Sys_Throttle (oldtime);
 			time = newtime - oldtime;
 
 			Host_Frame (time);
-			oldtime = newtime;
+			oldtime = waketime = newtime;
 		}
 	}
 	else
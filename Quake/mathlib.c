@@ -789,3 +789,208 @@ void MatrixTranspose4x3(const float src[16], float dst[12])
 
 	#undef COPY_ROW
 }
+
+/*
+===============================================================================
+
+FRUSTUM CULLING
+
+Frustum_CullBox and Frustum_CullBoxes test axial boxes against four planes
+in a structure-of-arrays layout.  The SSE2 path tests one box against all
+four planes at once, the batch paths test four (SSE2) or eight (AVX2) boxes
+against one plane at a time.  All paths use the same operation order as the
+scalar code, so they give identical results.
+
+===============================================================================
+*/
+
+/*
+=================
+Frustum_Setup
+=================
+*/
+void Frustum_Setup (frustum4_t *f, const mplane_t *planes)
+{
+	int i, j;
+
+	for (i = 0; i < 4; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			f->normal[j][i] = planes[i].normal[j];
+			f->usemin[j][i] = (planes[i].signbits & (1 << j)) ? -1 : 0;
+		}
+		f->dist[i] = planes[i].dist;
+		f->signbits[i] = planes[i].signbits;
+	}
+}
+
+/*
+=================
+Frustum_CullBoxScalar
+=================
+*/
+static qboolean Frustum_CullBoxScalar (const frustum4_t *f, const vec3_t emins, const vec3_t emaxs)
+{
+	int i;
+	float vec[3];
+
+	for (i = 0; i < 4; i++)
+	{
+		vec[0] = ((f->signbits[i] & 1) ? emins : emaxs)[0];
+		vec[1] = ((f->signbits[i] & 2) ? emins : emaxs)[1];
+		vec[2] = ((f->signbits[i] & 4) ? emins : emaxs)[2];
+		if (f->normal[0][i]*vec[0] + f->normal[1][i]*vec[1] + f->normal[2][i]*vec[2] < f->dist[i])
+			return true;
+	}
+	return false;
+}
+
+/*
+=================
+Frustum_CullBox
+
+Returns true if the box is completely outside the frustum
+=================
+*/
+qboolean Frustum_CullBox (const frustum4_t *f, const vec3_t emins, const vec3_t emaxs)
+{
+#ifdef USE_SSE2
+	if (use_simd)
+	{
+		__m128 d, sel, mask;
+
+		#define SELECT(j) \
+			(mask = _mm_castsi128_ps (_mm_loadu_si128 ((const __m128i *) f->usemin[j])), \
+			 _mm_or_ps (_mm_and_ps (mask, _mm_set1_ps (emins[j])), _mm_andnot_ps (mask, _mm_set1_ps (emaxs[j]))))
+
+		sel = SELECT (0);
+		d = _mm_mul_ps (_mm_loadu_ps (f->normal[0]), sel);
+		sel = SELECT (1);
+		d = _mm_add_ps (d, _mm_mul_ps (_mm_loadu_ps (f->normal[1]), sel));
+		sel = SELECT (2);
+		d = _mm_add_ps (d, _mm_mul_ps (_mm_loadu_ps (f->normal[2]), sel));
+
+		#undef SELECT
+
+		return _mm_movemask_ps (_mm_cmplt_ps (d, _mm_loadu_ps (f->dist))) != 0;
+	}
+#endif
+
+	return Frustum_CullBoxScalar (f, emins, emaxs);
+}
+
+#ifdef USE_SSE2
+/*
+=================
+Frustum_CullBoxesSSE2
+=================
+*/
+static int Frustum_CullBoxesSSE2 (const frustum4_t *f, const vec3_t *mins, const vec3_t *maxs, int count, byte *culled)
+{
+	int i, j, p, bits, total = 0;
+	__m128 lo[3], hi[3], d;
+
+	for (i = 0; i + 4 <= count; i += 4)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			lo[j] = _mm_setr_ps (mins[i][j], mins[i+1][j], mins[i+2][j], mins[i+3][j]);
+			hi[j] = _mm_setr_ps (maxs[i][j], maxs[i+1][j], maxs[i+2][j], maxs[i+3][j]);
+		}
+
+		bits = 0;
+		for (p = 0; p < 4; p++)
+		{
+			#define TERM(j) _mm_mul_ps (_mm_set1_ps (f->normal[j][p]), f->usemin[j][p] ? lo[j] : hi[j])
+			d = _mm_add_ps (_mm_add_ps (TERM (0), TERM (1)), TERM (2));
+			#undef TERM
+			bits |= _mm_movemask_ps (_mm_cmplt_ps (d, _mm_set1_ps (f->dist[p])));
+		}
+
+		for (j = 0; j < 4; j++)
+		{
+			culled[i + j] = (bits >> j) & 1;
+			total += culled[i + j];
+		}
+	}
+
+	for (; i < count; i++)
+	{
+		culled[i] = Frustum_CullBoxScalar (f, mins[i], maxs[i]);
+		total += culled[i];
+	}
+
+	return total;
+}
+#endif
+
+#ifdef USE_AVX2
+/*
+=================
+Frustum_CullBoxesAVX2
+=================
+*/
+FUNC_TARGET_AVX2 static int Frustum_CullBoxesAVX2 (const frustum4_t *f, const vec3_t *mins, const vec3_t *maxs, int count, byte *culled)
+{
+	int i, j, p, bits, total = 0;
+	__m256 lo[3], hi[3], d;
+	const __m256i stride = _mm256_setr_epi32 (0, 3, 6, 9, 12, 15, 18, 21);
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			lo[j] = _mm256_i32gather_ps (&mins[i][j], stride, 4);
+			hi[j] = _mm256_i32gather_ps (&maxs[i][j], stride, 4);
+		}
+
+		bits = 0;
+		for (p = 0; p < 4; p++)
+		{
+			#define TERM(j) _mm256_mul_ps (_mm256_set1_ps (f->normal[j][p]), f->usemin[j][p] ? lo[j] : hi[j])
+			d = _mm256_add_ps (_mm256_add_ps (TERM (0), TERM (1)), TERM (2));
+			#undef TERM
+			bits |= _mm256_movemask_ps (_mm256_cmp_ps (d, _mm256_set1_ps (f->dist[p]), _CMP_LT_OQ));
+		}
+
+		for (j = 0; j < 8; j++)
+		{
+			culled[i + j] = (bits >> j) & 1;
+			total += culled[i + j];
+		}
+	}
+
+	return total + Frustum_CullBoxesSSE2 (f, mins + i, maxs + i, count - i, culled + i);
+}
+#endif
+
+/*
+=================
+Frustum_CullBoxes
+
+Sets culled[i] to 1 for every box that is completely outside the frustum
+and to 0 otherwise.  Returns the number of culled boxes.
+=================
+*/
+int Frustum_CullBoxes (const frustum4_t *f, const vec3_t *mins, const vec3_t *maxs, int count, byte *culled)
+{
+	int i, total;
+
+#ifdef USE_AVX2
+	if (use_avx2)
+		return Frustum_CullBoxesAVX2 (f, mins, maxs, count, culled);
+#endif
+#ifdef USE_SSE2
+	if (use_simd)
+		return Frustum_CullBoxesSSE2 (f, mins, maxs, count, culled);
+#endif
+
+	for (i = 0, total = 0; i < count; i++)
+	{
+		culled[i] = Frustum_CullBoxScalar (f, mins[i], maxs[i]);
+		total += culled[i];
+	}
+
+	return total;
+}
@@ -109,6 +109,19 @@ void AngleVectors (vec3_t angles, vec3_t forward, vec3_t right, vec3_t up);
 int BoxOnPlaneSide (vec3_t emins, vec3_t emaxs, struct mplane_s *plane);
 float	anglemod(float a);
 
+// four frustum planes in structure-of-arrays layout, see Frustum_Setup
+typedef struct frustum4_s
+{
+	float	normal[3][4];		// x, y and z components of the four plane normals
+	float	dist[4];
+	int		usemin[3][4];		// -1 where the corner nearest to the plane uses the mins
+	byte	signbits[4];
+} frustum4_t;
+
+void Frustum_Setup (frustum4_t *f, const struct mplane_s *planes);
+qboolean Frustum_CullBox (const frustum4_t *f, const vec3_t emins, const vec3_t emaxs);
+int Frustum_CullBoxes (const frustum4_t *f, const vec3_t *mins, const vec3_t *maxs, int count, byte *culled);
+
 void MatrixMultiply(float left[16], float right[16]);
 void RotationMatrix(float matrix[16], float angle, int axis);
 void TranslationMatrix(float matrix[16], float x, float y, float z);
@@ -143,6 +156,17 @@ void MatrixTranspose4x3(const float src[16], float dst[12]);
 	#include <emmintrin.h>
 #endif
 
+/* AVX2 code is compiled per function and only called after a runtime check */
+#if defined(USE_SSE2) && (defined(_MSC_VER) || defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5)))
+	#define USE_AVX2
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#define FUNC_TARGET_AVX2
+	#else
+		#define FUNC_TARGET_AVX2	__attribute__((target("avx2")))
+	#endif
+#endif
+
 /*==========================================================================*/
 
 #endif	/* __MATHLIB_H */
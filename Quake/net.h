@@ -58,6 +58,22 @@ struct qsocket_s	*NET_Connect (const char *host);
 double NET_QSocketGetTime (const struct qsocket_s *sock);
 const char *NET_QSocketGetAddressString (const struct qsocket_s *sock);
 
+typedef struct netstats_s
+{
+	uint64_t	bytesSent;			// including packet headers
+	uint64_t	bytesReceived;
+	int			packetsSent;
+	int			packetsReSent;
+	int			packetsReceived;
+	int			droppedDatagrams;	// gaps in the unreliable sequence
+	int			fastRetransmits;
+	int			retransmitTimeouts;
+} netstats_t;
+
+const netstats_t *NET_QSocketGetStats (const struct qsocket_s *sock);
+void NET_GetTotals (netstats_t *totals);
+// counters of one connection, and of all connections since startup
+
 qboolean NET_CanSendMessage (struct qsocket_s *sock);
 // Returns true or false if the given qsocket can currently accept a
 // message to be transmitted.
@@ -90,6 +106,13 @@ void	NET_Close (struct qsocket_s *sock);
 
 void	NET_Poll (void);
 
+void	NET_BeginSendBatch (void);
+void	NET_EndSendBatch (void);
+// everything sent in between may be held back and sent at the end
+
+int		NET_GetPollSockets (int *fds, int maxfds);
+// the sockets to wait on for incoming packets, -1 if that isn't enough
+
 
 // Server list related globals:
 extern	qboolean	slistInProgress;
@@ -0,0 +1,224 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// net_bench.c -- in-process clients driven by the server benchmark
+//
+// Bench clients have no real connection: the server benchmark queues the
+// messages a client would have sent, and everything the server sends back
+// is counted and discarded.
+
+#include "quakedef.h"
+#include "q_stdinc.h"
+#include "arch_def.h"
+#include "net_sys.h"
+#include "net_defs.h"
+#include "net_bench.h"
+
+static benchclient_t	*bench_clients = NULL;
+
+/*
+=================
+Bench_NewClient
+
+Queues a new connection, which the server picks up on its next
+SV_CheckForNewClients.  Messages can be queued right away.
+=================
+*/
+benchclient_t *Bench_NewClient (void)
+{
+	benchclient_t *bc;
+
+	bc = (benchclient_t *) calloc (1, sizeof (*bc));
+	if (!bc)
+		Sys_Error ("Bench_NewClient: out of memory");
+
+	bc->pending = true;
+	bc->next = bench_clients;
+	bench_clients = bc;
+
+	return bc;
+}
+
+/*
+=================
+Bench_FreeClient
+=================
+*/
+void Bench_FreeClient (benchclient_t *bc)
+{
+	benchclient_t **link;
+
+	if (bc->sock && !bc->closed)
+	{
+		bc->sock->driverdata = NULL;
+		bc->sock = NULL;
+	}
+
+	for (link = &bench_clients; *link; link = &(*link)->next)
+	{
+		if (*link == bc)
+		{
+			*link = bc->next;
+			break;
+		}
+	}
+
+	free (bc);
+}
+
+/*
+=================
+Bench_QueueMessage
+
+type is 1 for reliable and 2 for unreliable messages, as returned by
+NET_GetMessage
+=================
+*/
+qboolean Bench_QueueMessage (benchclient_t *bc, int type, const sizebuf_t *data)
+{
+	byte *buffer;
+
+	if (bc->closed || bc->inlen + data->cursize + 3 > (int) sizeof (bc->inbox))
+		return false;
+
+	buffer = bc->inbox + bc->inlen;
+	*buffer++ = type;
+	*buffer++ = data->cursize & 0xff;
+	*buffer++ = data->cursize >> 8;
+	memcpy (buffer, data->data, data->cursize);
+	bc->inlen += data->cursize + 3;
+
+	return true;
+}
+
+int Bench_Init (void)
+{
+	return 0;
+}
+
+void Bench_Shutdown (void)
+{
+}
+
+void Bench_Listen (qboolean state)
+{
+}
+
+void Bench_SearchForHosts (qboolean xmit)
+{
+}
+
+qsocket_t *Bench_Connect (const char *host)
+{
+	return NULL;
+}
+
+qsocket_t *Bench_CheckNewConnections (void)
+{
+	benchclient_t	*bc, *oldest;
+	qsocket_t		*sock;
+
+	// accept connections in the order they were queued
+	oldest = NULL;
+	for (bc = bench_clients; bc; bc = bc->next)
+		if (bc->pending)
+			oldest = bc;
+	if (!oldest)
+		return NULL;
+
+	if ((sock = NET_NewQSocket ()) == NULL)
+		return NULL;
+
+	oldest->pending = false;
+	oldest->sock = sock;
+	sock->driverdata = oldest;
+	q_strlcpy (sock->address, "BENCH", sizeof (sock->address));
+
+	return sock;
+}
+
+int Bench_GetMessage (qsocket_t *sock)
+{
+	benchclient_t	*bc = (benchclient_t *) sock->driverdata;
+	int				ret, length;
+
+	if (!bc)
+		return -1;
+	if (!bc->inlen)
+		return 0;
+
+	ret = bc->inbox[0];
+	length = bc->inbox[1] + (bc->inbox[2] << 8);
+	SZ_Clear (&net_message);
+	SZ_Write (&net_message, &bc->inbox[3], length);
+
+	length += 3;
+	bc->inlen -= length;
+	if (bc->inlen)
+		memmove (bc->inbox, &bc->inbox[length], bc->inlen);
+
+	return ret;
+}
+
+int Bench_SendMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	benchclient_t	*bc = (benchclient_t *) sock->driverdata;
+
+	if (!bc)
+		return -1;
+
+	bc->reliablemessages++;
+	bc->reliablebytes += data->cursize;
+	return 1;
+}
+
+int Bench_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	benchclient_t	*bc = (benchclient_t *) sock->driverdata;
+
+	if (!bc)
+		return -1;
+
+	bc->unreliablemessages++;
+	bc->unreliablebytes += data->cursize;
+	return 1;
+}
+
+qboolean Bench_CanSendMessage (qsocket_t *sock)
+{
+	return sock->driverdata != NULL;
+}
+
+qboolean Bench_CanSendUnreliableMessage (qsocket_t *sock)
+{
+	return true;
+}
+
+void Bench_Close (qsocket_t *sock)
+{
+	benchclient_t	*bc = (benchclient_t *) sock->driverdata;
+
+	if (bc)
+	{
+		bc->closed = true;
+		bc->sock = NULL;
+		bc->inlen = 0;
+	}
+	sock->driverdata = NULL;
+}
@@ -0,0 +1,56 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef __NET_BENCH_H
+#define __NET_BENCH_H
+
+// net_bench.h -- in-process clients driven by the server benchmark
+
+typedef struct benchclient_s
+{
+	struct benchclient_s	*next;
+	qsocket_t	*sock;			// NULL until the server accepts the connection
+	qboolean	pending;		// waiting for Bench_CheckNewConnections
+	qboolean	closed;			// the server dropped the connection
+
+	unsigned int	reliablemessages, reliablebytes;	// received from the server
+	unsigned int	unreliablemessages, unreliablebytes;
+
+	int		inlen;			// queued client->server messages
+	byte		inbox[NET_MAXMESSAGE];
+} benchclient_t;
+
+benchclient_t	*Bench_NewClient (void);
+void		Bench_FreeClient (benchclient_t *bc);
+qboolean	Bench_QueueMessage (benchclient_t *bc, int type, const sizebuf_t *data);
+
+int		Bench_Init (void);
+void		Bench_Listen (qboolean state);
+void		Bench_SearchForHosts (qboolean xmit);
+qsocket_t	*Bench_Connect (const char *host);
+qsocket_t	*Bench_CheckNewConnections (void);
+int		Bench_GetMessage (qsocket_t *sock);
+int		Bench_SendMessage (qsocket_t *sock, sizebuf_t *data);
+int		Bench_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data);
+qboolean	Bench_CanSendMessage (qsocket_t *sock);
+qboolean	Bench_CanSendUnreliableMessage (qsocket_t *sock);
+void		Bench_Close (qsocket_t *sock);
+void		Bench_Shutdown (void);
+
+#endif	/* __NET_BENCH_H */
@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "net_dgrm.h"
 #include "net_loop.h"
+#include "net_bench.h"
 
 net_driver_t net_drivers[] =
 {
@@ -60,6 +61,22 @@ net_driver_t net_drivers[] =
 		Datagram_CanSendUnreliableMessage,
 		Datagram_Close,
 		Datagram_Shutdown
+	},
+
+	{	"Bench",
+		false,
+		Bench_Init,
+		Bench_Listen,
+		Bench_SearchForHosts,
+		Bench_Connect,
+		Bench_CheckNewConnections,
+		Bench_GetMessage,
+		Bench_SendMessage,
+		Bench_SendUnreliableMessage,
+		Bench_CanSendMessage,
+		Bench_CanSendUnreliableMessage,
+		Bench_Close,
+		Bench_Shutdown
 	}
 };
 
@@ -89,7 +106,10 @@ net_landriver_t	net_landrivers[] =
 		UDP_GetAddrFromName,
 		UDP_AddrCompare,
 		UDP_GetSocketPort,
-		UDP_SetSocketPort
+		UDP_SetSocketPort,
+		UDP_BeginBatch,
+		UDP_EndBatch,
+		UDP_ListenSocket
 	}
 };
 
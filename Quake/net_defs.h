@@ -67,6 +67,8 @@ General notes:
 CCREQ_CONNECT
 		string	game_name		"QUAKE"
 		byte	net_protocol_version	NET_PROTOCOL_VERSION
+		[long	net_caps_magic]		NET_CAPS_MAGIC, only if net_caps follows
+		[byte	net_caps]		NET_CAP_* the client supports
 
 CCREQ_SERVER_INFO
 		string	game_name		"QUAKE"
@@ -80,6 +82,8 @@ CCREQ_RULE_INFO
 
 CCREP_ACCEPT
 		long	port
+		[long	net_caps_magic]		NET_CAPS_MAGIC, only sent back to clients that sent it
+		[byte	net_caps]		NET_CAP_* enabled for the connection
 
 CCREP_REJECT
 		string	reason
@@ -127,6 +131,12 @@ CCREP_RULE_INFO
 #define CCREP_PLAYER_INFO	0x84
 #define CCREP_RULE_INFO		0x85
 
+// connection capabilities, older peers ignore the trailing bytes.  ProQuake
+// puts its mod byte (MOD_PROQUAKE is 1) at the same spot, so the caps byte is
+// only trusted behind the magic, whose first byte is no ProQuake mod id.
+#define NET_CAPS_MAGIC		0x73706163	// "caps"
+#define NET_CAP_WINDOW		(1<<0)	// windowed reliable channel, see net_dgrm.c
+
 typedef struct qsocket_s
 {
 	struct qsocket_s	*next;
@@ -157,6 +167,18 @@ typedef struct qsocket_s
 	struct qsockaddr	addr;
 	char		address[NET_NAMELEN];
 
+	netstats_t	stats;
+
+	qboolean	windowed;		// NET_CAP_WINDOW was negotiated
+	struct netwindow_s	*window;
+
+	// connections sharing the driver's listen socket, see net_dgrm.c
+	qboolean	sharedsocket;
+	struct qsocket_s	*hashnext;
+	int		sharedpollgen;
+	byte		*inpackets;		// datagrams demultiplexed to this connection
+	int		inread, inlen, insize;
+
 } qsocket_t;
 
 extern qsocket_t	*net_activeSockets;
@@ -186,6 +208,9 @@ typedef struct
 	int		(*AddrCompare) (struct qsockaddr *addr1, struct qsockaddr *addr2);
 	int		(*GetSocketPort) (struct qsockaddr *addr);
 	int		(*SetSocketPort) (struct qsockaddr *addr, int port);
+	void		(*BeginBatch) (void);	// optional, queue writes until EndBatch
+	void		(*EndBatch) (void);
+	sys_socket_t	(*ListenSocket) (void);	// optional, for net_sharedsocket
 } net_landriver_t;
 
 #define	MAX_NET_DRIVERS		8
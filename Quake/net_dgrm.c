@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "net_sys.h"
 #include "net_defs.h"
 #include "net_dgrm.h"
+#include "net_sim.h"
 
 // This is enables a simple IP banning mechanism
 #define BAN_TEST
@@ -42,6 +43,8 @@ static int packetsReceived = 0;
 static int receivedDuplicateCount = 0;
 static int shortPacketCount = 0;
 static int droppedDatagrams;
+static uint64_t bytesSent = 0;
+static uint64_t bytesReceived = 0;
 
 static struct
 {
@@ -52,6 +55,613 @@ static struct
 
 static int myDriverLevel;
 
+/*
+=============================================================================
+
+SHARED LISTEN SOCKET
+
+With net_sharedsocket set, accepted connections are not given a socket of
+their own: the server keeps talking to them through the driver's listen
+socket.  Everything that arrives on it is drained in one go and handed to
+the owning qsocket through a hash on the source address, so the number of
+reads per frame no longer grows with the number of clients and the server
+needs a single UDP port.  Control packets are kept aside for
+_Datagram_CheckNewConnections.
+
+=============================================================================
+*/
+
+cvar_t	net_sharedsocket = {"net_sharedsocket", "0", CVAR_NONE};
+
+#define SHARED_HASHSIZE		256
+#define SHARED_CTLPACKETS	8
+#define SHARED_CTLSIZE		1024
+#define SHARED_MAXQUEUE		(256 * 1024)	// per connection, anything past that is dropped
+
+typedef struct
+{
+	sys_socket_t	socket;
+	int				pollgen;			// bumped every time the socket is drained
+	int				numsockets;
+	qsocket_t		*hash[SHARED_HASHSIZE];
+
+	int				ctlhead, ctlcount;
+	struct
+	{
+		int					length;
+		struct qsockaddr	addr;
+		byte				data[SHARED_CTLSIZE];
+	} ctl[SHARED_CTLPACKETS];
+} sharedsocket_t;
+
+static sharedsocket_t	sharedsockets[MAX_NET_DRIVERS];
+
+static int sharedReads = 0;
+static int sharedStrayPackets = 0;
+static int sharedDroppedPackets = 0;
+
+static unsigned int Datagram_HashAddr (struct qsockaddr *addr)
+{
+	struct sockaddr_in	*in;
+	unsigned int		hash;
+
+	// anything but IPv4 ends up in one bucket and relies on AddrCompare
+	if (addr->qsa_family != AF_INET)
+		return 0;
+
+	in = (struct sockaddr_in *) addr;
+	hash = ntohl (in->sin_addr.s_addr) ^ ((unsigned int) ntohs (in->sin_port) << 16);
+	hash *= 0x9E3779B1u;
+	return hash >> 24;
+}
+
+static void Datagram_LinkShared (qsocket_t *sock)
+{
+	sharedsocket_t	*shared = &sharedsockets[sock->landriver];
+	unsigned int	h = Datagram_HashAddr (&sock->addr);
+
+	sock->sharedsocket = true;
+	sock->sharedpollgen = shared->pollgen;
+	sock->inread = sock->inlen = 0;
+	sock->hashnext = shared->hash[h];
+	shared->hash[h] = sock;
+	shared->numsockets++;
+}
+
+static void Datagram_UnlinkShared (qsocket_t *sock)
+{
+	sharedsocket_t	*shared = &sharedsockets[sock->landriver];
+	qsocket_t		**link;
+
+	for (link = &shared->hash[Datagram_HashAddr (&sock->addr)]; *link; link = &(*link)->hashnext)
+	{
+		if (*link == sock)
+		{
+			*link = sock->hashnext;
+			shared->numsockets--;
+			break;
+		}
+	}
+
+	sock->sharedsocket = false;
+	sock->hashnext = NULL;
+	sock->inread = sock->inlen = 0;
+}
+
+static void Datagram_QueuePacket (qsocket_t *sock, const byte *data, int length)
+{
+	int		needed;
+
+	needed = sock->inlen + (int) sizeof (int) + length;
+	if (needed > SHARED_MAXQUEUE)
+	{
+		sharedDroppedPackets++;
+		return;
+	}
+	if (needed > sock->insize)
+	{
+		int		newsize = q_max (sock->insize * 2, 16 * 1024);
+		while (newsize < needed)
+			newsize *= 2;
+		sock->inpackets = (byte *) realloc (sock->inpackets, newsize);
+		if (!sock->inpackets)
+			Sys_Error ("Datagram_QueuePacket: out of memory");
+		sock->insize = newsize;
+	}
+
+	memcpy (sock->inpackets + sock->inlen, &length, sizeof (int));
+	memcpy (sock->inpackets + sock->inlen + sizeof (int), data, length);
+	sock->inlen = needed;
+}
+
+/*
+==================
+Datagram_PollShared
+
+Reads everything pending on the shared socket and routes it
+==================
+*/
+static void Datagram_PollShared (int landriver)
+{
+	sharedsocket_t		*shared = &sharedsockets[landriver];
+	net_landriver_t		*driver = &net_landrivers[landriver];
+	struct qsockaddr	addr;
+	qsocket_t			*s;
+	int					length, control, slot;
+
+	shared->pollgen++;
+	sharedReads++;
+
+	while ((length = driver->Read (shared->socket, (byte *)&packetBuffer, NET_DATAGRAMSIZE, &addr)) > 0)
+	{
+		if (length >= (int) sizeof (int))
+		{
+			control = BigLong (packetBuffer.length);
+			if (control != -1 && (control & (~NETFLAG_LENGTH_MASK)) == (int)NETFLAG_CTL)
+			{
+				if (shared->ctlcount == SHARED_CTLPACKETS || length > SHARED_CTLSIZE)
+				{
+					sharedDroppedPackets++;
+					continue;
+				}
+				slot = (shared->ctlhead + shared->ctlcount++) % SHARED_CTLPACKETS;
+				shared->ctl[slot].length = length;
+				shared->ctl[slot].addr = addr;
+				memcpy (shared->ctl[slot].data, &packetBuffer, length);
+				continue;
+			}
+		}
+
+		for (s = shared->hash[Datagram_HashAddr (&addr)]; s; s = s->hashnext)
+		{
+			if (driver->AddrCompare (&addr, &s->addr) == 0)
+				break;
+		}
+		if (!s)
+		{
+			sharedStrayPackets++;
+			continue;
+		}
+		Datagram_QueuePacket (s, (byte *)&packetBuffer, length);
+	}
+}
+
+/*
+==================
+Datagram_ReadShared
+
+Read replacement for connections on the shared socket.  The socket is only
+polled again once this connection has consumed what the last poll brought
+in, so a frame that services every client drains it about once.
+==================
+*/
+static int Datagram_ReadShared (qsocket_t *sock, struct qsockaddr *addr)
+{
+	sharedsocket_t	*shared = &sharedsockets[sock->landriver];
+	int				length;
+
+	if (sfunc.ListenSocket () != shared->socket)
+		return -1;	// stopped listening
+
+	if (sock->inread >= sock->inlen)
+	{
+		sock->inread = sock->inlen = 0;
+		if (sock->sharedpollgen != shared->pollgen)
+		{
+			sock->sharedpollgen = shared->pollgen;
+			return 0;
+		}
+		Datagram_PollShared (sock->landriver);
+		sock->sharedpollgen = shared->pollgen;
+		if (!sock->inlen)
+			return 0;
+	}
+
+	memcpy (&length, sock->inpackets + sock->inread, sizeof (int));
+	memcpy (&packetBuffer, sock->inpackets + sock->inread + sizeof (int), length);
+	sock->inread += (int) sizeof (int) + length;
+	*addr = sock->addr;
+
+	return length;
+}
+
+/*
+==================
+Datagram_ReadSharedControl
+
+Returns the next control packet received on the shared socket, polling it
+when none are left
+==================
+*/
+static int Datagram_ReadSharedControl (byte *buf, int len, struct qsockaddr *addr)
+{
+	sharedsocket_t	*shared = &sharedsockets[net_landriverlevel];
+	int				length;
+
+	if (!shared->ctlcount)
+		Datagram_PollShared (net_landriverlevel);
+	if (!shared->ctlcount)
+		return 0;
+
+	length = q_min (shared->ctl[shared->ctlhead].length, len);
+	memcpy (buf, shared->ctl[shared->ctlhead].data, length);
+	*addr = shared->ctl[shared->ctlhead].addr;
+	shared->ctlhead = (shared->ctlhead + 1) % SHARED_CTLPACKETS;
+	shared->ctlcount--;
+
+	return length;
+}
+
+/*
+=============================================================================
+
+WINDOWED RELIABLE CHANNEL
+
+The classic reliable channel is stop-and-wait: one MAX_DATAGRAM fragment
+is sent and the next one waits for its ACK.  When both ends advertise
+NET_CAP_WINDOW at connect time, reliable messages are instead cut into
+NET_WINDOWFRAG sized fragments that stay below the path MTU, and up to
+NET_WINDOWSIZE of them are in flight at once.
+
+Data fragments keep the usual header and sequence numbering, the last one
+of a message carries NETFLAG_EOM.  The receiver buffers out of order
+fragments and answers every one of them with
+
+	long	NET_HEADERSIZE + 8 | NETFLAG_ACK
+	long	sequence		next fragment expected, everything before it arrived
+	long	mask[2]			bit i set if sequence + 1 + i arrived too
+
+The sender retransmits a fragment when the retransmit timer derived from
+the measured round trip time expires, or right away once three fragments
+sent after it have been acknowledged.
+
+=============================================================================
+*/
+
+cvar_t	net_window = {"net_window", "1", CVAR_NONE};
+
+#define NET_WINDOWSIZE		64
+#define NET_WINDOWFRAG		DATAGRAM_MTU
+#define NET_WINDOWACKSIZE	(NET_HEADERSIZE + 2 * sizeof(unsigned int))
+#define NET_MINRTO			0.2
+#define NET_MAXRTO			2.0
+#define NET_DUPTHRESH		3
+
+enum
+{
+	WS_UNSENT,
+	WS_SENT,
+	WS_LOST,		// reported missing by selective acks, resend now
+	WS_RESENT,
+	WS_ACKED,
+};
+
+typedef struct netwindow_s
+{
+	// sender, slots are indexed by sequence % NET_WINDOWSIZE
+	unsigned int	messagestart;		// sequence of the first fragment of sendMessage
+	unsigned int	messageend;			// one past its last fragment
+	byte			sendstate[NET_WINDOWSIZE];
+	double			senttime[NET_WINDOWSIZE];
+	double			srtt, rttvar, rto;
+
+	// receiver
+	byte			recvstate[NET_WINDOWSIZE];	// 0 = empty, else 1 + eom
+	unsigned short	recvlength[NET_WINDOWSIZE];
+	byte			recvdata[NET_WINDOWSIZE][NET_WINDOWFRAG];
+} netwindow_t;
+
+static int fastRetransmits = 0;
+static int retransmitTimeouts = 0;
+static int windowedConnections = 0;
+
+// all datagrams of a connection go out through here so they are accounted for
+static int Datagram_Write (qsocket_t *sock, const void *buf, int len, struct qsockaddr *addr)
+{
+	int		ret;
+
+	ret = sfunc.Write (sock->socket, (byte *)buf, len, addr);
+	if (ret > 0)
+	{
+		bytesSent += ret;
+		sock->stats.bytesSent += ret;
+	}
+	return ret;
+}
+
+static void Datagram_EnableWindow (qsocket_t *sock)
+{
+	if (!sock->window)
+	{
+		sock->window = (netwindow_t *) malloc (sizeof (netwindow_t));
+		if (!sock->window)
+			Sys_Error ("Datagram_EnableWindow: out of memory");
+	}
+	memset (sock->window, 0, sizeof (netwindow_t));
+	sock->window->rto = 1.0;	// same as the stop-and-wait resend delay until measured
+	sock->windowed = true;
+	windowedConnections++;
+}
+
+// capabilities trailing a CCREQ_CONNECT or CCREP_ACCEPT, see net_defs.h
+static void Datagram_WriteCaps (int caps)
+{
+	MSG_WriteLong(&net_message, NET_CAPS_MAGIC);
+	MSG_WriteByte(&net_message, caps);
+}
+
+static int Datagram_ReadCaps (void)
+{
+	if (net_message.cursize - msg_readcount < 5)
+		return 0;
+	if (MSG_ReadLong() != NET_CAPS_MAGIC)
+		return 0;
+	return MSG_ReadByte();
+}
+
+static int Datagram_WindowWrite (qsocket_t *sock, unsigned int sequence)
+{
+	netwindow_t		*w = sock->window;
+	unsigned int	offset, dataLen, packetLen, eom;
+
+	offset = (sequence - w->messagestart) * NET_WINDOWFRAG;
+	dataLen = q_min ((unsigned int) sock->sendMessageLength - offset, (unsigned int) NET_WINDOWFRAG);
+	eom = (sequence == w->messageend - 1) ? NETFLAG_EOM : 0;
+	packetLen = NET_HEADERSIZE + dataLen;
+
+	packetBuffer.length = BigLong(packetLen | (NETFLAG_DATA | eom));
+	packetBuffer.sequence = BigLong(sequence);
+	Q_memcpy (packetBuffer.data, sock->sendMessage + offset, dataLen);
+
+	if (Datagram_Write (sock, &packetBuffer, packetLen, &sock->addr) == -1)
+		return -1;
+
+	w->senttime[sequence % NET_WINDOWSIZE] = net_time;
+	sock->lastSendTime = net_time;
+	return 1;
+}
+
+/*
+==================
+Datagram_WindowSend
+
+Retransmits fragments that are due and fills the window with new ones
+==================
+*/
+static int Datagram_WindowSend (qsocket_t *sock)
+{
+	netwindow_t		*w = sock->window;
+	unsigned int	sequence;
+	qboolean		timedout = false;
+	byte			*state;
+
+	sock->sendNext = false;
+	if (sock->canSend)
+		return 1;
+
+	for (sequence = sock->ackSequence; sequence != sock->sendSequence; sequence++)
+	{
+		state = &w->sendstate[sequence % NET_WINDOWSIZE];
+		if (*state == WS_ACKED)
+			continue;
+		if (*state == WS_LOST)
+		{
+			fastRetransmits++;
+			sock->stats.fastRetransmits++;
+		}
+		else if (net_time - w->senttime[sequence % NET_WINDOWSIZE] >= w->rto)
+			timedout = true;
+		else
+			continue;
+		if (Datagram_WindowWrite (sock, sequence) == -1)
+			return -1;
+		*state = WS_RESENT;
+		packetsReSent++;
+		sock->stats.packetsReSent++;
+	}
+
+	if (timedout)
+	{
+		retransmitTimeouts++;
+		sock->stats.retransmitTimeouts++;
+		w->rto = q_min (w->rto * 2.0, NET_MAXRTO);
+	}
+
+	while (sock->sendSequence != w->messageend && sock->sendSequence - sock->ackSequence < NET_WINDOWSIZE)
+	{
+		if (Datagram_WindowWrite (sock, sock->sendSequence) == -1)
+			return -1;
+		w->sendstate[sock->sendSequence % NET_WINDOWSIZE] = WS_SENT;
+		sock->sendSequence++;
+		packetsSent++;
+		sock->stats.packetsSent++;
+	}
+
+	return 1;
+}
+
+static void Datagram_WindowMarkAcked (qsocket_t *sock, unsigned int sequence)
+{
+	netwindow_t		*w = sock->window;
+	int				slot = sequence % NET_WINDOWSIZE;
+	double			rtt;
+
+	if (w->sendstate[slot] == WS_ACKED)
+		return;
+
+	// only fragments that were sent once give a usable sample
+	if (w->sendstate[slot] == WS_SENT)
+	{
+		rtt = net_time - w->senttime[slot];
+		if (!w->srtt)
+		{
+			w->srtt = rtt;
+			w->rttvar = rtt / 2.0;
+		}
+		else
+		{
+			w->rttvar = 0.75 * w->rttvar + 0.25 * fabs (w->srtt - rtt);
+			w->srtt = 0.875 * w->srtt + 0.125 * rtt;
+		}
+		w->rto = CLAMP (NET_MINRTO, w->srtt + 4.0 * w->rttvar, NET_MAXRTO);
+	}
+
+	w->sendstate[slot] = WS_ACKED;
+}
+
+/*
+==================
+Datagram_WindowAck
+
+Handles a cumulative + selective acknowledgement
+==================
+*/
+static void Datagram_WindowAck (qsocket_t *sock, unsigned int sequence, unsigned int length)
+{
+	netwindow_t		*w = sock->window;
+	unsigned int	mask[2], s, i, later;
+
+	if (length < NET_WINDOWACKSIZE)
+	{
+		shortPacketCount++;
+		return;
+	}
+	if (sock->canSend || sequence - sock->ackSequence > sock->sendSequence - sock->ackSequence)
+	{
+		Con_DPrintf("Stale ACK received\n");
+		return;
+	}
+
+	mask[0] = BigLong(*(unsigned int *)&packetBuffer.data[0]);
+	mask[1] = BigLong(*(unsigned int *)&packetBuffer.data[4]);
+
+	for (s = sock->ackSequence; s != sequence; s++)
+		Datagram_WindowMarkAcked (sock, s);
+	for (i = 0; i < 2 * 32; i++)
+	{
+		s = sequence + 1 + i;
+		if (s - sock->ackSequence >= sock->sendSequence - sock->ackSequence)
+			break;
+		if (mask[i >> 5] & (1u << (i & 31)))
+			Datagram_WindowMarkAcked (sock, s);
+	}
+
+	while (sock->ackSequence != sock->sendSequence && w->sendstate[sock->ackSequence % NET_WINDOWSIZE] == WS_ACKED)
+		sock->ackSequence++;
+
+	if (sock->ackSequence == w->messageend)
+	{
+		sock->sendMessageLength = 0;
+		sock->canSend = true;
+		return;
+	}
+
+	// holes with enough acknowledged fragments after them were lost
+	for (later = 0, s = sock->sendSequence; s != sock->ackSequence; )
+	{
+		s--;
+		if (w->sendstate[s % NET_WINDOWSIZE] == WS_ACKED)
+			later++;
+		else if (w->sendstate[s % NET_WINDOWSIZE] == WS_SENT && later >= NET_DUPTHRESH)
+			w->sendstate[s % NET_WINDOWSIZE] = WS_LOST;
+	}
+
+	sock->sendNext = true;
+}
+
+static void Datagram_WindowSendAck (qsocket_t *sock, struct qsockaddr *addr)
+{
+	netwindow_t		*w = sock->window;
+	unsigned int	ack[4];
+	unsigned int	i;
+
+	ack[2] = ack[3] = 0;
+	for (i = 0; i < NET_WINDOWSIZE - 1; i++)
+	{
+		if (w->recvstate[(sock->receiveSequence + 1 + i) % NET_WINDOWSIZE])
+			ack[2 + (i >> 5)] |= 1u << (i & 31);
+	}
+
+	ack[0] = BigLong(NET_WINDOWACKSIZE | NETFLAG_ACK);
+	ack[1] = BigLong(sock->receiveSequence);
+	ack[2] = BigLong(ack[2]);
+	ack[3] = BigLong(ack[3]);
+	Datagram_Write (sock, ack, NET_WINDOWACKSIZE, addr);
+}
+
+/*
+==================
+Datagram_WindowDeliver
+
+Moves in-order fragments to receiveMessage, returns 1 and fills net_message
+once a whole message is there
+==================
+*/
+static int Datagram_WindowDeliver (qsocket_t *sock)
+{
+	netwindow_t		*w = sock->window;
+	int				slot, eom;
+
+	while (w->recvstate[slot = sock->receiveSequence % NET_WINDOWSIZE])
+	{
+		if (sock->receiveMessageLength + w->recvlength[slot] > NET_MAXMESSAGE)
+		{
+			Con_Printf("Reliable message overflow from %s\n", sock->address);
+			return -1;
+		}
+		Q_memcpy (sock->receiveMessage + sock->receiveMessageLength, w->recvdata[slot], w->recvlength[slot]);
+		sock->receiveMessageLength += w->recvlength[slot];
+		eom = w->recvstate[slot] - 1;
+		w->recvstate[slot] = 0;
+		sock->receiveSequence++;
+
+		if (eom)
+		{
+			SZ_Clear(&net_message);
+			SZ_Write(&net_message, sock->receiveMessage, sock->receiveMessageLength);
+			sock->receiveMessageLength = 0;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int Datagram_WindowReceive (qsocket_t *sock, unsigned int sequence, unsigned int flags, unsigned int length, struct qsockaddr *addr)
+{
+	netwindow_t		*w = sock->window;
+	int				slot, ret;
+
+	if (sequence - sock->receiveSequence >= NET_WINDOWSIZE)
+	{
+		// already delivered, the ack must have been lost; anything past the
+		// window is dropped and will be sent again
+		if ((int)(sequence - sock->receiveSequence) < 0)
+			receivedDuplicateCount++;
+		Datagram_WindowSendAck (sock, addr);
+		return 0;
+	}
+	if (length > NET_WINDOWFRAG)
+	{
+		shortPacketCount++;
+		return 0;
+	}
+
+	slot = sequence % NET_WINDOWSIZE;
+	if (w->recvstate[slot])
+		receivedDuplicateCount++;
+	else
+	{
+		w->recvstate[slot] = (flags & NETFLAG_EOM) ? 2 : 1;
+		w->recvlength[slot] = length;
+		Q_memcpy (w->recvdata[slot], packetBuffer.data, length);
+	}
+
+	ret = Datagram_WindowDeliver (sock);
+	Datagram_WindowSendAck (sock, addr);
+	return ret;
+}
+
 extern qboolean m_return_onerror;
 extern char m_return_reason[32];
 
@@ -149,6 +759,14 @@ int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 	Q_memcpy(sock->sendMessage, data->data, data->cursize);
 	sock->sendMessageLength = data->cursize;
 
+	if (sock->windowed)
+	{
+		sock->canSend = false;
+		sock->window->messagestart = sock->sendSequence;
+		sock->window->messageend = sock->sendSequence + (data->cursize + NET_WINDOWFRAG - 1) / NET_WINDOWFRAG;
+		return Datagram_WindowSend (sock);
+	}
+
 	if (data->cursize <= MAX_DATAGRAM)
 	{
 		dataLen = data->cursize;
@@ -167,11 +785,12 @@ int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 
 	sock->canSend = false;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, &packetBuffer, packetLen, &sock->addr) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
 	packetsSent++;
+	sock->stats.packetsSent++;
 	return 1;
 }
 
@@ -200,11 +819,12 @@ static int SendMessageNext (qsocket_t *sock)
 
 	sock->sendNext = false;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, &packetBuffer, packetLen, &sock->addr) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
 	packetsSent++;
+	sock->stats.packetsSent++;
 	return 1;
 }
 
@@ -233,18 +853,21 @@ static int ReSendMessage (qsocket_t *sock)
 
 	sock->sendNext = false;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, &packetBuffer, packetLen, &sock->addr) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
 	packetsReSent++;
+	sock->stats.packetsReSent++;
 	return 1;
 }
 
 
 qboolean Datagram_CanSendMessage (qsocket_t *sock)
 {
-	if (sock->sendNext)
+	if (sock->windowed)
+		Datagram_WindowSend (sock);
+	else if (sock->sendNext)
 		SendMessageNext (sock);
 
 	return sock->canSend;
@@ -275,10 +898,11 @@ int Datagram_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 	packetBuffer.sequence = BigLong(sock->unreliableSendSequence++);
 	Q_memcpy (packetBuffer.data, data->data, data->cursize);
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, &packetBuffer, packetLen, &sock->addr) == -1)
 		return -1;
 
 	packetsSent++;
+	sock->stats.packetsSent++;
 	return 1;
 }
 
@@ -292,13 +916,23 @@ int	Datagram_GetMessage (qsocket_t *sock)
 	unsigned int	sequence;
 	unsigned int	count;
 
-	if (!sock->canSend)
+	if (sock->windowed)
+	{
+		Datagram_WindowSend (sock);
+		// a previous fragment may have completed more than one message
+		if ((ret = Datagram_WindowDeliver (sock)) != 0)
+			return ret;
+	}
+	else if (!sock->canSend)
 		if ((net_time - sock->lastSendTime) > 1.0)
 			ReSendMessage (sock);
 
 	while (1)
 	{
-		length = (unsigned int) sfunc.Read(sock->socket, (byte *)&packetBuffer,
+		if (sock->sharedsocket)
+			length = (unsigned int) Datagram_ReadShared (sock, &readaddr);
+		else
+			length = (unsigned int) sfunc.Read(sock->socket, (byte *)&packetBuffer,
 							NET_DATAGRAMSIZE, &readaddr);
 
 	//	if ((rand() & 255) > 220)
@@ -313,6 +947,9 @@ int	Datagram_GetMessage (qsocket_t *sock)
 			return -1;
 		}
 
+		bytesReceived += length;
+		sock->stats.bytesReceived += length;
+
 		if (sfunc.AddrCompare(&readaddr, &sock->addr) != 0)
 		{
 			Con_Printf("Forged packet received\n");
@@ -336,6 +973,7 @@ int	Datagram_GetMessage (qsocket_t *sock)
 
 		sequence = BigLong(packetBuffer.sequence);
 		packetsReceived++;
+		sock->stats.packetsReceived++;
 
 		if (flags & NETFLAG_UNRELIABLE)
 		{
@@ -349,6 +987,7 @@ int	Datagram_GetMessage (qsocket_t *sock)
 			{
 				count = sequence - sock->unreliableReceiveSequence;
 				droppedDatagrams += count;
+				sock->stats.droppedDatagrams += count;
 				Con_DPrintf("Dropped %u datagram(s)\n", count);
 			}
 			sock->unreliableReceiveSequence = sequence + 1;
@@ -364,6 +1003,11 @@ int	Datagram_GetMessage (qsocket_t *sock)
 
 		if (flags & NETFLAG_ACK)
 		{
+			if (sock->windowed)
+			{
+				Datagram_WindowAck (sock, sequence, length);
+				continue;
+			}
 			if (sequence != (sock->sendSequence - 1))
 			{
 				Con_DPrintf("Stale ACK received\n");
@@ -396,9 +1040,17 @@ int	Datagram_GetMessage (qsocket_t *sock)
 
 		if (flags & NETFLAG_DATA)
 		{
+			if (sock->windowed)
+			{
+				ret = Datagram_WindowReceive (sock, sequence, flags, length - NET_HEADERSIZE, &readaddr);
+				if (ret)
+					break;
+				continue;
+			}
+
 			packetBuffer.length = BigLong(NET_HEADERSIZE | NETFLAG_ACK);
 			packetBuffer.sequence = BigLong(sequence);
-			sfunc.Write (sock->socket, (byte *)&packetBuffer, NET_HEADERSIZE, &readaddr);
+			Datagram_Write (sock, &packetBuffer, NET_HEADERSIZE, &readaddr);
 
 			if (sequence != sock->receiveSequence)
 			{
@@ -426,7 +1078,12 @@ int	Datagram_GetMessage (qsocket_t *sock)
 		}
 	}
 
-	if (sock->sendNext)
+	if (sock->windowed)
+	{
+		if (sock->sendNext)
+			Datagram_WindowSend (sock);
+	}
+	else if (sock->sendNext)
 		SendMessageNext (sock);
 
 	return ret;
@@ -438,6 +1095,9 @@ static void PrintStats(qsocket_t *s)
 	Con_Printf("canSend = %4u   \n", s->canSend);
 	Con_Printf("sendSeq = %4u   ", s->sendSequence);
 	Con_Printf("recvSeq = %4u   \n", s->receiveSequence);
+	if (s->windowed)
+		Con_Printf("ackSeq  = %4u   srtt = %.1f ms   rto = %.1f ms\n", s->ackSequence,
+			s->window->srtt * 1000.0, s->window->rto * 1000.0);
 	Con_Printf("\n");
 }
 
@@ -457,6 +1117,15 @@ static void NET_Stats_f (void)
 		Con_Printf("receivedDuplicateCount     = %i\n", receivedDuplicateCount);
 		Con_Printf("shortPacketCount           = %i\n", shortPacketCount);
 		Con_Printf("droppedDatagrams           = %i\n", droppedDatagrams);
+		Con_Printf("windowedConnections        = %i\n", windowedConnections);
+		Con_Printf("fastRetransmits            = %i\n", fastRetransmits);
+		Con_Printf("retransmitTimeouts         = %i\n", retransmitTimeouts);
+		if (sharedReads)
+		{
+			Con_Printf("sharedSocketReads          = %i\n", sharedReads);
+			Con_Printf("sharedStrayPackets         = %i\n", sharedStrayPackets);
+			Con_Printf("sharedDroppedPackets       = %i\n", sharedDroppedPackets);
+		}
 	}
 	else if (Q_strcmp(Cmd_Argv(1), "*") == 0)
 	{
@@ -791,10 +1460,14 @@ int Datagram_Init (void)
 	myDriverLevel = net_driverlevel;
 
 	Cmd_AddCommand ("net_stats", NET_Stats_f);
+	Cvar_RegisterVariable (&net_sharedsocket);
+	Cvar_RegisterVariable (&net_window);
 
 	if (safemode || COM_CheckParm("-nolan"))
 		return -1;
 
+	NetSim_Init ();
+
 	num_inited = 0;
 	for (i = 0; i < net_numlandrivers; i++)
 	{
@@ -819,6 +1492,19 @@ int Datagram_Init (void)
 }
 
 
+void Datagram_GetTotals (netstats_t *totals)
+{
+	totals->bytesSent = bytesSent;
+	totals->bytesReceived = bytesReceived;
+	totals->packetsSent = packetsSent;
+	totals->packetsReSent = packetsReSent;
+	totals->packetsReceived = packetsReceived;
+	totals->droppedDatagrams = droppedDatagrams;
+	totals->fastRetransmits = fastRetransmits;
+	totals->retransmitTimeouts = retransmitTimeouts;
+}
+
+
 void Datagram_Shutdown (void)
 {
 	int i;
@@ -839,7 +1525,10 @@ void Datagram_Shutdown (void)
 
 void Datagram_Close (qsocket_t *sock)
 {
-	sfunc.Close_Socket(sock->socket);
+	if (sock->sharedsocket)
+		Datagram_UnlinkShared (sock);	// the listen socket stays open
+	else
+		sfunc.Close_Socket(sock->socket);
 }
 
 
@@ -867,14 +1556,39 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 	int			command;
 	int			control;
 	int			ret;
-
-	acceptsock = dfunc.CheckNewConnections();
-	if (acceptsock == INVALID_SOCKET)
-		return NULL;
+	int			caps;
+	sharedsocket_t	*shared = &sharedsockets[net_landriverlevel];
+	qboolean	useshared;
+
+	// once connections live on the listen socket, every read of it has to go
+	// through the demux, even if net_sharedsocket was turned off since
+	useshared = dfunc.ListenSocket && (net_sharedsocket.value || shared->numsockets);
+	if (useshared)
+	{
+		acceptsock = dfunc.ListenSocket ();
+		if (acceptsock == INVALID_SOCKET)
+			return NULL;
+		if (acceptsock != shared->socket)
+		{
+			if (shared->numsockets)
+				return NULL;	// wait for connections on the old socket to go away
+			shared->socket = acceptsock;
+			shared->ctlcount = 0;
+		}
+	}
+	else
+	{
+		acceptsock = dfunc.CheckNewConnections();
+		if (acceptsock == INVALID_SOCKET)
+			return NULL;
+	}
 
 	SZ_Clear(&net_message);
 
-	len = dfunc.Read (acceptsock, net_message.data, net_message.maxsize, &clientaddr);
+	if (useshared)
+		len = Datagram_ReadSharedControl (net_message.data, net_message.maxsize, &clientaddr);
+	else
+		len = dfunc.Read (acceptsock, net_message.data, net_message.maxsize, &clientaddr);
 	if (len < (int) sizeof(int))
 		return NULL;
 	net_message.cursize = len;
@@ -997,6 +1711,10 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 		return NULL;
 	}
 
+	// optional capabilities, keep only the ones enabled here
+	caps = Datagram_ReadCaps ();
+	caps &= net_window.value ? NET_CAP_WINDOW : 0;
+
 #ifdef BAN_TEST
 	// check for a ban
 	if (clientaddr.qsa_family == AF_INET)
@@ -1036,6 +1754,8 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 				MSG_WriteByte(&net_message, CCREP_ACCEPT);
 				dfunc.GetSocketAddr(s->socket, &newaddr);
 				MSG_WriteLong(&net_message, dfunc.GetSocketPort(&newaddr));
+				if (s->windowed)
+					Datagram_WriteCaps (NET_CAP_WINDOW);
 				*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 				dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
 				SZ_Clear(&net_message);
@@ -1063,20 +1783,28 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 		return NULL;
 	}
 
-	// allocate a network socket
-	newsock = dfunc.Open_Socket(0);
-	if (newsock == INVALID_SOCKET)
+	if (useshared && net_sharedsocket.value)
 	{
-		NET_FreeQSocket(sock);
-		return NULL;
+		// keep talking to the client through the listen socket
+		newsock = acceptsock;
 	}
-
-	// connect to the client
-	if (dfunc.Connect (newsock, &clientaddr) == -1)
+	else
 	{
-		dfunc.Close_Socket(newsock);
-		NET_FreeQSocket(sock);
-		return NULL;
+		// allocate a network socket
+		newsock = dfunc.Open_Socket(0);
+		if (newsock == INVALID_SOCKET)
+		{
+			NET_FreeQSocket(sock);
+			return NULL;
+		}
+
+		// connect to the client
+		if (dfunc.Connect (newsock, &clientaddr) == -1)
+		{
+			dfunc.Close_Socket(newsock);
+			NET_FreeQSocket(sock);
+			return NULL;
+		}
 	}
 
 	// everything is allocated, just fill in the details
@@ -1084,6 +1812,10 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 	sock->landriver = net_landriverlevel;
 	sock->addr = clientaddr;
 	Q_strcpy(sock->address, dfunc.AddrToString(&clientaddr));
+	if (newsock == acceptsock)
+		Datagram_LinkShared (sock);
+	if (caps & NET_CAP_WINDOW)
+		Datagram_EnableWindow (sock);
 
 	// send him back the info about the server connection he has been allocated
 	SZ_Clear(&net_message);
@@ -1093,6 +1825,8 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 	dfunc.GetSocketAddr(newsock, &newaddr);
 	MSG_WriteLong(&net_message, dfunc.GetSocketPort(&newaddr));
 //	MSG_WriteString(&net_message, dfunc.AddrToString(&newaddr));
+	if (caps)
+		Datagram_WriteCaps (caps);
 	*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 	dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
 	SZ_Clear(&net_message);
@@ -1276,6 +2010,8 @@ static qsocket_t *_Datagram_Connect (const char *host)
 		MSG_WriteByte(&net_message, CCREQ_CONNECT);
 		MSG_WriteString(&net_message, "QUAKE");
 		MSG_WriteByte(&net_message, NET_PROTOCOL_VERSION);
+		if (net_window.value)
+			Datagram_WriteCaps (NET_CAP_WINDOW);
 		*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 		dfunc.Write (newsock, net_message.data, net_message.cursize, &sendaddr);
 		SZ_Clear(&net_message);
@@ -1363,6 +2099,8 @@ static qsocket_t *_Datagram_Connect (const char *host)
 	{
 		Q_memcpy(&sock->addr, &sendaddr, sizeof(struct qsockaddr));
 		dfunc.SetSocketPort (&sock->addr, MSG_ReadLong());
+		if (Datagram_ReadCaps () & NET_CAP_WINDOW)
+			Datagram_EnableWindow (sock);
 	}
 	else
 	{
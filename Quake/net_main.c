@@ -24,6 +24,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "arch_def.h"
 #include "net_sys.h"
 #include "net_defs.h"
+#include "net_dgrm.h"
+#include "net_sim.h"
 
 #ifndef WITHOUT_CURL
 #include <curl/curl.h>
@@ -124,6 +126,11 @@ qsocket_t *NET_NewQSocket (void)
 	sock->receiveSequence = 0;
 	sock->unreliableReceiveSequence = 0;
 	sock->receiveMessageLength = 0;
+	sock->windowed = false;
+	sock->sharedsocket = false;
+	sock->hashnext = NULL;
+	sock->inread = sock->inlen = 0;
+	memset (&sock->stats, 0, sizeof (sock->stats));
 
 	return sock;
 }
@@ -170,6 +177,18 @@ const char *NET_QSocketGetAddressString (const qsocket_t *s)
 }
 
 
+const netstats_t *NET_QSocketGetStats (const qsocket_t *s)
+{
+	return &s->stats;
+}
+
+
+void NET_GetTotals (netstats_t *totals)
+{
+	Datagram_GetTotals (totals);
+}
+
+
 static void NET_Listen_f (void)
 {
 	if (Cmd_Argc () != 2)
@@ -881,6 +900,7 @@ void NET_Poll(void)
 	PollProcedure *pp;
 
 	SetNetTime();
+	NetSim_Frame ();
 
 	for (pp = pollProcedureList; pp; pp = pp->next)
 	{
@@ -892,6 +912,88 @@ void NET_Poll(void)
 }
 
 
+/*
+====================
+NET_BeginSendBatch
+
+Lets the lan drivers hold back outgoing packets until NET_EndSendBatch, so
+they can be sent with fewer system calls
+====================
+*/
+void NET_BeginSendBatch (void)
+{
+	int		i;
+
+	for (i = 0; i < net_numlandrivers; i++)
+		if (net_landrivers[i].initialized && net_landrivers[i].BeginBatch)
+			net_landrivers[i].BeginBatch ();
+}
+
+/*
+====================
+NET_EndSendBatch
+====================
+*/
+void NET_EndSendBatch (void)
+{
+	int		i;
+
+	for (i = 0; i < net_numlandrivers; i++)
+		if (net_landrivers[i].initialized && net_landrivers[i].EndBatch)
+			net_landrivers[i].EndBatch ();
+}
+
+/*
+====================
+NET_GetPollSockets
+
+Fills fds with the sockets incoming packets can arrive on and returns how
+many there are, or -1 if some input can't be waited for this way
+====================
+*/
+int NET_GetPollSockets (int *fds, int maxfds)
+{
+#ifdef _WIN32
+	return -1;
+#else
+	qsocket_t		*sock;
+	sys_socket_t	s;
+	int				i, count;
+
+	if (NetSim_Pending () || pollProcedureList)
+		return -1;
+
+	count = 0;
+	for (i = 0; i < net_numlandrivers; i++)
+	{
+		if (!net_landrivers[i].initialized || !net_landrivers[i].ListenSocket)
+			continue;
+		s = net_landrivers[i].ListenSocket ();
+		if (s == INVALID_SOCKET)
+			continue;
+		if (count == maxfds)
+			return -1;
+		fds[count++] = s;
+	}
+
+	for (sock = net_activeSockets; sock; sock = sock->next)
+	{
+		// loopback and bench clients are fed from memory, and bench
+		// sockets don't even have a real fd
+		if (net_drivers[sock->driver].QGetMessage != Datagram_GetMessage)
+			return -1;
+		if (sock->sharedsocket || sock->socket == INVALID_SOCKET)
+			continue;
+		if (count == maxfds)
+			return -1;
+		fds[count++] = sock->socket;
+	}
+
+	return count;
+#endif
+}
+
+
 void SchedulePollProcedure(PollProcedure *proc, double timeOffset)
 {
 	PollProcedure *pp, *prev;
@@ -0,0 +1,448 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// net_sim.c -- network condition simulator for the lan drivers
+//
+// The Read, Write, CheckNewConnections and Close_Socket entries of every lan
+// driver are routed through here.  With net_sim set, each packet crossing
+// them in either direction can be dropped, duplicated, delayed, held back
+// so that later ones overtake it, and serialized through a link of limited
+// bandwidth.  Delayed packets wait in a queue sorted by release time:
+// outgoing ones are written by NetSim_Frame or the next driver call, and
+// incoming ones are handed out by Read once due.  All random decisions come
+// from a generator seeded by net_sim_seed, so a given seed always produces
+// the same sequence of drops, duplicates and delays.
+
+#include "quakedef.h"
+#include "q_stdinc.h"
+#include "arch_def.h"
+#include "net_sys.h"
+#include "net_defs.h"
+#include "net_sim.h"
+
+static cvar_t	net_sim = {"net_sim", "0", CVAR_NONE};
+static cvar_t	net_sim_latency = {"net_sim_latency", "0", CVAR_NONE};	// ms each way
+static cvar_t	net_sim_jitter = {"net_sim_jitter", "0", CVAR_NONE};	// ms of random extra latency
+static cvar_t	net_sim_loss = {"net_sim_loss", "0", CVAR_NONE};		// percent
+static cvar_t	net_sim_dup = {"net_sim_dup", "0", CVAR_NONE};			// percent
+static cvar_t	net_sim_reorder = {"net_sim_reorder", "0", CVAR_NONE};	// percent
+static cvar_t	net_sim_rate = {"net_sim_rate", "0", CVAR_NONE};		// KB/s each way, 0 = unlimited
+static cvar_t	net_sim_seed = {"net_sim_seed", "1", CVAR_NONE};
+
+#define NETSIM_REORDERDELAY	0.02			// extra hold for reordered packets
+#define NETSIM_DUPDELAY		0.001
+#define NETSIM_MAXQUEUED	(8 * 1024 * 1024)	// bytes, anything past that is dropped
+
+typedef struct netsimpacket_s
+{
+	struct netsimpacket_s	*next;
+	double				time;		// when it leaves the simulated link
+	int					driver;
+	qboolean			incoming;
+	sys_socket_t		socket;
+	struct qsockaddr	addr;
+	int					length;
+	byte				data[1];
+} netsimpacket_t;
+
+typedef struct
+{
+	sys_socket_t	(*CheckNewConnections) (void);
+	int				(*Read) (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+	int				(*Write) (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+	int				(*Close_Socket) (sys_socket_t socketid);
+	sys_socket_t	acceptsock;		// last socket CheckNewConnections returned
+} netsimdriver_t;
+
+static netsimdriver_t	netsim_drivers[MAX_NET_DRIVERS];
+static netsimpacket_t	*netsim_queue;
+static int				netsim_queued;		// bytes
+
+// per direction, [0] = outgoing, [1] = incoming
+static double			netsim_busy[2];		// the simulated link is sending until then
+static double			netsim_last[2];		// release time of the last packet kept in order
+
+static unsigned int		netsim_random;
+static int				netsim_seed;
+static qboolean			netsim_active;
+
+static struct
+{
+	int		packets[2];
+	int		dropped;
+	int		duplicated;
+	int		reordered;
+	int		overflowed;
+} netsim_stats;
+
+static float NetSim_Random (void)
+{
+	// xorshift32
+	netsim_random ^= netsim_random << 13;
+	netsim_random ^= netsim_random >> 17;
+	netsim_random ^= netsim_random << 5;
+	return (netsim_random >> 8) * (1.f / (1 << 24));
+}
+
+static void NetSim_Insert (int driver, qboolean incoming, sys_socket_t socketid, const byte *buf, int len, struct qsockaddr *addr, double time)
+{
+	netsimpacket_t	*p, **link;
+
+	if (netsim_queued + len > NETSIM_MAXQUEUED)
+	{
+		netsim_stats.overflowed++;
+		return;
+	}
+
+	p = (netsimpacket_t *) malloc (sizeof (netsimpacket_t) + len);
+	if (!p)
+		Sys_Error ("NetSim_Insert: out of memory");
+	p->time = time;
+	p->driver = driver;
+	p->incoming = incoming;
+	p->socket = socketid;
+	if (addr)
+		p->addr = *addr;
+	p->length = len;
+	memcpy (p->data, buf, len);
+	netsim_queued += len;
+
+	// after everything due at the same time, so equal times keep their order
+	for (link = &netsim_queue; *link && (*link)->time <= time; link = &(*link)->next)
+		;
+	p->next = *link;
+	*link = p;
+}
+
+static void NetSim_Unlink (netsimpacket_t **link)
+{
+	netsimpacket_t	*p = *link;
+
+	*link = p->next;
+	netsim_queued -= p->length;
+	free (p);
+}
+
+/*
+==================
+NetSim_Submit
+
+Runs a packet through the simulated link
+==================
+*/
+static void NetSim_Submit (int driver, qboolean incoming, sys_socket_t socketid, const byte *buf, int len, struct qsockaddr *addr)
+{
+	double	now = Sys_DoubleTime ();
+	double	time;
+	float	rate = net_sim_rate.value * 1024.f;
+
+	netsim_stats.packets[incoming]++;
+
+	if (NetSim_Random () * 100.f < net_sim_loss.value)
+	{
+		netsim_stats.dropped++;
+		return;
+	}
+
+	time = now;
+	if (rate > 0.f)
+	{
+		netsim_busy[incoming] = q_max (netsim_busy[incoming], now) + len / rate;
+		time = netsim_busy[incoming];
+	}
+	time += net_sim_latency.value / 1000.0;
+	time += NetSim_Random () * net_sim_jitter.value / 1000.0;
+
+	// jitter alone doesn't reorder, only the packets picked here overtake
+	if (NetSim_Random () * 100.f < net_sim_reorder.value)
+	{
+		time += NETSIM_REORDERDELAY;
+		netsim_stats.reordered++;
+	}
+	else
+	{
+		time = q_max (time, netsim_last[incoming]);
+		netsim_last[incoming] = time;
+	}
+
+	NetSim_Insert (driver, incoming, socketid, buf, len, addr, time);
+
+	if (NetSim_Random () * 100.f < net_sim_dup.value)
+	{
+		NetSim_Insert (driver, incoming, socketid, buf, len, addr, time + NETSIM_DUPDELAY);
+		netsim_stats.duplicated++;
+	}
+}
+
+/*
+==================
+NetSim_Update
+
+Picks up cvar changes; turning the simulator off releases everything queued
+==================
+*/
+static void NetSim_Update (void)
+{
+	netsimpacket_t	*p;
+	qboolean		active = net_sim.value != 0.f;
+
+	if (active && (!netsim_active || netsim_seed != (int) net_sim_seed.value))
+	{
+		netsim_seed = (int) net_sim_seed.value;
+		netsim_random = netsim_seed ? (unsigned int) netsim_seed : (unsigned int) Sys_DoubleTime () | 1;
+		netsim_busy[0] = netsim_busy[1] = 0.0;
+		netsim_last[0] = netsim_last[1] = 0.0;
+	}
+	netsim_active = active;
+
+	if (!active)
+		for (p = netsim_queue; p; p = p->next)
+			p->time = 0.0;
+}
+
+/*
+==================
+NetSim_Flush
+
+Writes the outgoing packets that are due
+==================
+*/
+static void NetSim_Flush (void)
+{
+	netsimpacket_t	**link;
+	double			now = Sys_DoubleTime ();
+
+	for (link = &netsim_queue; *link && (*link)->time <= now; )
+	{
+		netsimpacket_t *p = *link;
+		if (p->incoming)
+		{
+			link = &p->next;
+			continue;
+		}
+		netsim_drivers[p->driver].Write (p->socket, p->data, p->length, &p->addr);
+		NetSim_Unlink (link);
+	}
+}
+
+static netsimpacket_t **NetSim_FindIncoming (int driver, sys_socket_t socketid)
+{
+	netsimpacket_t	**link;
+	double			now = Sys_DoubleTime ();
+
+	for (link = &netsim_queue; *link && (*link)->time <= now; link = &(*link)->next)
+	{
+		if ((*link)->incoming && (*link)->driver == driver && (*link)->socket == socketid)
+			return link;
+	}
+	return NULL;
+}
+
+static int NetSim_Read (int driver, sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
+{
+	netsimdriver_t	*d = &netsim_drivers[driver];
+	netsimpacket_t	**link;
+	struct qsockaddr	from;
+	int				ret;
+
+	NetSim_Update ();
+	if (!netsim_active && !netsim_queue)
+		return d->Read (socketid, buf, len, addr);
+
+	// everything waiting on the socket enters the simulated link first
+	if (netsim_active)
+	{
+		while ((ret = d->Read (socketid, buf, len, &from)) > 0)
+			NetSim_Submit (driver, true, socketid, buf, ret, &from);
+		if (ret < 0)
+			return ret;
+	}
+
+	NetSim_Flush ();
+
+	link = NetSim_FindIncoming (driver, socketid);
+	if (!link)
+		return netsim_active ? 0 : d->Read (socketid, buf, len, addr);
+
+	ret = q_min ((*link)->length, len);
+	memcpy (buf, (*link)->data, ret);
+	*addr = (*link)->addr;
+	NetSim_Unlink (link);
+	return ret;
+}
+
+static int NetSim_Write (int driver, sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
+{
+	NetSim_Update ();
+	if (!netsim_active)
+	{
+		NetSim_Flush ();
+		return netsim_drivers[driver].Write (socketid, buf, len, addr);
+	}
+
+	NetSim_Submit (driver, false, socketid, buf, len, addr);
+	NetSim_Flush ();
+	return len;
+}
+
+static sys_socket_t NetSim_CheckNewConnections (int driver)
+{
+	netsimdriver_t	*d = &netsim_drivers[driver];
+	sys_socket_t	sock;
+
+	sock = d->CheckNewConnections ();
+	if (sock != INVALID_SOCKET)
+	{
+		d->acceptsock = sock;
+		return sock;
+	}
+
+	// connection requests held back by the simulator
+	if (d->acceptsock != INVALID_SOCKET && NetSim_FindIncoming (driver, d->acceptsock))
+		return d->acceptsock;
+
+	return INVALID_SOCKET;
+}
+
+static int NetSim_CloseSocket (int driver, sys_socket_t socketid)
+{
+	netsimpacket_t	**link;
+
+	// the socket number may be reused, don't deliver anything to it later
+	for (link = &netsim_queue; *link; )
+	{
+		if ((*link)->driver == driver && (*link)->socket == socketid)
+			NetSim_Unlink (link);
+		else
+			link = &(*link)->next;
+	}
+	if (netsim_drivers[driver].acceptsock == socketid)
+		netsim_drivers[driver].acceptsock = INVALID_SOCKET;
+
+	return netsim_drivers[driver].Close_Socket (socketid);
+}
+
+// the driver entries carry no driver index, so each slot gets its own set
+#define NETSIM_THUNKS(i) \
+static sys_socket_t NetSim_CheckNewConnections##i (void) { return NetSim_CheckNewConnections (i); } \
+static int NetSim_Read##i (sys_socket_t s, byte *buf, int len, struct qsockaddr *addr) { return NetSim_Read (i, s, buf, len, addr); } \
+static int NetSim_Write##i (sys_socket_t s, byte *buf, int len, struct qsockaddr *addr) { return NetSim_Write (i, s, buf, len, addr); } \
+static int NetSim_CloseSocket##i (sys_socket_t s) { return NetSim_CloseSocket (i, s); }
+
+NETSIM_THUNKS(0)
+NETSIM_THUNKS(1)
+NETSIM_THUNKS(2)
+NETSIM_THUNKS(3)
+
+#define NETSIM_NUMTHUNKS	4
+
+#define NETSIM_HOOK(i) \
+	case i: \
+		drv->CheckNewConnections = NetSim_CheckNewConnections##i; \
+		drv->Read = NetSim_Read##i; \
+		drv->Write = NetSim_Write##i; \
+		drv->Close_Socket = NetSim_CloseSocket##i; \
+		break;
+
+/*
+==================
+NetSim_Stats_f
+==================
+*/
+static void NetSim_Stats_f (void)
+{
+	netsimpacket_t	*p;
+	int				count;
+
+	for (p = netsim_queue, count = 0; p; p = p->next)
+		count++;
+
+	Con_Printf ("net_sim %s, seed %d\n", netsim_active ? "on" : "off", netsim_seed);
+	Con_Printf ("packets out   = %i\n", netsim_stats.packets[0]);
+	Con_Printf ("packets in    = %i\n", netsim_stats.packets[1]);
+	Con_Printf ("dropped       = %i\n", netsim_stats.dropped);
+	Con_Printf ("duplicated    = %i\n", netsim_stats.duplicated);
+	Con_Printf ("reordered     = %i\n", netsim_stats.reordered);
+	Con_Printf ("overflowed    = %i\n", netsim_stats.overflowed);
+	Con_Printf ("queued        = %i (%i bytes)\n", count, netsim_queued);
+
+	if (Cmd_Argc () > 1 && !q_strcasecmp (Cmd_Argv (1), "reset"))
+		memset (&netsim_stats, 0, sizeof (netsim_stats));
+}
+
+/*
+==================
+NetSim_Frame
+
+Called every frame to send delayed packets on time
+==================
+*/
+void NetSim_Frame (void)
+{
+	if (!netsim_queue)
+		return;
+	NetSim_Update ();
+	NetSim_Flush ();
+}
+
+qboolean NetSim_Pending (void)
+{
+	return netsim_queue != NULL;
+}
+
+/*
+==================
+NetSim_Init
+
+Hooks the lan drivers, must run before they open any socket
+==================
+*/
+void NetSim_Init (void)
+{
+	int		i;
+
+	Cvar_RegisterVariable (&net_sim);
+	Cvar_RegisterVariable (&net_sim_latency);
+	Cvar_RegisterVariable (&net_sim_jitter);
+	Cvar_RegisterVariable (&net_sim_loss);
+	Cvar_RegisterVariable (&net_sim_dup);
+	Cvar_RegisterVariable (&net_sim_reorder);
+	Cvar_RegisterVariable (&net_sim_rate);
+	Cvar_RegisterVariable (&net_sim_seed);
+	Cmd_AddCommand ("net_simstats", NetSim_Stats_f);
+
+	for (i = 0; i < net_numlandrivers && i < NETSIM_NUMTHUNKS; i++)
+	{
+		net_landriver_t	*drv = &net_landrivers[i];
+
+		netsim_drivers[i].CheckNewConnections = drv->CheckNewConnections;
+		netsim_drivers[i].Read = drv->Read;
+		netsim_drivers[i].Write = drv->Write;
+		netsim_drivers[i].Close_Socket = drv->Close_Socket;
+		netsim_drivers[i].acceptsock = INVALID_SOCKET;
+
+		switch (i)
+		{
+		NETSIM_HOOK(0)
+		NETSIM_HOOK(1)
+		NETSIM_HOOK(2)
+		NETSIM_HOOK(3)
+		}
+	}
+}
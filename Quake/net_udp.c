@@ -20,6 +20,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		/* recvmmsg, sendmmsg */
+#endif
+
 #include "q_stdinc.h"
 #include "arch_def.h"
 #include "net_sys.h"
@@ -35,6 +39,312 @@ static in_addr_t	myAddr;
 
 #include "net_udp.h"
 
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+#define UDP_MMSG
+#endif
+
+#ifdef UDP_MMSG
+/*
+=============================================================================
+
+BATCHED I/O
+
+Reads drain a socket with one recvmmsg into a per-socket queue, and writes
+made between UDP_BeginBatch and UDP_EndBatch are copied into one buffer and
+sent with a sendmmsg per socket, so a server frame costs about one syscall
+per socket in each direction instead of one per packet.
+
+=============================================================================
+*/
+
+#define UDP_BATCH			16				// packets per recvmmsg/sendmmsg
+#define UDP_MAXWRITES		256				// queued packets
+#define UDP_WRITEBUFSIZE	(256 * 1024)	// queued bytes
+
+typedef struct udpqueue_s
+{
+	struct udpqueue_s	*next;
+	sys_socket_t	socket;
+	int				count, next_packet;	// received by the last recvmmsg, handed out
+	qboolean		drained;			// the last recvmmsg didn't fill the queue
+	struct mmsghdr	msgs[UDP_BATCH];
+	struct iovec	iovs[UDP_BATCH];
+	struct qsockaddr	addrs[UDP_BATCH];
+	byte			*data;				// UDP_BATCH * NET_DATAGRAMSIZE
+} udpqueue_t;
+
+typedef struct
+{
+	sys_socket_t	socket;
+	struct qsockaddr	addr;
+	int				offset, length;
+	qboolean		sent;
+} udpwrite_t;
+
+static udpqueue_t	*udp_queues;
+
+static struct
+{
+	qboolean		active;
+	int				count, used;
+	udpwrite_t		packets[UDP_MAXWRITES];
+	byte			data[UDP_WRITEBUFSIZE];
+} udp_writes;
+
+static struct
+{
+	unsigned int	reads, readcalls;	// UDP_Read calls, recvmmsg syscalls
+	unsigned int	writes, writecalls;	// UDP_Write calls, sendto and sendmmsg syscalls
+	unsigned int	frames;				// UDP_EndBatch calls
+} udp_stats;
+
+/*
+============
+UDP_GetQueue
+============
+*/
+static udpqueue_t *UDP_GetQueue (sys_socket_t socketid, qboolean create)
+{
+	udpqueue_t	*q;
+	int			i;
+
+	for (q = udp_queues; q; q = q->next)
+		if (q->socket == socketid)
+			return q;
+	if (!create)
+		return NULL;
+
+	q = (udpqueue_t *) calloc (1, sizeof (*q));
+	if (q)
+		q->data = (byte *) malloc (UDP_BATCH * NET_DATAGRAMSIZE);
+	if (!q || !q->data)
+		Sys_Error ("UDP_GetQueue: out of memory");
+
+	q->socket = socketid;
+	for (i = 0; i < UDP_BATCH; i++)
+	{
+		q->iovs[i].iov_base = q->data + i * NET_DATAGRAMSIZE;
+		q->iovs[i].iov_len = NET_DATAGRAMSIZE;
+		q->msgs[i].msg_hdr.msg_iov = &q->iovs[i];
+		q->msgs[i].msg_hdr.msg_iovlen = 1;
+		q->msgs[i].msg_hdr.msg_name = &q->addrs[i];
+	}
+
+	q->next = udp_queues;
+	udp_queues = q;
+	return q;
+}
+
+/*
+============
+UDP_FreeQueue
+============
+*/
+static void UDP_FreeQueue (sys_socket_t socketid)
+{
+	udpqueue_t	**link, *q;
+
+	for (link = &udp_queues; *link; link = &(*link)->next)
+	{
+		q = *link;
+		if (q->socket == socketid)
+		{
+			*link = q->next;
+			free (q->data);
+			free (q);
+			return;
+		}
+	}
+}
+
+/*
+============
+UDP_ReadBatched
+
+Hands out the packets of the last recvmmsg before making another one.  Once
+a recvmmsg comes back short the socket is known to be empty, so the next
+read reports that without asking the kernel again.
+============
+*/
+static int UDP_ReadBatched (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
+{
+	udpqueue_t	*q = UDP_GetQueue (socketid, true);
+	int			i, ret, err;
+
+	udp_stats.reads++;
+
+	if (q->next_packet == q->count)
+	{
+		if (q->drained)
+		{
+			q->drained = false;
+			return 0;
+		}
+
+		for (i = 0; i < UDP_BATCH; i++)
+		{
+			q->msgs[i].msg_hdr.msg_namelen = sizeof (struct qsockaddr);
+			q->msgs[i].msg_hdr.msg_flags = 0;
+		}
+
+		udp_stats.readcalls++;
+		ret = recvmmsg (socketid, q->msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+		q->count = q->next_packet = 0;
+		if (ret == SOCKET_ERROR)
+		{
+			err = SOCKETERRNO;
+			if (err == NET_EWOULDBLOCK || err == NET_ECONNREFUSED)
+				return 0;
+			Con_SafePrintf ("UDP_Read, recvmmsg: %s\n", socketerror(err));
+			return -1;
+		}
+		q->count = ret;
+		q->drained = ret < UDP_BATCH;
+		if (!ret)
+			return 0;
+	}
+
+	i = q->next_packet++;
+	ret = q_min ((int) q->msgs[i].msg_len, len);
+	memcpy (buf, q->iovs[i].iov_base, ret);
+	memcpy (addr, &q->addrs[i], sizeof (*addr));
+	return ret;
+}
+
+/*
+============
+UDP_FlushWrites
+
+Sends the queued packets, one sendmmsg per socket and UDP_BATCH packets
+============
+*/
+static void UDP_FlushWrites (void)
+{
+	struct mmsghdr	msgs[UDP_BATCH];
+	struct iovec	iovs[UDP_BATCH];
+	udpwrite_t		*p;
+	sys_socket_t	socketid;
+	int				i, j, n, sent, ret, err;
+
+	for (i = 0; i < udp_writes.count; i++)
+	{
+		if (udp_writes.packets[i].sent)
+			continue;
+
+		// gather this socket's packets in the order they were written
+		socketid = udp_writes.packets[i].socket;
+		for (j = i; j < udp_writes.count; )
+		{
+			for (n = 0; j < udp_writes.count && n < UDP_BATCH; j++)
+			{
+				p = &udp_writes.packets[j];
+				if (p->sent || p->socket != socketid)
+					continue;
+				p->sent = true;
+				iovs[n].iov_base = udp_writes.data + p->offset;
+				iovs[n].iov_len = p->length;
+				memset (&msgs[n], 0, sizeof (msgs[n]));
+				msgs[n].msg_hdr.msg_iov = &iovs[n];
+				msgs[n].msg_hdr.msg_iovlen = 1;
+				msgs[n].msg_hdr.msg_name = &p->addr;
+				msgs[n].msg_hdr.msg_namelen = sizeof (struct qsockaddr);
+				n++;
+			}
+
+			for (sent = 0; sent < n; sent += ret)
+			{
+				udp_stats.writecalls++;
+				ret = sendmmsg (socketid, msgs + sent, n - sent, 0);
+				if (ret <= 0)
+				{
+					err = SOCKETERRNO;
+					if (ret == SOCKET_ERROR && err != NET_EWOULDBLOCK)
+						Con_SafePrintf ("UDP_Write, sendmmsg: %s\n", socketerror(err));
+					break;	// dropped, like a sendto that would block
+				}
+			}
+		}
+	}
+
+	udp_writes.count = 0;
+	udp_writes.used = 0;
+}
+
+/*
+============
+UDP_QueueWrite
+============
+*/
+static int UDP_QueueWrite (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
+{
+	udpwrite_t	*p;
+
+	if (udp_writes.count == UDP_MAXWRITES || udp_writes.used + len > UDP_WRITEBUFSIZE)
+		UDP_FlushWrites ();
+
+	p = &udp_writes.packets[udp_writes.count++];
+	p->socket = socketid;
+	p->addr = *addr;
+	p->offset = udp_writes.used;
+	p->length = len;
+	p->sent = false;
+	memcpy (udp_writes.data + p->offset, buf, len);
+	udp_writes.used += len;
+
+	return len;
+}
+
+/*
+============
+UDP_Syscalls_f
+============
+*/
+static void UDP_Syscalls_f (void)
+{
+	unsigned int	portable, actual;
+
+	portable = udp_stats.reads + udp_stats.writes;
+	actual = udp_stats.readcalls + udp_stats.writecalls;
+
+	Con_Printf ("reads  %u in %u recvmmsg calls\n", udp_stats.reads, udp_stats.readcalls);
+	Con_Printf ("writes %u in %u sendto/sendmmsg calls\n", udp_stats.writes, udp_stats.writecalls);
+	if (udp_stats.frames)
+		Con_Printf ("%.1f syscalls saved per frame over %u frames\n",
+			(double)(portable - actual) / udp_stats.frames, udp_stats.frames);
+
+	if (Cmd_Argc () == 2 && !strcmp (Cmd_Argv (1), "reset"))
+		memset (&udp_stats, 0, sizeof (udp_stats));
+}
+#endif	/* UDP_MMSG */
+
+/*
+============
+UDP_BeginBatch
+
+Writes are queued until UDP_EndBatch
+============
+*/
+void UDP_BeginBatch (void)
+{
+#ifdef UDP_MMSG
+	udp_writes.active = true;
+#endif
+}
+
+/*
+============
+UDP_EndBatch
+============
+*/
+void UDP_EndBatch (void)
+{
+#ifdef UDP_MMSG
+	UDP_FlushWrites ();
+	udp_writes.active = false;
+	udp_stats.frames++;
+#endif
+}
+
 //=============================================================================
 
 sys_socket_t UDP_Init (void)
@@ -121,6 +431,10 @@ sys_socket_t UDP_Init (void)
 	Con_SafePrintf("UDP Initialized\n");
 	tcpipAvailable = true;
 
+#ifdef UDP_MMSG
+	Cmd_AddCommand ("net_syscalls", UDP_Syscalls_f);
+#endif
+
 	return net_controlsocket;
 }
 
@@ -153,6 +467,11 @@ void UDP_Listen (qboolean state)
 	net_acceptsocket = INVALID_SOCKET;
 }
 
+sys_socket_t UDP_ListenSocket (void)
+{
+	return net_acceptsocket;
+}
+
 //=============================================================================
 
 sys_socket_t UDP_OpenSocket (int port)
@@ -190,6 +509,12 @@ ErrorReturn:
 
 int UDP_CloseSocket (sys_socket_t socketid)
 {
+#ifdef UDP_MMSG
+	// anything queued for this socket (like a disconnect) goes out first
+	if (udp_writes.count)
+		UDP_FlushWrites ();
+	UDP_FreeQueue (socketid);
+#endif
 	if (socketid == net_broadcastsocket)
 		net_broadcastsocket = 0;
 	return closesocket (socketid);
@@ -270,6 +595,14 @@ sys_socket_t UDP_CheckNewConnections (void)
 	if (net_acceptsocket == INVALID_SOCKET)
 		return INVALID_SOCKET;
 
+#ifdef UDP_MMSG
+	{
+		udpqueue_t *q = UDP_GetQueue (net_acceptsocket, false);
+		if (q && q->next_packet < q->count)
+			return net_acceptsocket;
+	}
+#endif
+
 	if (ioctl (net_acceptsocket, FIONREAD, &available) == -1)
 	{
 		int err = SOCKETERRNO;
@@ -286,6 +619,9 @@ sys_socket_t UDP_CheckNewConnections (void)
 
 int UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
 {
+#ifdef UDP_MMSG
+	return UDP_ReadBatched (socketid, buf, len, addr);
+#else
 	socklen_t addrlen = sizeof(struct qsockaddr);
 	int ret;
 
@@ -298,6 +634,7 @@ int UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
 		Con_SafePrintf ("UDP_Read, recvfrom: %s\n", socketerror(err));
 	}
 	return ret;
+#endif
 }
 
 //=============================================================================
@@ -346,6 +683,13 @@ int UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr
 {
 	int	ret;
 
+#ifdef UDP_MMSG
+	udp_stats.writes++;
+	if (udp_writes.active)
+		return UDP_QueueWrite (socketid, buf, len, addr);
+	udp_stats.writecalls++;
+#endif
+
 	ret = sendto (socketid, buf, len, 0, (struct sockaddr *)addr,
 							sizeof(struct qsockaddr));
 	if (ret == SOCKET_ERROR)
@@ -40,6 +40,9 @@ int  UDP_GetAddrFromName (const char *name, struct qsockaddr *addr);
 int  UDP_AddrCompare (struct qsockaddr *addr1, struct qsockaddr *addr2);
 int  UDP_GetSocketPort (struct qsockaddr *addr);
 int  UDP_SetSocketPort (struct qsockaddr *addr, int port);
+void UDP_BeginBatch (void);
+void UDP_EndBatch (void);
+sys_socket_t  UDP_ListenSocket (void);
 
 #endif	/* __net_udp_h */
 
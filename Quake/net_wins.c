@@ -214,6 +214,11 @@ void WINS_Listen (qboolean state)
 	net_acceptsocket = INVALID_SOCKET;
 }
 
+sys_socket_t WINS_ListenSocket (void)
+{
+	return net_acceptsocket;
+}
+
 //=============================================================================
 
 sys_socket_t WINS_OpenSocket (int port)
@@ -40,6 +40,7 @@ int  WINS_GetAddrFromName (const char *name, struct qsockaddr *addr);
 int  WINS_AddrCompare (struct qsockaddr *addr1, struct qsockaddr *addr2);
 int  WINS_GetSocketPort (struct qsockaddr *addr);
 int  WINS_SetSocketPort (struct qsockaddr *addr, int port);
+sys_socket_t  WINS_ListenSocket (void);
 
 #endif	/* __NET_WINSOCK_H */
 
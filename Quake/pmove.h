@@ -0,0 +1,67 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _QUAKE_PMOVE_H
+#define _QUAKE_PMOVE_H
+
+// pmove.h -- movement code shared by the server and client side prediction
+
+typedef struct pmove_s
+{
+// the mover.  The server points these at the fields of the edict, so touch
+// functions run in the middle of a move see and change the real thing
+	float		*origin;
+	float		*velocity;
+	float		*flags;			// FL_* bits
+	float		*waterlevel;
+	float		*watertype;
+	float		*movetype;
+	float		*mins, *maxs;
+	float		*angles;		// walking direction
+	float		*v_angle;		// swimming direction and wall friction
+	float		viewheight;
+	int			solid;
+	int			pushtype;		// MOVE_* for pushes, the moves themselves are MOVE_NORMAL
+	qboolean	teleported;		// don't let the player walk back into the teleporter
+
+// the move
+	usercmd_t	cmd;
+	double		frametime;		// double like host_frametime, so the server math stays the same
+	float		movevars[NUM_MOVEVARS];
+
+// the world
+	trace_t		(*move) (struct pmove_s *pm, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type);
+	int			(*pointcontents) (struct pmove_s *pm, vec3_t p);
+	void		(*ground) (struct pmove_s *pm, const trace_t *trace);	// landed on what the trace hit
+	qboolean	(*touch) (struct pmove_s *pm, const trace_t *trace);	// false if the mover was removed, may be NULL
+	void		(*link) (struct pmove_s *pm);							// after each push, may be NULL
+	void		*user;
+} pmove_t;
+
+int PM_ClipVelocity (vec3_t in, vec3_t normal, vec3_t out, float overbounce);
+int PM_FlyMove (pmove_t *pm, double time, trace_t *steptrace);
+qboolean PM_CheckWater (pmove_t *pm);
+void PM_WalkMove (pmove_t *pm);
+void PM_WaterMove (pmove_t *pm);
+void PM_AirMove (pmove_t *pm);
+
+void SV_InitPmove (pmove_t *pm, edict_t *ent);
+// points pm at the fields of ent, which the moves then change in place
+
+#endif	/* _QUAKE_PMOVE_H */
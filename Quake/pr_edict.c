@@ -208,6 +208,8 @@ edict_t *ED_Alloc (void)
 		if (e->freetime < 2 || qcvm->time - e->freetime > 0.5)
 		{
 			ED_ClearEdict (e);
+			if (qcvm == &sv.qcvm)
+				SV_AddToPhysicsList (e);
 			return e;
 		}
 	}
@@ -218,6 +220,8 @@ edict_t *ED_Alloc (void)
 	e = EDICT_NUM(qcvm->num_edicts++);
 	memset(e, 0, qcvm->edict_size); // ericw -- switched sv.edicts to malloc(), so we are accessing uninitialized memory and must fully zero it, not just ED_ClearEdict
 	e->baseline.scale = ENTSCALE_DEFAULT;
+	if (qcvm == &sv.qcvm)
+		SV_AddToPhysicsList (e);
 
 	return e;
 }
@@ -392,6 +392,8 @@ The interpretation main loop
 #define OPB ((eval_t *)&qcvm->globals[(unsigned short)st->b])
 #define OPC ((eval_t *)&qcvm->globals[(unsigned short)st->c])
 
+int pr_runaways;
+
 void PR_ExecuteProgram (func_t fnum)
 {
 	eval_t		*ptr;
@@ -425,6 +427,7 @@ void PR_ExecuteProgram (func_t fnum)
 	if (++profile > 0x1000000) /* was 100000 */
 	{
 		qcvm->xstatement = st - qcvm->statements;
+		pr_runaways++;
 		PR_RunError("runaway loop error");
 	}
 
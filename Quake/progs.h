@@ -45,6 +45,13 @@ typedef struct edict_s
 
 	int		num_leafs;
 	int		leafnums[MAX_ENT_LEAFS];
+	int		headnode;		/* node where the bounds split, only valid if num_leafs == MAX_ENT_LEAFS */
+	unsigned int	leafstamp;	/* matches the leaf index entries for the current leafnums */
+
+	qboolean	linkvalid;		/* linkmins/linkmaxs/linksolid describe the current leafs and area node */
+	qboolean	linkleafs;		/* leafs were gathered (modelindex was set) */
+	float		linksolid;
+	vec3_t		linkmins, linkmaxs;	/* abs box at the last full SV_LinkEdict */
 
 	entity_state_t	baseline;
 	unsigned char	alpha;			/* johnfitz -- hack to support alpha since it's not part of entvars_t */
@@ -56,6 +63,9 @@ typedef struct edict_s
 	float		oldthinktime;
 
 	float		freetime;		/* sv.time when the object was freed */
+
+	int		physclass;		/* server physics list this edict is on, PHYS_UNLISTED if none */
+	float		physmovetype;		/* movetype when physclass was last computed */
 	entvars_t	v;			/* C exported fields from progs */
 
 	/* other fields from progs come immediately after */
@@ -292,6 +302,7 @@ void PR_PopQCVM(qcvm_t *oldvm);
 void PR_Init (void);
 
 void PR_ExecuteProgram (func_t fnum);
+extern int pr_runaways;		// runaway loop errors since startup
 void PR_ClearProgs(qcvm_t *vm);
 qboolean PR_LoadProgs (const char *filename, qboolean fatal);
 void PR_EnableExtensions (void);
@@ -37,6 +37,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define PRFL_EDICTSCALE		(1 << 5)
 #define PRFL_ALPHASANITY	(1 << 6)	// cleanup insanity with alpha
 #define PRFL_INT32COORD		(1 << 7)
+#define PRFL_DELTAFRAMES	(1 << 8)	// entity updates relative to acknowledged frames, see delta.c
+#define PRFL_MOVESEQ		(1 << 9)	// numbered moves and svc_playerstate for client prediction, see cl_pred.c
+#define PRFL_DEFLATE		(1 << 10)	// large reliable messages may be sent as svc_deflate, see deflate.c
 #define PRFL_MOREFLAGS		(1 << 31)	// not supported
 
 // if the high bit of the servercmd is set, the low bits are fast update flags:
@@ -224,6 +227,31 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define svc_backtolobby		55
 #define svc_localsound		56
 
+#define svc_deltaframe		57	// [long] sequence [long] reference sequence, PRFL_DELTAFRAMES only
+#define svc_playerstate		58	// [long] last clc_moveseq run [byte] PS_* [byte] movetype [float*3] origin [float*3] velocity
+								// PRFL_MOVESEQ only
+
+#define svc_deflate			59	// [long] inflated size, the rest of the message is a raw deflate stream
+								// of regular server messages, PRFL_DEFLATE only, after clc_deflate
+
+#define svc_movevars		60	// [float*NUM_MOVEVARS] reliable, whenever they change, PRFL_MOVESEQ only
+
+// svc_playerstate flags
+#define PS_ONGROUND			(1<<0)
+#define PS_JUMPRELEASED		(1<<1)
+#define PS_WATERJUMP		(1<<2)
+
+// svc_movevars
+#define MV_GRAVITY			0		// sv_gravity scaled by the player's gravity field
+#define MV_FRICTION			1
+#define MV_STOPSPEED		2
+#define MV_MAXSPEED			3
+#define MV_ACCELERATE		4
+#define MV_EDGEFRICTION		5
+#define MV_NOSTEP			6
+#define MV_JUMPVELOCITY		7		// 0 = don't predict jumps
+#define NUM_MOVEVARS		8
+
 //
 // client to server
 //
@@ -232,6 +260,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	clc_disconnect	2
 #define	clc_move		3		// [usercmd_t]
 #define	clc_stringcmd	4		// [string] message
+#define	clc_ackframe	5		// [long] newest svc_deltaframe received, PRFL_DELTAFRAMES only
+#define	clc_moveseq		6		// [long] sequence of the preceding clc_move, PRFL_MOVESEQ only
+#define	clc_deflate		7		// client accepts svc_deflate, PRFL_DEFLATE only
 
 //
 // temp entity events
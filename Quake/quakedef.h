@@ -242,15 +242,18 @@ typedef struct
 #include "common.h"
 #include "bspfile.h"
 #include "sys.h"
+#include "tasks.h"
 #include "zone.h"
 #include "mathlib.h"
 #include "cvar.h"
 
 #include "protocol.h"
+#include "delta.h"
 #include "net.h"
 
 #include "cmd.h"
 #include "crc.h"
+#include "deflate.h"
 
 #include "platform.h"
 #if defined(SDL_FRAMEWORK) || defined(NO_SDL_CONFIG)
@@ -280,6 +283,7 @@ typedef struct
 
 #include "gl_model.h"
 #include "world.h"
+#include "pmove.h"
 
 #include "image.h"	//johnfitz
 #include "gl_texmgr.h"	//johnfitz
@@ -304,6 +308,8 @@ extern qboolean noclip_anglehack;
 extern	quakeparms_t *host_parms;
 
 extern	cvar_t		sys_ticrate;
+extern	cvar_t		sys_eventloop;
+extern	cvar_t		sys_minticrate;
 extern	cvar_t		sys_nostdout;
 extern	cvar_t		developer;
 extern	cvar_t		max_edicts; //johnfitz
@@ -383,6 +389,7 @@ extern filelist_item_t	*skylist;
 
 void Host_ClearMemory (void);
 void Host_ServerFrame (void);
+void Host_ServerInput (void);
 void Host_InitCommands (void);
 void Host_Init (void);
 void Host_Shutdown(void);
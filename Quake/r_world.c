@@ -48,7 +48,7 @@ typedef struct gpumark_frame_s {
 	GLuint		padding[3];
 } gpumark_frame_t;
 
-byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel);
+fatpvs_t r_waterfatpvs;	// fat pvs around water portals
 
 /*
 ===============
@@ -123,7 +123,7 @@ void R_MarkSurfaces (void)
 	if (r_novis.value || r_viewleaf->contents == CONTENTS_SOLID || r_viewleaf->contents == CONTENTS_SKY)
 		vis = Mod_NoVisPVS (cl.worldmodel);
 	else if (nearwaterportal)
-		vis = SV_FatPVS (r_origin, cl.worldmodel);
+		vis = SV_CachedFatPVS (r_origin, cl.worldmodel, &r_waterfatpvs);
 	else
 		vis = Mod_LeafPVS (r_viewleaf, cl.worldmodel);
 
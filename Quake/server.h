@@ -32,6 +32,12 @@ typedef struct
 	struct client_s	*clients;		// [maxclients]
 	int			serverflags;		// episode completion information
 	qboolean	changelevel_issued;	// cleared when at SV_SpawnServer
+
+// empty dedicated servers stop simulating, see SV_UpdateHibernation
+	double		emptytime;			// realtime when the last client left
+	qboolean	hibernating;
+	double		hibernatestart;		// realtime when the current hibernation began
+	double		hibernatetotal;		// seconds spent in finished hibernations
 } server_static_t;
 
 //=============================================================================
@@ -40,6 +46,38 @@ typedef struct
 
 typedef enum {ss_loading, ss_active} server_state_t;
 
+// SV_Physics dispatch classes, in the order sv_physicsbuckets runs them
+typedef enum
+{
+	PHYS_UNLISTED,
+	PHYS_CLIENT,
+	PHYS_PUSH,
+	PHYS_NONE,
+	PHYS_NOCLIP,
+	PHYS_STEP,
+	PHYS_TOSS,			// toss, gib, bounce, fly and flymissile
+	PHYS_BAD,
+
+	NUM_PHYS_CLASSES,
+} physclass_t;
+
+typedef struct
+{
+	int			*ents;				// [max_edicts] edict numbers, ascending once sorted
+	int			count;
+	qboolean	unsorted;
+} physlist_t;
+
+// a positional message in server_t.multicast, see SV_Multicast
+#define MAX_MULTICASTS	1024
+
+typedef struct
+{
+	int			leafnum;			// leaf of the origin, -1 to send it everywhere
+	int			offset;
+	int			length;
+} multicast_t;
+
 typedef struct
 {
 	qboolean	active;				// false if only a net client
@@ -53,6 +91,9 @@ typedef struct
 
 	qcvm_t		qcvm;				// Spike: entire qcvm state
 
+	qboolean	physlistsvalid;		// false until SV_Physics rebuilds the lists
+	physlist_t	physlists[NUM_PHYS_CLASSES];	// active edicts per dispatch class
+
 	char		name[64];			// map name
 	char		modelname[64];		// maps/<name>.bsp, for model_precache[0]
 	struct qmodel_s	*worldmodel;
@@ -65,6 +106,11 @@ typedef struct
 	sizebuf_t	datagram;
 	byte		datagram_buf[MAX_DATAGRAM];
 
+	sizebuf_t	multicast;			// copied to the clients that can hear each message
+	byte		multicast_buf[MAX_DATAGRAM];
+	int			nummulticasts;
+	multicast_t	multicasts[MAX_MULTICASTS];
+
 	sizebuf_t	reliable_datagram;	// copied to all clients at end of frame
 	byte		reliable_datagram_buf[MAX_DATAGRAM];
 
@@ -146,6 +192,28 @@ typedef struct client_s
 	int				oldstats_i[MAX_CL_STATS];		//previous values of stats. if these differ from the current values, reflag resendstats.
 	float			oldstats_f[MAX_CL_STATS];		//previous values of stats. if these differ from the current values, reflag resendstats.
 	char			*oldstats_s[MAX_CL_STATS];
+
+// PRFL_DELTAFRAMES state, reset for every map
+	qboolean		deltaframes;		// client sent clc_ackframe
+	int				deltasequence;		// last svc_deltaframe sent
+	int				deltaack;			// last svc_deltaframe the client received
+
+// PRFL_MOVESEQ state, reset for every map
+	qboolean		moveseqs;			// client sent clc_moveseq
+	int				moveseq;			// sequence of the last clc_move read
+	qboolean		movevarsvalid;
+	float			movevars[NUM_MOVEVARS];	// last sent with svc_movevars
+
+// PRFL_DEFLATE state, reset for every map
+	qboolean		deflate;			// client sent clc_deflate
+	int				deflatein;			// reliable bytes before and after compression
+	int				deflateout;
+
+// bandwidth budget, see SV_UpdateRateBudget
+	int				rate;				// bytes per second the client asked for, 0 = server default
+	float			ratebudget;			// bytes that can be sent right now, negative when in debt
+	double			ratetime;			// realtime of the last refill
+	int				ratelimit;			// datagram size entity updates may grow to, 0 = unlimited
 } client_t;
 
 
@@ -260,6 +328,8 @@ void SV_DropClient (qboolean crash);
 
 void SV_SendClientMessages (void);
 void SV_ClearDatagram (void);
+qboolean SV_UpdateHibernation (void);
+double SV_HibernationTime (void);
 void SV_ReserveSignonSpace (int numbytes);
 
 int SV_ModelIndex (const char *name);
@@ -269,12 +339,15 @@ void SV_SetIdealPitch (void);
 void SV_AddUpdates (void);
 
 void SV_ClientThink (void);
+void SV_GetMovevars (edict_t *ent, float *movevars);
 void SV_AddClientToServer (struct qsocket_s	*ret);
 
 void SV_ClientPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 void SV_BroadcastPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 
 void SV_Physics (void);
+void SV_InitPhysicsLists (void);
+void SV_AddToPhysicsList (edict_t *ent);
 
 qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
@@ -283,9 +356,79 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg);
 
 void SV_MoveToGoal (void);
 
+#define MAX_FATPVS_LEAFS	32
+
+typedef struct
+{
+	struct qmodel_s	*model;
+	int			numleafs;
+	int			leafs[MAX_FATPVS_LEAFS];	// leafs the fat pvs was built from
+	byte		*pvs;
+	int			capacity;
+} fatpvs_t;
+
+byte *SV_FatPVS (vec3_t org, struct qmodel_s *worldmodel);
+byte *SV_CachedFatPVS (vec3_t org, struct qmodel_s *worldmodel, fatpvs_t *cache);
+void SV_ClearFatPVS (fatpvs_t *cache);
+
 void SV_CheckForNewClients (void);
 void SV_RunClients (void);
+void SV_ReadClients (void);
 void SV_SaveSpawnparms (void);
 void SV_SpawnServer (const char *server);
 
+typedef enum
+{
+	SVPROF_OTHER,
+	SVPROF_CLIENTS,			// SV_CheckForNewClients and SV_RunClients
+	SVPROF_STARTFRAME,
+	SVPROF_PHYS_CLIENT,		// one phase per physclass_t, in the same order
+	SVPROF_PHYS_PUSH,
+	SVPROF_PHYS_NONE,
+	SVPROF_PHYS_NOCLIP,
+	SVPROF_PHYS_STEP,
+	SVPROF_PHYS_TOSS,
+	SVPROF_THINK,			// QC think, PlayerPreThink and PlayerPostThink
+	SVPROF_TOUCH,			// QC touch and blocked
+	SVPROF_ENCODE,			// SV_WriteEntitiesToClient
+	SVPROF_SEND,			// rest of SV_SendClientMessages
+	NUM_SVPROF_PHASES
+} svprofphase_t;
+
+typedef struct
+{
+	qboolean	active;			// profiling the current tick
+	qboolean	capture;		// profile even if sv_profile is off, for sv_loadtest
+	int			traces;			// SV_Move calls this tick
+	int			links;			// SV_LinkEdict calls this tick
+	double		times[NUM_SVPROF_PHASES];	// seconds spent in each phase by the last profiled tick
+	double		total;
+} svprofile_t;
+
+extern	svprofile_t	sv_prof;
+
+void SV_Profile_Init (void);
+void SV_ProfileBeginTick (void);
+void SV_ProfileEndTick (void);
+void SV_ProfileEnter (svprofphase_t phase);
+void SV_ProfileLeave (void);
+
+void SV_Metrics_Init (void);
+void SV_MetricsBeginTick (void);
+void SV_MetricsEndTick (void);
+void SV_MetricsFrame (void);
+void SV_MetricsFlush (void);
+void SV_MetricsShutdown (void);
+
+void SV_Bench_Init (void);
+void SV_BenchServerSpawning (void);
+void SV_BenchServerSpawned (void);
+qboolean SV_BenchRecording (void);
+void SV_RecordTick (void);
+void SV_RecordClientConnect (int clientnum);
+void SV_RecordClientDrop (int clientnum);
+void SV_RecordClientCommand (int clientnum, const char *s);
+void SV_RecordClientMove (int clientnum, const vec3_t angles, const usercmd_t *move, int buttons, int impulse);
+unsigned int SV_EdictChecksum (void);
+
 #endif	/* QUAKE_SERVER_H */
@@ -545,6 +545,18 @@ void S_StopSound (int entnum, int entchannel)
 	}
 }
 
+// keeps the ambient and static sounds of the level running
+void S_StopDynamicSounds (void)
+{
+	int	i;
+
+	for (i = NUM_AMBIENTS; i < NUM_AMBIENTS + MAX_DYNAMIC_CHANNELS; i++)
+	{
+		snd_channels[i].end = 0;
+		snd_channels[i].sfx = NULL;
+	}
+}
+
 void S_StopAllSounds (qboolean clear)
 {
 	int		i;
@@ -0,0 +1,108 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// snd_null.c -- sound and music backend for builds without audio
+//
+// Server-only builds link this instead of the mixer, the SDL audio driver
+// and the music codecs.  A dedicated server never starts sound, so these
+// only have to satisfy the client code that is still linked in.
+
+#include "quakedef.h"
+#include "bgmusic.h"
+
+void S_Init (void)
+{
+}
+
+void S_Shutdown (void)
+{
+}
+
+void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation)
+{
+}
+
+void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
+{
+}
+
+void S_StopSound (int entnum, int entchannel)
+{
+}
+
+void S_StopDynamicSounds (void)
+{
+}
+
+void S_StopAllSounds (qboolean clear)
+{
+}
+
+void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+{
+}
+
+sfx_t *S_PrecacheSound (const char *sample)
+{
+	return NULL;
+}
+
+void S_TouchSound (const char *sample)
+{
+}
+
+void S_BeginPrecaching (void)
+{
+}
+
+void S_EndPrecaching (void)
+{
+}
+
+void S_LocalSound (const char *name)
+{
+}
+
+qboolean BGM_Init (void)
+{
+	return false;
+}
+
+void BGM_Shutdown (void)
+{
+}
+
+void BGM_Stop (void)
+{
+}
+
+void BGM_Update (void)
+{
+}
+
+void BGM_Pause (void)
+{
+}
+
+void BGM_Resume (void)
+{
+}
+
+void BGM_PlayCDtrack (byte track, qboolean looping)
+{
+}
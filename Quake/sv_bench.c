@@ -0,0 +1,1061 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// sv_bench.c -- recording of client input and deterministic server replay
+//
+// sv_record captures everything the clients feed into the simulation
+// (connects, string commands, usercmds and disconnects) for every server tick of a
+// map.  sv_bench replays such a recording on a dedicated server through
+// in-process bench clients, runs Host_ServerFrame as fast as possible and
+// reports the tick time distribution plus a checksum of the final edict
+// state, so that optimizations can be checked for speed and determinism.
+//
+// sv_loadtest needs no recording: it fills a map with bench clients that
+// go through the normal signon and then send random moves, and reports how
+// the tick time and the bandwidth per client grow with the client count.
+
+#include "quakedef.h"
+#include "q_stdinc.h"
+#include "arch_def.h"
+#include "net_sys.h"
+#include "net_defs.h"
+#include "net_bench.h"
+
+#define SVBENCH_VERSION		1
+#define SVBENCH_EXTENSION	".svbench"
+
+// record types
+#define SVB_TICK			'T'		// float frametime, long seed
+#define SVB_CONNECT			'C'		// byte client
+#define SVB_STRINGCMD		'K'		// byte client, string
+#define SVB_MOVE			'M'		// byte client, 3 float angles, 3 short moves, byte buttons, byte impulse
+#define SVB_DISCONNECT		'D'		// byte client
+
+static FILE		*svb_file;						// recording in progress
+static char		svb_pendingname[MAX_OSPATH];	// recording starts with the next map
+static qboolean	svb_replaying;
+
+extern	cvar_t	sv_autosave;
+extern	int		sv_protocol;
+
+/*
+===============================================================================
+
+RECORDING
+
+===============================================================================
+*/
+
+static void SVB_WriteByte (int c)
+{
+	fputc (c & 0xff, svb_file);
+}
+
+static void SVB_WriteShort (int s)
+{
+	SVB_WriteByte (s);
+	SVB_WriteByte (s >> 8);
+}
+
+static void SVB_WriteFloat (float f)
+{
+	f = LittleFloat (f);
+	fwrite (&f, 1, sizeof (f), svb_file);
+}
+
+/*
+==================
+SV_BenchRecording
+==================
+*/
+qboolean SV_BenchRecording (void)
+{
+	return svb_file != NULL;
+}
+
+/*
+==================
+SV_StopBenchRecording
+==================
+*/
+static void SV_StopBenchRecording (void)
+{
+	if (!svb_file)
+		return;
+	fclose (svb_file);
+	svb_file = NULL;
+	Con_Printf ("Completed server recording\n");
+}
+
+/*
+==================
+SV_BenchServerSpawning
+
+Called at the start of SV_SpawnServer.  Ends the recording of the previous
+map and seeds the random number generator like sv_bench does, so that the
+spawn functions of the recorded map behave the same on replay.
+==================
+*/
+void SV_BenchServerSpawning (void)
+{
+	SV_StopBenchRecording ();
+
+	if (svb_pendingname[0] && !svb_replaying)
+		srand (0);
+}
+
+/*
+==================
+SV_BenchServerSpawned
+
+Called at the end of SV_SpawnServer to start a pending recording
+==================
+*/
+void SV_BenchServerSpawned (void)
+{
+	int		i;
+
+	if (!svb_pendingname[0] || svb_replaying || !sv.active)
+		return;
+
+	svb_file = Sys_fopen (svb_pendingname, "wb");
+	if (!svb_file)
+	{
+		Con_Printf ("ERROR: couldn't create %s\n", svb_pendingname);
+		svb_pendingname[0] = '\0';
+		return;
+	}
+
+	Con_Printf ("Recording server input to %s\n", svb_pendingname);
+	svb_pendingname[0] = '\0';
+
+	fprintf (svb_file, "IWSVBENCH %d\n", SVBENCH_VERSION);
+	fprintf (svb_file, "map %s\n", sv.name);
+	fprintf (svb_file, "skill %d\n", (int)(skill.value + 0.5f));
+	fprintf (svb_file, "coop %g\n", coop.value);
+	fprintf (svb_file, "deathmatch %g\n", deathmatch.value);
+	fprintf (svb_file, "maxclients %d\n", svs.maxclients);
+	fprintf (svb_file, "protocol %u\n", sv.protocol);
+	fprintf (svb_file, "end\n");
+
+// clients carried over from the previous map reconnect in the first tick
+	for (i = 0; i < svs.maxclients; i++)
+		if (svs.clients[i].active)
+		{
+			SVB_WriteByte (SVB_CONNECT);
+			SVB_WriteByte (i);
+		}
+}
+
+/*
+==================
+SV_RecordTick
+
+Called at the start of every Host_ServerFrame.  The host keeps calling
+rand () between ticks, so every tick gets a fresh seed that is stored
+along with the frame time.
+==================
+*/
+void SV_RecordTick (void)
+{
+	int		seed;
+
+	if (!svb_file)
+		return;
+	seed = rand () & 0x7fffffff;
+	srand (seed);
+	SVB_WriteByte (SVB_TICK);
+	SVB_WriteFloat (host_frametime);
+	SVB_WriteShort (seed);
+	SVB_WriteShort (seed >> 16);
+}
+
+/*
+==================
+SV_RecordClientConnect
+==================
+*/
+void SV_RecordClientConnect (int clientnum)
+{
+	if (!svb_file)
+		return;
+	SVB_WriteByte (SVB_CONNECT);
+	SVB_WriteByte (clientnum);
+}
+
+/*
+==================
+SV_RecordClientDrop
+
+Called when a client is dropped because of something it sent
+==================
+*/
+void SV_RecordClientDrop (int clientnum)
+{
+	if (!svb_file)
+		return;
+	SVB_WriteByte (SVB_DISCONNECT);
+	SVB_WriteByte (clientnum);
+}
+
+/*
+==================
+SV_RecordClientCommand
+==================
+*/
+void SV_RecordClientCommand (int clientnum, const char *s)
+{
+	if (!svb_file)
+		return;
+	SVB_WriteByte (SVB_STRINGCMD);
+	SVB_WriteByte (clientnum);
+	fwrite (s, 1, strlen (s) + 1, svb_file);
+}
+
+/*
+==================
+SV_RecordClientMove
+
+Called by SV_ReadClientMove with the values it just decoded
+==================
+*/
+void SV_RecordClientMove (int clientnum, const vec3_t angles, const usercmd_t *move, int buttons, int impulse)
+{
+	int		i;
+
+	if (!svb_file)
+		return;
+	SVB_WriteByte (SVB_MOVE);
+	SVB_WriteByte (clientnum);
+	for (i = 0; i < 3; i++)
+		SVB_WriteFloat (angles[i]);
+	SVB_WriteShort ((int)move->forwardmove);
+	SVB_WriteShort ((int)move->sidemove);
+	SVB_WriteShort ((int)move->upmove);
+	SVB_WriteByte (buttons);
+	SVB_WriteByte (impulse);
+}
+
+/*
+==================
+SV_Record_f
+
+sv_record <name> [map]
+==================
+*/
+static void SV_Record_f (void)
+{
+	char	relname[MAX_OSPATH];
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc () != 2 && Cmd_Argc () != 3)
+	{
+		Con_Printf ("sv_record <name> [map]\n");
+		return;
+	}
+
+	if (strstr (Cmd_Argv (1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	q_strlcpy (relname, Cmd_Argv (1), sizeof (relname));
+	COM_AddExtension (relname, SVBENCH_EXTENSION, sizeof (relname));
+	q_snprintf (svb_pendingname, sizeof (svb_pendingname), "%s/%s", com_gamedir, relname);
+
+	if (Cmd_Argc () == 3)
+		Cmd_ExecuteString (va ("map %s", Cmd_Argv (2)), src_command);
+	else
+		Con_Printf ("Server recording will start with the next map\n");
+}
+
+/*
+==================
+SV_StopRecord_f
+==================
+*/
+static void SV_StopRecord_f (void)
+{
+	if (cmd_source != src_command)
+		return;
+
+	svb_pendingname[0] = '\0';
+	if (!svb_file)
+	{
+		Con_Printf ("Not recording server input.\n");
+		return;
+	}
+	SV_StopBenchRecording ();
+}
+
+/*
+===============================================================================
+
+REPLAY
+
+===============================================================================
+*/
+
+typedef struct
+{
+	byte		*data;
+	int			size;
+	int			pos;
+	qboolean	bad;
+} svbreader_t;
+
+static int SVB_ReadByte (svbreader_t *r)
+{
+	if (r->pos >= r->size)
+	{
+		r->bad = true;
+		return 0;
+	}
+	return r->data[r->pos++];
+}
+
+static int SVB_ReadShort (svbreader_t *r)
+{
+	int lo = SVB_ReadByte (r);
+	int hi = SVB_ReadByte (r);
+	return (short)(lo | (hi << 8));
+}
+
+static float SVB_ReadFloat (svbreader_t *r)
+{
+	float f;
+	if (r->pos + (int) sizeof (f) > r->size)
+	{
+		r->bad = true;
+		return 0.f;
+	}
+	memcpy (&f, r->data + r->pos, sizeof (f));
+	r->pos += sizeof (f);
+	return LittleFloat (f);
+}
+
+/*
+==================
+SVB_ReadLine
+
+Returns the next header line, or NULL at the end of the data
+==================
+*/
+static const char *SVB_ReadLine (svbreader_t *r)
+{
+	static char	line[256];
+	int			len = 0;
+
+	if (r->pos >= r->size)
+		return NULL;
+	while (r->pos < r->size && r->data[r->pos] != '\n')
+	{
+		if (len < (int) sizeof (line) - 1)
+			line[len++] = r->data[r->pos];
+		r->pos++;
+	}
+	r->pos++;	// skip the newline
+	line[len] = '\0';
+	return line;
+}
+
+/*
+==================
+SV_HashBytes
+
+Folds the COM_HashBlock of another block into hash
+==================
+*/
+static unsigned SV_HashBytes (unsigned hash, const void *data, size_t size)
+{
+	return (hash ^ COM_HashBlock (data, size)) * 0x01000193u;
+}
+
+/*
+==================
+SV_EdictChecksum
+
+Hash of the entity fields of every edict plus the global variables
+==================
+*/
+unsigned int SV_EdictChecksum (void)
+{
+	unsigned	hash = 0x811c9dc5u;
+	edict_t		*ent;
+	byte		isfree;
+	int			i;
+
+	hash = SV_HashBytes (hash, &qcvm->num_edicts, sizeof (qcvm->num_edicts));
+	hash = SV_HashBytes (hash, qcvm->globals, qcvm->progs->numglobals * 4);
+	for (i = 0, ent = qcvm->edicts; i < qcvm->num_edicts; i++, ent = NEXT_EDICT (ent))
+	{
+		isfree = ent->free ? 1 : 0;
+		hash = SV_HashBytes (hash, &isfree, 1);
+		if (!isfree)
+			hash = SV_HashBytes (hash, &ent->v, qcvm->progs->entityfields * 4);
+	}
+
+	return hash;
+}
+
+static int SV_CompareTickTimes (const void *a, const void *b)
+{
+	double da = *(const double *)a;
+	double db = *(const double *)b;
+	return (da > db) - (da < db);
+}
+
+/*
+==================
+SV_PrintBenchReport
+==================
+*/
+static void SV_PrintBenchReport (double *ticktimes, int numticks, double total, unsigned int checksum)
+{
+	double	mean;
+
+	if (!numticks)
+	{
+		Con_Printf ("sv_bench: no ticks recorded\n");
+		return;
+	}
+
+	qsort (ticktimes, numticks, sizeof (ticktimes[0]), SV_CompareTickTimes);
+	mean = total / numticks;
+
+	Con_Printf ("sv_bench: %d ticks in %.3f s (%.1f ticks/s)\n", numticks, total, total > 0.0 ? numticks / total : 0.0);
+	Con_Printf ("tick ms: min %.3f | p50 %.3f | p90 %.3f | p99 %.3f | max %.3f | mean %.3f\n",
+		ticktimes[0] * 1000.0,
+		ticktimes[numticks / 2] * 1000.0,
+		ticktimes[(int)(numticks * 0.90)] * 1000.0,
+		ticktimes[(int)(numticks * 0.99)] * 1000.0,
+		ticktimes[numticks - 1] * 1000.0,
+		mean * 1000.0);
+	Con_Printf ("edict checksum: %08x (%d edicts)\n", checksum, qcvm->num_edicts);
+}
+
+/*
+==================
+SV_Bench_f
+
+sv_bench <name>
+
+Replays a server recording as fast as possible.  Only available on
+dedicated servers, since a local client would add its own input.
+==================
+*/
+static void SV_Bench_f (void)
+{
+	char			relname[MAX_OSPATH];
+	char			mapname[MAX_QPATH];
+	svbreader_t		r;
+	benchclient_t	*clients[MAX_SCOREBOARD];
+	sizebuf_t		msgs[MAX_SCOREBOARD];
+	byte			*msgdata;
+	double			*ticktimes;
+	double			total, start, autosave;
+	const char		*line;
+	int				i, c, type, numticks, maxticks, maxclients, protocol, skillnum, seed;
+	float			frametime, coopvalue, dmvalue;
+	unsigned int	checksum;
+	qboolean		havetick, overflow;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc () != 2)
+	{
+		Con_Printf ("sv_bench <name>\n");
+		return;
+	}
+
+	if (cls.state != ca_dedicated)
+	{
+		Con_Printf ("sv_bench is only available on dedicated servers\n");
+		return;
+	}
+
+	q_strlcpy (relname, Cmd_Argv (1), sizeof (relname));
+	COM_AddExtension (relname, SVBENCH_EXTENSION, sizeof (relname));
+	memset (&r, 0, sizeof (r));
+	r.data = COM_LoadMallocFile (relname, NULL);
+	if (!r.data)
+	{
+		Con_Printf ("ERROR: couldn't open %s\n", relname);
+		return;
+	}
+	r.size = com_filesize;
+
+// parse the header
+	mapname[0] = '\0';
+	skillnum = 0;
+	coopvalue = dmvalue = 0.f;
+	maxclients = 1;
+	protocol = sv_protocol;
+
+	line = SVB_ReadLine (&r);
+	if (!line || sscanf (line, "IWSVBENCH %d", &i) != 1 || i != SVBENCH_VERSION)
+	{
+		Con_Printf ("ERROR: %s is not a version %d server recording\n", relname, SVBENCH_VERSION);
+		free (r.data);
+		return;
+	}
+	while ((line = SVB_ReadLine (&r)) != NULL && strcmp (line, "end"))
+	{
+		if (sscanf (line, "map %63s", mapname) == 1)
+			continue;
+		if (sscanf (line, "skill %d", &skillnum) == 1)
+			continue;
+		if (sscanf (line, "coop %f", &coopvalue) == 1)
+			continue;
+		if (sscanf (line, "deathmatch %f", &dmvalue) == 1)
+			continue;
+		if (sscanf (line, "maxclients %d", &maxclients) == 1)
+			continue;
+		sscanf (line, "protocol %d", &protocol);
+	}
+	if (!line || !mapname[0])
+	{
+		Con_Printf ("ERROR: bad header in %s\n", relname);
+		free (r.data);
+		return;
+	}
+	if (maxclients < 1 || maxclients > svs.maxclientslimit)
+	{
+		Con_Printf ("ERROR: %s needs %d client slots, server has %d\n", relname, maxclients, svs.maxclientslimit);
+		free (r.data);
+		return;
+	}
+
+// set up the server exactly like the recording one
+	SV_StopBenchRecording ();
+	Host_ShutdownServer (false);
+
+	svs.maxclients = maxclients;
+	svs.serverflags = 0;
+	Cvar_SetValueQuick (&skill, skillnum);
+	Cvar_SetValueQuick (&coop, coopvalue);
+	Cvar_SetValueQuick (&deathmatch, dmvalue);
+	sv_protocol = protocol;
+	autosave = sv_autosave.value;
+	Cvar_SetValueQuick (&sv_autosave, 0.f);
+
+	svb_replaying = true;
+	srand (0);
+
+	PR_SwitchQCVM (&sv.qcvm);
+	SV_SpawnServer (mapname);
+	PR_SwitchQCVM (NULL);
+	if (!sv.active)
+	{
+		svb_replaying = false;
+		Cvar_SetValueQuick (&sv_autosave, autosave);
+		free (r.data);
+		return;
+	}
+
+	Con_Printf ("Replaying %s on %s\n", relname, mapname);
+
+	memset (clients, 0, sizeof (clients));
+	msgdata = (byte *) malloc (MAX_SCOREBOARD * MAX_MSGLEN);
+	for (i = 0; i < MAX_SCOREBOARD; i++)
+	{
+		msgs[i].data = msgdata + i * MAX_MSGLEN;
+		msgs[i].maxsize = MAX_MSGLEN;
+		msgs[i].cursize = 0;
+		msgs[i].allowoverflow = true;
+	}
+
+	maxticks = 4096;
+	ticktimes = (double *) malloc (maxticks * sizeof (double));
+	numticks = 0;
+	total = 0.0;
+	frametime = 0.f;
+	seed = 0;
+	havetick = false;
+	overflow = false;
+
+// run the recorded ticks
+	while (!r.bad)
+	{
+		type = (r.pos < r.size) ? SVB_ReadByte (&r) : SVB_TICK;
+
+		if (type == SVB_TICK)
+		{
+			if (havetick)
+			{
+				for (i = 0; i < MAX_SCOREBOARD; i++)
+				{
+					if (!msgs[i].cursize)
+						continue;
+					// recorded input that gets lost makes the checksum meaningless
+					if (clients[i] && !clients[i]->closed && !Bench_QueueMessage (clients[i], 1, &msgs[i]))
+					{
+						Con_Printf ("ERROR: input queue of client %d overflowed at tick %d\n", i, numticks);
+						overflow = true;
+						break;
+					}
+					SZ_Clear (&msgs[i]);
+				}
+				if (overflow)
+					break;
+
+				host_frametime = frametime;
+				srand (seed);
+				PR_SwitchQCVM (&sv.qcvm);
+				start = Sys_DoubleTime ();
+				Host_ServerFrame ();
+				start = Sys_DoubleTime () - start;
+				PR_SwitchQCVM (NULL);
+
+				if (numticks == maxticks)
+				{
+					maxticks *= 2;
+					ticktimes = (double *) realloc (ticktimes, maxticks * sizeof (double));
+					if (!ticktimes)
+						Sys_Error ("SV_Bench_f: out of memory");
+				}
+				ticktimes[numticks++] = start;
+				total += start;
+
+				if (!sv.active)
+				{
+					Con_Printf ("sv_bench: server stopped after %d ticks\n", numticks);
+					break;
+				}
+			}
+
+			if (r.pos >= r.size)
+				break;
+			frametime = SVB_ReadFloat (&r);
+			seed = SVB_ReadShort (&r) & 0xffff;
+			seed |= (SVB_ReadShort (&r) & 0xffff) << 16;
+			havetick = true;
+			continue;
+		}
+
+		c = SVB_ReadByte (&r);
+		if (c < 0 || c >= maxclients)
+		{
+			r.bad = true;
+			break;
+		}
+
+		switch (type)
+		{
+		case SVB_CONNECT:
+			if (clients[c])
+				Bench_FreeClient (clients[c]);
+			clients[c] = Bench_NewClient ();
+			SZ_Clear (&msgs[c]);
+			break;
+
+		case SVB_STRINGCMD:
+			MSG_WriteByte (&msgs[c], clc_stringcmd);
+			while ((i = SVB_ReadByte (&r)) != 0 && !r.bad)
+				MSG_WriteChar (&msgs[c], i);
+			MSG_WriteByte (&msgs[c], 0);
+			break;
+
+		case SVB_MOVE:
+			MSG_WriteByte (&msgs[c], clc_move);
+			MSG_WriteFloat (&msgs[c], sv.qcvm.time);
+			for (i = 0; i < 3; i++)
+			{
+				if (sv.protocol == PROTOCOL_NETQUAKE)
+					MSG_WriteAngle (&msgs[c], SVB_ReadFloat (&r), sv.protocolflags);
+				else
+					MSG_WriteAngle16 (&msgs[c], SVB_ReadFloat (&r), sv.protocolflags);
+			}
+			for (i = 0; i < 3; i++)
+				MSG_WriteShort (&msgs[c], SVB_ReadShort (&r));
+			MSG_WriteByte (&msgs[c], SVB_ReadByte (&r));
+			MSG_WriteByte (&msgs[c], SVB_ReadByte (&r));
+			break;
+
+		case SVB_DISCONNECT:
+			MSG_WriteByte (&msgs[c], clc_disconnect);
+			break;
+
+		default:
+			r.bad = true;
+			break;
+		}
+	}
+
+	if (r.bad)
+		Con_Printf ("WARNING: %s is truncated or corrupt\n", relname);
+
+	checksum = 0;
+	if (overflow)
+		Con_Printf ("sv_bench: replay of %s aborted\n", relname);
+	else if (sv.active)
+	{
+		PR_SwitchQCVM (&sv.qcvm);
+		checksum = SV_EdictChecksum ();
+		SV_PrintBenchReport (ticktimes, numticks, total, checksum);
+		PR_SwitchQCVM (NULL);
+
+		for (i = 0; i < maxclients; i++)
+			if (clients[i])
+				Con_Printf ("client %d: %u reliable bytes in %u messages, %u unreliable bytes in %u messages\n", i,
+					clients[i]->reliablebytes, clients[i]->reliablemessages,
+					clients[i]->unreliablebytes, clients[i]->unreliablemessages);
+	}
+
+	Host_ShutdownServer (false);
+	for (i = 0; i < MAX_SCOREBOARD; i++)
+		if (clients[i])
+			Bench_FreeClient (clients[i]);
+
+	free (ticktimes);
+	free (msgdata);
+	free (r.data);
+
+	Cvar_SetValueQuick (&sv_autosave, autosave);
+	svb_replaying = false;
+}
+
+/*
+===============================================================================
+
+LOAD TEST
+
+===============================================================================
+*/
+
+typedef struct
+{
+	benchclient_t	*bc;
+	int				state;			// LT_*
+	float			yaw;
+	int				forward, side;
+	unsigned int	received;		// bytes at the start of the measured ticks
+} loadclient_t;
+
+enum
+{
+	LT_CONNECTING,
+	LT_PRESPAWN,					// sent "prespawn", waiting for the signon buffers
+	LT_SPAWNING,					// sent "spawn" and "begin"
+	LT_PLAYING
+};
+
+static unsigned int lt_seed;
+
+static unsigned int SV_LoadTestRand (void)
+{
+	lt_seed = lt_seed * 1103515245 + 12345;
+	return lt_seed >> 16;
+}
+
+/*
+==================
+SV_LoadTestClientSlot
+==================
+*/
+static client_t *SV_LoadTestClientSlot (benchclient_t *bc)
+{
+	int		i;
+
+	if (!bc->sock)
+		return NULL;
+	for (i = 0; i < svs.maxclients; i++)
+		if (svs.clients[i].active && svs.clients[i].netconnection == bc->sock)
+			return &svs.clients[i];
+	return NULL;
+}
+
+/*
+==================
+SV_LoadTestClientInput
+
+Queues what a real client would send this tick: the signon replies while
+connecting, then a move that changes direction now and then, jumps and fires
+==================
+*/
+static void SV_LoadTestClientInput (loadclient_t *lc, sizebuf_t *msg)
+{
+	client_t	*cl = SV_LoadTestClientSlot (lc->bc);
+	int			bits;
+
+	SZ_Clear (msg);
+	if (!cl)
+		return;
+
+	switch (lc->state)
+	{
+	case LT_CONNECTING:
+		MSG_WriteByte (msg, clc_stringcmd);
+		MSG_WriteString (msg, "prespawn");
+		lc->state = LT_PRESPAWN;
+		break;
+
+	case LT_PRESPAWN:
+		if (cl->sendsignon != PRESPAWN_DONE)
+			break;
+		MSG_WriteByte (msg, clc_stringcmd);
+		MSG_WriteString (msg, "spawn");
+		MSG_WriteByte (msg, clc_stringcmd);
+		MSG_WriteString (msg, "begin");
+		lc->state = LT_SPAWNING;
+		break;
+
+	case LT_SPAWNING:
+	case LT_PLAYING:
+		if (!cl->spawned)
+			break;
+		lc->state = LT_PLAYING;
+
+		if (!(SV_LoadTestRand () & 31))
+		{
+			lc->forward = (int)(SV_LoadTestRand () % 3) * 200 - 200;
+			lc->side = (int)(SV_LoadTestRand () % 3) * 200 - 200;
+		}
+		lc->yaw = anglemod (lc->yaw + (float)(SV_LoadTestRand () % 21) - 10.f);
+
+		bits = 0;
+		if (!(SV_LoadTestRand () & 7))
+			bits |= 1;
+		if (!(SV_LoadTestRand () & 31))
+			bits |= 2;
+
+		MSG_WriteByte (msg, clc_move);
+		MSG_WriteFloat (msg, sv.qcvm.time);
+		if (sv.protocol == PROTOCOL_NETQUAKE)
+		{
+			MSG_WriteAngle (msg, 0.f, sv.protocolflags);
+			MSG_WriteAngle (msg, lc->yaw, sv.protocolflags);
+			MSG_WriteAngle (msg, 0.f, sv.protocolflags);
+		}
+		else
+		{
+			MSG_WriteAngle16 (msg, 0.f, sv.protocolflags);
+			MSG_WriteAngle16 (msg, lc->yaw, sv.protocolflags);
+			MSG_WriteAngle16 (msg, 0.f, sv.protocolflags);
+		}
+		MSG_WriteShort (msg, lc->forward);
+		MSG_WriteShort (msg, lc->side);
+		MSG_WriteShort (msg, 0);
+		MSG_WriteByte (msg, bits);
+		MSG_WriteByte (msg, 0);
+		break;
+	}
+
+	if (msg->cursize)
+		Bench_QueueMessage (lc->bc, lc->state == LT_PLAYING ? 2 : 1, msg);
+}
+
+/*
+==================
+SV_LoadTestRun
+
+Runs one map with numclients bench clients, returns false if the server
+didn't come up
+==================
+*/
+static qboolean SV_LoadTestRun (const char *mapname, int numclients, int numticks)
+{
+	loadclient_t	clients[MAX_SCOREBOARD];
+	sizebuf_t		msg;
+	byte			msgdata[MAX_DATAGRAM];
+	double			*ticktimes;
+	double			total, send, encode;
+	double			bytes;
+	int				i, tick, warmup, playing;
+
+	Host_ShutdownServer (false);
+	svs.maxclients = numclients;
+
+	PR_SwitchQCVM (&sv.qcvm);
+	SV_SpawnServer (mapname);
+	PR_SwitchQCVM (NULL);
+	if (!sv.active)
+		return false;
+
+	memset (clients, 0, sizeof (clients));
+	for (i = 0; i < numclients; i++)
+	{
+		clients[i].bc = Bench_NewClient ();
+		clients[i].yaw = (float)(SV_LoadTestRand () % 360);
+	}
+
+	msg.data = msgdata;
+	msg.maxsize = sizeof (msgdata);
+	msg.cursize = 0;
+	msg.allowoverflow = true;
+
+	ticktimes = (double *) malloc (numticks * sizeof (double));
+	if (!ticktimes)
+		Sys_Error ("SV_LoadTestRun: out of memory");
+
+	host_frametime = q_max (sys_ticrate.value, 0.001f);
+
+// connect everyone, giving up on stragglers after 10 seconds of game time
+	warmup = (int)(10.f / host_frametime);
+	for (tick = 0; tick < warmup && sv.active; tick++)
+	{
+		for (i = 0, playing = 0; i < numclients; i++)
+		{
+			SV_LoadTestClientInput (&clients[i], &msg);
+			if (clients[i].state == LT_PLAYING)
+				playing++;
+		}
+		if (playing == numclients)
+			break;
+
+		PR_SwitchQCVM (&sv.qcvm);
+		Host_ServerFrame ();
+		PR_SwitchQCVM (NULL);
+	}
+
+	for (i = 0; i < numclients; i++)
+		clients[i].received = clients[i].bc->reliablebytes + clients[i].bc->unreliablebytes;
+
+// measure
+	total = send = encode = 0.0;
+	sv_prof.capture = true;
+	for (tick = 0; tick < numticks && sv.active; tick++)
+	{
+		for (i = 0; i < numclients; i++)
+			SV_LoadTestClientInput (&clients[i], &msg);
+
+		PR_SwitchQCVM (&sv.qcvm);
+		Host_ServerFrame ();
+		PR_SwitchQCVM (NULL);
+
+		ticktimes[tick] = sv_prof.total;
+		total += sv_prof.total;
+		send += sv_prof.times[SVPROF_SEND];
+		encode += sv_prof.times[SVPROF_ENCODE];
+	}
+	sv_prof.capture = false;
+
+	bytes = 0.0;
+	for (i = 0, playing = 0; i < numclients; i++)
+	{
+		if (clients[i].state == LT_PLAYING && !clients[i].bc->closed)
+			playing++;
+		bytes += clients[i].bc->reliablebytes + clients[i].bc->unreliablebytes - clients[i].received;
+	}
+
+	if (tick)
+	{
+		qsort (ticktimes, tick, sizeof (ticktimes[0]), SV_CompareTickTimes);
+		Con_Printf ("%7d %7d %8.3f %8.3f %8.3f %8.3f %10.0f\n",
+			numclients, playing,
+			total * 1000.0 / tick,
+			ticktimes[(int)(tick * 0.99)] * 1000.0,
+			(send + encode) * 1000.0 / tick,
+			encode * 1000.0 / tick,
+			bytes / tick / numclients);
+	}
+
+	Host_ShutdownServer (false);
+	for (i = 0; i < numclients; i++)
+		Bench_FreeClient (clients[i].bc);
+	free (ticktimes);
+
+	return tick > 0;
+}
+
+/*
+==================
+SV_LoadTest_f
+
+sv_loadtest <map> <maxclients> [ticks] [step]
+
+Runs the map with step, 2*step, ... maxclients bench clients for the given
+number of ticks each.  Only available on dedicated servers.
+==================
+*/
+static void SV_LoadTest_f (void)
+{
+	char		mapname[MAX_QPATH];
+	int			maxclients, numticks, step, n;
+	float		autosave;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc () < 3 || Cmd_Argc () > 5)
+	{
+		Con_Printf ("sv_loadtest <map> <maxclients> [ticks] [step]\n");
+		return;
+	}
+
+	if (cls.state != ca_dedicated)
+	{
+		Con_Printf ("sv_loadtest is only available on dedicated servers\n");
+		return;
+	}
+
+	q_strlcpy (mapname, Cmd_Argv (1), sizeof (mapname));
+	maxclients = Q_atoi (Cmd_Argv (2));
+	numticks = Cmd_Argc () > 3 ? Q_atoi (Cmd_Argv (3)) : 600;
+	step = Cmd_Argc () > 4 ? Q_atoi (Cmd_Argv (4)) : 0;
+
+	if (maxclients < 1 || maxclients > svs.maxclientslimit)
+	{
+		Con_Printf ("maxclients must be between 1 and %d\n", svs.maxclientslimit);
+		return;
+	}
+	numticks = q_max (numticks, 1);
+	if (step <= 0)
+		step = q_max (maxclients / 4, 1);
+
+	SV_StopBenchRecording ();
+	autosave = sv_autosave.value;
+	Cvar_SetValueQuick (&sv_autosave, 0.f);
+	svb_replaying = true;
+	lt_seed = 0;
+
+	Con_Printf ("Load test on %s, %d ticks of %.1f ms\n", mapname, numticks, q_max (sys_ticrate.value, 0.001f) * 1000.0);
+	Con_Printf ("clients playing  tick ms   p99 ms  send ms   encode  bytes/cl\n");
+
+	for (n = q_min (step, maxclients); ; n = q_min (n + step, maxclients))
+	{
+		if (!SV_LoadTestRun (mapname, n, numticks))
+		{
+			Con_Printf ("sv_loadtest: server stopped with %d clients\n", n);
+			break;
+		}
+		if (n == maxclients)
+			break;
+	}
+
+	Cvar_SetValueQuick (&sv_autosave, autosave);
+	svb_replaying = false;
+}
+
+/*
+==================
+SV_Bench_Init
+==================
+*/
+void SV_Bench_Init (void)
+{
+	Cmd_AddCommand ("sv_record", SV_Record_f);
+	Cmd_AddCommand ("sv_stoprecord", SV_StopRecord_f);
+	Cmd_AddCommand ("sv_bench", SV_Bench_f);
+	Cmd_AddCommand ("sv_loadtest", SV_LoadTest_f);
+}
@@ -34,6 +34,16 @@ int		sv_protocol = PROTOCOL_RMQ; //johnfitz
 extern cvar_t nomonsters;
 
 static cvar_t sv_netsort = {"sv_netsort", "1", CVAR_NONE};
+static cvar_t sv_pvsindex = {"sv_pvsindex", "1", CVAR_NONE};	// find visible entities through the leaf index
+static cvar_t sv_sharedencode = {"sv_sharedencode", "1", CVAR_NONE};	// encode entity updates once for all clients
+static cvar_t sv_threads = {"sv_threads", "1", CVAR_NONE};	// build client datagrams on worker threads
+static cvar_t sv_deltaframes = {"sv_deltaframes", "1", CVAR_NONE};	// offer PRFL_DELTAFRAMES to clients, demos they record only play in engines that know it
+static cvar_t sv_moveseq = {"sv_moveseq", "1", CVAR_NONE};	// offer PRFL_MOVESEQ (client prediction) to clients
+static cvar_t sv_deflate = {"sv_deflate", "1", CVAR_NONE};	// offer PRFL_DEFLATE (compressed reliable messages) to clients
+static cvar_t sv_maxrate = {"sv_maxrate", "0", CVAR_NONE};	// bytes per second for each remote client, 0 = unlimited.  Datagrams are skipped while a client is over it, only PRFL_DELTAFRAMES clients also get fewer entity updates
+static cvar_t sv_phs = {"sv_phs", "1", CVAR_NONE};	// only send sounds and effects to the clients that can hear them
+static cvar_t sv_hibernate = {"sv_hibernate", "0", CVAR_NONE};	// seconds without clients before a dedicated server stops, 0 = never
+static cvar_t sv_hibernate_reload = {"sv_hibernate_reload", "0", CVAR_NONE};	// restart the map for the next client instead of resuming it
 
 //============================================================================
 
@@ -147,11 +157,14 @@ void SV_Init (void)
 	extern	cvar_t	sv_gravity;
 	extern	cvar_t	sv_nostep;
 	extern	cvar_t	sv_freezenonclients;
+	extern	cvar_t	sv_physicsbuckets;
+	extern	cvar_t	sv_fastrelink;
 	extern	cvar_t	sv_friction;
 	extern	cvar_t	sv_edgefriction;
 	extern	cvar_t	sv_stopspeed;
 	extern	cvar_t	sv_maxspeed;
 	extern	cvar_t	sv_accelerate;
+	extern	cvar_t	sv_jumpvelocity;
 	extern	cvar_t	sv_idealpitchscale;
 	extern	cvar_t	sv_aim;
 	extern	cvar_t	sv_altnoclip; //johnfitz
@@ -170,10 +183,23 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_maxspeed);
 	Cvar_SetCallback (&sv_maxspeed, Host_Callback_Notify);
 	Cvar_RegisterVariable (&sv_accelerate);
+	Cvar_RegisterVariable (&sv_jumpvelocity);
 	Cvar_RegisterVariable (&sv_idealpitchscale);
 	Cvar_RegisterVariable (&sv_aim);
 	Cvar_RegisterVariable (&sv_nostep);
 	Cvar_RegisterVariable (&sv_freezenonclients);
+	Cvar_RegisterVariable (&sv_physicsbuckets);
+	Cvar_RegisterVariable (&sv_fastrelink);
+	Cvar_RegisterVariable (&sv_pvsindex);
+	Cvar_RegisterVariable (&sv_sharedencode);
+	Cvar_RegisterVariable (&sv_threads);
+	Cvar_RegisterVariable (&sv_deltaframes);
+	Cvar_RegisterVariable (&sv_moveseq);
+	Cvar_RegisterVariable (&sv_deflate);
+	Cvar_RegisterVariable (&sv_maxrate);
+	Cvar_RegisterVariable (&sv_phs);
+	Cvar_RegisterVariable (&sv_hibernate);
+	Cvar_RegisterVariable (&sv_hibernate_reload);
 	Cvar_RegisterVariable (&pr_checkextension);
 	Cvar_RegisterVariable (&sv_altnoclip); //johnfitz
 	Cvar_RegisterVariable (&sv_gameplayfix_random);
@@ -183,6 +209,9 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_autosave_interval);
 
 	Cmd_AddCommand ("sv_protocol", &SV_Protocol_f); //johnfitz
+	SV_Profile_Init ();
+	SV_Metrics_Init ();
+	SV_Bench_Init ();
 
 	for (i=0 ; i<MAX_MODELS ; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -217,23 +246,54 @@ EVENT MESSAGES
 =============================================================================
 */
 
+/*
+==================
+SV_Multicast
+
+Marks what was written to sv.multicast since offset as one message, to be
+sent to the clients that can hear origin, or to all of them if origin is
+NULL.  Callers check SV_CanMulticast first.
+==================
+*/
+static void SV_Multicast (const vec3_t origin, int offset)
+{
+	multicast_t	*m;
+	mleaf_t		*leaf;
+
+	m = &sv.multicasts[sv.nummulticasts++];
+	m->offset = offset;
+	m->length = sv.multicast.cursize - offset;
+	m->leafnum = -1;
+	if (origin)
+	{
+		leaf = Mod_PointInLeaf ((float *) origin, sv.worldmodel);
+		m->leafnum = (int)(leaf - sv.worldmodel->leafs) - 1;	// -1 for the solid leaf
+	}
+}
+
+static qboolean SV_CanMulticast (int size)
+{
+	return sv.multicast.cursize <= MAX_DATAGRAM - size && sv.nummulticasts < MAX_MULTICASTS;
+}
+
 /*
 ==================
 SV_StartParticle
 
-Make sure the event gets sent to all clients
+Make sure the event gets sent to all clients that can see it
 ==================
 */
 void SV_StartParticle (vec3_t org, vec3_t dir, int color, int count)
 {
-	int		i, v;
+	int		i, v, start;
 
-	if (sv.datagram.cursize > MAX_DATAGRAM-18)
+	if (!SV_CanMulticast (18))
 		return;
-	MSG_WriteByte (&sv.datagram, svc_particle);
-	MSG_WriteCoord (&sv.datagram, org[0], sv.protocolflags);
-	MSG_WriteCoord (&sv.datagram, org[1], sv.protocolflags);
-	MSG_WriteCoord (&sv.datagram, org[2], sv.protocolflags);
+	start = sv.multicast.cursize;
+	MSG_WriteByte (&sv.multicast, svc_particle);
+	MSG_WriteCoord (&sv.multicast, org[0], sv.protocolflags);
+	MSG_WriteCoord (&sv.multicast, org[1], sv.protocolflags);
+	MSG_WriteCoord (&sv.multicast, org[2], sv.protocolflags);
 	for (i=0 ; i<3 ; i++)
 	{
 		v = dir[i]*16;
@@ -241,10 +301,11 @@ void SV_StartParticle (vec3_t org, vec3_t dir, int color, int count)
 			v = 127;
 		else if (v < -128)
 			v = -128;
-		MSG_WriteChar (&sv.datagram, v);
+		MSG_WriteChar (&sv.multicast, v);
 	}
-	MSG_WriteByte (&sv.datagram, count);
-	MSG_WriteByte (&sv.datagram, color);
+	MSG_WriteByte (&sv.multicast, count);
+	MSG_WriteByte (&sv.multicast, color);
+	SV_Multicast (org, start);
 }
 
 /*
@@ -265,7 +326,8 @@ Larger attenuations will drop off.  (max 4 attenuation)
 void SV_StartSound (edict_t *entity, int channel, const char *sample, int volume, float attenuation)
 {
 	int			sound_num, ent;
-	int			i, field_mask;
+	int			i, field_mask, start;
+	vec3_t		origin;
 
 	if (volume < 0 || volume > 255)
 		Host_Error ("SV_StartSound: volume = %i", volume);
@@ -276,7 +338,7 @@ void SV_StartSound (edict_t *entity, int channel, const char *sample, int volume
 	if (channel < 0 || channel > 7)
 		Host_Error ("SV_StartSound: channel = %i", channel);
 
-	if (sv.datagram.cursize > MAX_DATAGRAM-21)
+	if (!SV_CanMulticast (21))
 		return;
 
 // find precache number for sound
@@ -315,33 +377,40 @@ void SV_StartSound (edict_t *entity, int channel, const char *sample, int volume
 	}
 	//johnfitz
 
-	if (sv.datagram.cursize > MAX_DATAGRAM-21)
+	if (!SV_CanMulticast (21))
 		return;
 
 // directed messages go only to the entity the are targeted on
-	MSG_WriteByte (&sv.datagram, svc_sound);
-	MSG_WriteByte (&sv.datagram, field_mask);
+	start = sv.multicast.cursize;
+	MSG_WriteByte (&sv.multicast, svc_sound);
+	MSG_WriteByte (&sv.multicast, field_mask);
 	if (field_mask & SND_VOLUME)
-		MSG_WriteByte (&sv.datagram, volume);
+		MSG_WriteByte (&sv.multicast, volume);
 	if (field_mask & SND_ATTENUATION)
-		MSG_WriteByte (&sv.datagram, attenuation*64);
+		MSG_WriteByte (&sv.multicast, attenuation*64);
 
 	//johnfitz -- PROTOCOL_FITZQUAKE
 	if (field_mask & SND_LARGEENTITY)
 	{
-		MSG_WriteShort (&sv.datagram, ent);
-		MSG_WriteByte (&sv.datagram, channel);
+		MSG_WriteShort (&sv.multicast, ent);
+		MSG_WriteByte (&sv.multicast, channel);
 	}
 	else
-		MSG_WriteShort (&sv.datagram, (ent<<3) | channel);
+		MSG_WriteShort (&sv.multicast, (ent<<3) | channel);
 	if (field_mask & SND_LARGESOUND)
-		MSG_WriteShort (&sv.datagram, sound_num);
+		MSG_WriteShort (&sv.multicast, sound_num);
 	else
-		MSG_WriteByte (&sv.datagram, sound_num);
+		MSG_WriteByte (&sv.multicast, sound_num);
 	//johnfitz
 
 	for (i = 0; i < 3; i++)
-		MSG_WriteCoord (&sv.datagram, entity->v.origin[i]+0.5*(entity->v.mins[i]+entity->v.maxs[i]), sv.protocolflags);
+	{
+		origin[i] = entity->v.origin[i]+0.5*(entity->v.mins[i]+entity->v.maxs[i]);
+		MSG_WriteCoord (&sv.multicast, origin[i], sv.protocolflags);
+	}
+
+	// full volume sounds are heard in the whole level
+	SV_Multicast (attenuation ? origin : NULL, start);
 }
 
 /*
@@ -396,6 +465,35 @@ static qboolean SV_IsLocalClient (client_t *client)
 	return Q_strcmp (NET_QSocketGetAddressString (client->netconnection), "LOCAL") == 0;
 }
 
+static deltaframe_t	sv_deltahistory[MAX_SCOREBOARD][DELTA_BACKUP];
+static float		*sv_entpriority[MAX_SCOREBOARD];	// per entity, grows until it is sent
+
+/*
+=============
+SV_ClearDeltaFrames
+=============
+*/
+static void SV_ClearDeltaFrames (client_t *client)
+{
+	int		i;
+
+	client->deltaframes = false;
+	client->deltasequence = 0;
+	client->deltaack = 0;
+	for (i = 0; i < DELTA_BACKUP; i++)
+		sv_deltahistory[client - svs.clients][i].sequence = 0;
+
+	// entity numbers mean something else on the new map
+	i = client - svs.clients;
+	if (!sv_entpriority[i])
+	{
+		sv_entpriority[i] = (float *) malloc (MAX_EDICTS * sizeof (float));
+		if (!sv_entpriority[i])
+			Sys_Error ("SV_ClearDeltaFrames: out of memory");
+	}
+	memset (sv_entpriority[i], 0, MAX_EDICTS * sizeof (float));
+}
+
 /*
 ================
 SV_SendServerinfo
@@ -458,6 +556,16 @@ void SV_SendServerinfo (client_t *client)
 
 	client->sendsignon = PRESPAWN_FLUSH;
 	client->spawned = false;		// need prespawn, spawn, etc
+
+	SV_ClearDeltaFrames (client);	// until the client acknowledges a frame on this map
+
+	client->moveseqs = false;
+	client->moveseq = 0;
+	client->movevarsvalid = false;
+
+	client->deflate = false;
+	client->deflatein = 0;
+	client->deflateout = 0;
 }
 
 /*
@@ -546,6 +654,7 @@ void SV_CheckForNewClients (void)
 
 		svs.clients[i].netconnection = ret;
 		SV_ConnectClient (i);
+		SV_RecordClientConnect (i);
 
 		net_activeconnections++;
 	}
@@ -569,6 +678,385 @@ SV_ClearDatagram
 void SV_ClearDatagram (void)
 {
 	SZ_Clear (&sv.datagram);
+	SZ_Clear (&sv.multicast);
+	sv.nummulticasts = 0;
+}
+
+/*
+==================
+SV_UpdateHibernation
+
+Returns true while a dedicated server that has been empty for sv_hibernate
+seconds should only listen for new clients.  Simulation time stands still
+until one connects.  With sv_hibernate_reload, the map is restarted when
+the server goes to sleep, so the next client gets a fresh one.
+==================
+*/
+qboolean SV_UpdateHibernation (void)
+{
+	int		i;
+
+	for (i = 0; i < svs.maxclients; i++)
+		if (svs.clients[i].active)
+			break;
+
+	if (i < svs.maxclients || cls.state != ca_dedicated || sv_hibernate.value <= 0.f)
+	{
+		if (svs.hibernating)
+		{
+			svs.hibernating = false;
+			svs.hibernatetotal += realtime - svs.hibernatestart;
+			Con_Printf ("Resuming after %.0f seconds of hibernation\n", realtime - svs.hibernatestart);
+		}
+		svs.emptytime = realtime;
+		return false;
+	}
+
+	if (svs.hibernating)
+		return true;
+	if (realtime - svs.emptytime < sv_hibernate.value)
+		return false;
+
+	svs.hibernating = true;
+	svs.hibernatestart = realtime;
+	Con_Printf ("No clients for %g seconds, hibernating\n", sv_hibernate.value);
+	if (sv_hibernate_reload.value)
+		Cbuf_AddText ("restart\n");
+
+	return true;
+}
+
+/*
+==================
+SV_HibernationTime
+
+Seconds spent hibernating, including the current hibernation
+==================
+*/
+double SV_HibernationTime (void)
+{
+	if (svs.hibernating)
+		return svs.hibernatetotal + realtime - svs.hibernatestart;
+	return svs.hibernatetotal;
+}
+
+/*
+=============================================================================
+
+The PHS (potentially hearable set) of a leaf is the union of the PVS of
+every leaf visible from it.  Sounds and effects in sv.multicast only go to
+the clients in the PHS of the leaf they come from.
+
+The table grows with the square of the leaf count, so on big maps only the
+rows of the leafs that multicasts actually come from are built, on demand.
+
+=============================================================================
+*/
+
+#define MAX_PHS_SIZE		(32 * 1024 * 1024)	// bytes per table, bigger maps build rows on demand
+#define MAX_PHS_LAZYROWS	16		// rows built on demand per frame, later multicasts go everywhere
+
+static byte	*sv_phsrows;		// row i holds the leafs that can hear leaf i+1, bit j for leaf j+1
+static byte	*sv_phspvs;			// the same for the PVS, only while building
+static int	sv_phsrowbytes;
+
+static byte		**sv_phslazy;		// [sv_phslazyleafs] rows built so far on big maps, NULL if not
+static int		sv_phslazyleafs;
+static size_t	sv_phslazysize;		// bytes held by them
+static byte		*sv_phslazypvs;		// two rows of scratch space
+static int		sv_phslazyframe;
+static int		sv_phslazybuilt;	// rows built during sv_phslazyframe
+
+static void SV_DecompressPVSTask (int index, int worker, void *param)
+{
+	Mod_DecompressLeafPVS (sv.worldmodel->leafs + 1 + index, sv.worldmodel, sv_phspvs + (size_t) index * sv_phsrowbytes);
+}
+
+static void SV_BuildPHSTask (int index, int worker, void *param)
+{
+	const byte		*pvs;
+	const uint32_t	*src;
+	uint32_t		*dst;
+	int				i, j, words;
+
+	words = sv_phsrowbytes >> 2;
+	pvs = sv_phspvs + (size_t) index * sv_phsrowbytes;
+	dst = (uint32_t *) (sv_phsrows + (size_t) index * sv_phsrowbytes);
+	memcpy (dst, pvs, sv_phsrowbytes);
+
+	for (i = 0; i < sv.worldmodel->numleafs; i++)
+	{
+		if (!(pvs[i >> 3] & (1 << (i & 7))))
+			continue;
+		src = (const uint32_t *) (sv_phspvs + (size_t) i * sv_phsrowbytes);
+		for (j = 0; j < words; j++)
+			dst[j] |= src[j];
+	}
+}
+
+/*
+==================
+SV_FreeLazyPHS
+==================
+*/
+static void SV_FreeLazyPHS (void)
+{
+	int		i;
+
+	if (!sv_phslazy)
+		return;
+	for (i = 0; i < sv_phslazyleafs; i++)
+		free (sv_phslazy[i]);
+	memset (sv_phslazy, 0, sv_phslazyleafs * sizeof (sv_phslazy[0]));
+	sv_phslazysize = 0;
+}
+
+/*
+==================
+SV_PHSRow
+
+Returns the PHS row of leaf index, or NULL if it isn't known yet
+==================
+*/
+static const byte *SV_PHSRow (int index)
+{
+	qmodel_t		*model = sv.worldmodel;
+	byte			*row, *pvs;
+	const uint32_t	*src;
+	uint32_t		*dst;
+	int				i, j, words;
+
+	if (sv_phsrows)
+		return sv_phsrows + (size_t) index * sv_phsrowbytes;
+	if (!sv_phslazy)
+		return NULL;
+	if (sv_phslazy[index])
+		return sv_phslazy[index];
+
+	// spread the cost of a busy area over a few frames
+	if (sv_phslazyframe != host_framecount)
+	{
+		sv_phslazyframe = host_framecount;
+		sv_phslazybuilt = 0;
+	}
+	if (sv_phslazybuilt == MAX_PHS_LAZYROWS)
+		return NULL;
+	sv_phslazybuilt++;
+
+	if (sv_phslazysize + sv_phsrowbytes > MAX_PHS_SIZE)
+		SV_FreeLazyPHS ();
+
+	row = (byte *) calloc (1, sv_phsrowbytes);
+	if (!row)
+		Sys_Error ("SV_PHSRow: out of memory");
+	pvs = sv_phslazypvs + sv_phsrowbytes;
+	Mod_DecompressLeafPVS (model->leafs + 1 + index, model, row);
+
+	words = sv_phsrowbytes >> 2;
+	dst = (uint32_t *) row;
+	src = (const uint32_t *) pvs;
+	memcpy (sv_phslazypvs, row, sv_phsrowbytes);
+	for (i = 0; i < model->numleafs; i++)
+	{
+		if (!(sv_phslazypvs[i >> 3] & (1 << (i & 7))))
+			continue;
+		Mod_DecompressLeafPVS (model->leafs + 1 + i, model, pvs);
+		for (j = 0; j < words; j++)
+			dst[j] |= src[j];
+	}
+
+	sv_phslazy[index] = row;
+	sv_phslazysize += sv_phsrowbytes;
+	return row;
+}
+
+/*
+==================
+SV_CalcPHS
+
+Builds the PHS of the new map, decompressing the PVS and merging the rows
+of each leaf on worker threads
+==================
+*/
+static void SV_CalcPHS (void)
+{
+	qmodel_t	*model = sv.worldmodel;
+	size_t		size;
+	double		time;
+	int			numleafs;
+
+	free (sv_phsrows);
+	sv_phsrows = NULL;
+	SV_FreeLazyPHS ();
+	free (sv_phslazy);
+	free (sv_phslazypvs);
+	sv_phslazy = NULL;
+	sv_phslazypvs = NULL;
+
+	numleafs = model->numleafs;
+	if (!sv_phs.value || !model->visdata || numleafs <= 0)
+		return;
+
+	sv_phsrowbytes = ((numleafs + 31) >> 5) << 2;
+	size = (size_t) numleafs * sv_phsrowbytes;
+	if (size > MAX_PHS_SIZE)
+	{
+		sv_phslazy = (byte **) calloc (numleafs, sizeof (sv_phslazy[0]));
+		sv_phslazypvs = (byte *) calloc (2, sv_phsrowbytes);
+		if (!sv_phslazy || !sv_phslazypvs)
+			Sys_Error ("SV_CalcPHS: out of memory for %d leafs", numleafs);
+		sv_phslazyleafs = numleafs;
+		Con_DPrintf ("PHS: %d leafs, building rows on demand\n", numleafs);
+		return;
+	}
+
+	time = Sys_DoubleTime ();
+	sv_phspvs = (byte *) calloc (1, size);
+	sv_phsrows = (byte *) malloc (size);
+	if (!sv_phspvs || !sv_phsrows)
+		Sys_Error ("SV_CalcPHS: out of memory for %d leafs", numleafs);
+
+	Tasks_ParallelFor (numleafs, SV_DecompressPVSTask, NULL);
+	Tasks_ParallelFor (numleafs, SV_BuildPHSTask, NULL);
+
+	free (sv_phspvs);
+	sv_phspvs = NULL;
+
+	Con_DPrintf ("PHS: %d leafs in %.1f ms\n", numleafs, (Sys_DoubleTime () - time) * 1000.0);
+}
+
+static int SV_CoordSize (void)
+{
+	if (sv.protocolflags & (PRFL_FLOATCOORD | PRFL_INT32COORD))
+		return 4;
+	if (sv.protocolflags & PRFL_24BITCOORD)
+		return 3;
+	return 2;
+}
+
+// reads back a coordinate written by MSG_WriteCoord
+static float SV_PeekCoord (const byte *p)
+{
+	union { int i; float f; } dat;
+
+	if (sv.protocolflags & (PRFL_FLOATCOORD | PRFL_INT32COORD))
+	{
+		dat.i = p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24);
+		if (sv.protocolflags & PRFL_FLOATCOORD)
+			return dat.f;
+		return dat.i * (1.0 / 16.0);
+	}
+	if (sv.protocolflags & PRFL_24BITCOORD)
+		return (short) (p[0] | (p[1] << 8)) + p[2] * (1.0 / 255);
+	return (short) (p[0] | (p[1] << 8)) * (1.0 / 8);
+}
+
+/*
+==================
+SV_TempEntityLength
+
+Returns the size of a svc_temp_entity message of the given type and where
+its origin starts, or 0 for types the server doesn't know
+==================
+*/
+static int SV_TempEntityLength (int type, int *originofs)
+{
+	int		coord = SV_CoordSize ();
+
+	switch (type)
+	{
+	case TE_SPIKE:
+	case TE_SUPERSPIKE:
+	case TE_GUNSHOT:
+	case TE_EXPLOSION:
+	case TE_TAREXPLOSION:
+	case TE_WIZSPIKE:
+	case TE_KNIGHTSPIKE:
+	case TE_LAVASPLASH:
+	case TE_TELEPORT:
+		*originofs = 2;
+		return 2 + 3*coord;
+	case TE_EXPLOSION2:
+		*originofs = 2;
+		return 2 + 3*coord + 2;
+	case TE_LIGHTNING1:
+	case TE_LIGHTNING2:
+	case TE_LIGHTNING3:
+	case TE_BEAM:
+		*originofs = 4;		// after the entity, the start of the beam
+		return 4 + 6*coord;
+	default:
+		return 0;
+	}
+}
+
+/*
+==================
+SV_SplitBroadcasts
+
+Moves the temp entities QC wrote to MSG_BROADCAST from the start of
+sv.datagram to sv.multicast.  Stops at the first message it can't parse,
+everything from there on still goes to all clients.
+==================
+*/
+static void SV_SplitBroadcasts (void)
+{
+	byte	*data = sv.datagram.data;
+	int		i, pos, len, originofs, start;
+	vec3_t	origin;
+
+	for (pos = 0; pos + 2 <= sv.datagram.cursize && data[pos] == svc_temp_entity; pos += len)
+	{
+		len = SV_TempEntityLength (data[pos + 1], &originofs);
+		if (!len || pos + len > sv.datagram.cursize || !SV_CanMulticast (len))
+			break;
+		for (i = 0; i < 3; i++)
+			origin[i] = SV_PeekCoord (data + pos + originofs + i*SV_CoordSize ());
+		start = sv.multicast.cursize;
+		SZ_Write (&sv.multicast, data + pos, len);
+		SV_Multicast (origin, start);
+	}
+
+	if (pos)
+	{
+		memmove (data, data + pos, sv.datagram.cursize - pos);
+		sv.datagram.cursize -= pos;
+	}
+}
+
+/*
+==================
+SV_WriteMulticasts
+
+Copies the messages in sv.multicast the client can hear to msg, as long
+as there is space
+==================
+*/
+static void SV_WriteMulticasts (client_t *client, sizebuf_t *msg)
+{
+	const byte	*row;
+	multicast_t	*m;
+	vec3_t		org;
+	int			i, leafnum;
+
+	leafnum = -1;
+	if (sv_phs.value && (sv_phsrows || sv_phslazy))
+	{
+		VectorAdd (client->edict->v.origin, client->edict->v.view_ofs, org);
+		leafnum = (int)(Mod_PointInLeaf (org, sv.worldmodel) - sv.worldmodel->leafs) - 1;
+	}
+
+	for (i = 0, m = sv.multicasts; i < sv.nummulticasts; i++, m++)
+	{
+		if (leafnum >= 0 && m->leafnum >= 0)
+		{
+			row = SV_PHSRow (m->leafnum);
+			if (row && !(row[leafnum >> 3] & (1 << (leafnum & 7))))
+				continue;
+		}
+		if (msg->cursize + m->length < msg->maxsize)
+			SZ_Write (msg, sv.multicast.data + m->offset, m->length);
+	}
 }
 
 /*
@@ -586,6 +1074,8 @@ static int	fatbytes;
 static byte	*fatpvs;
 static int	fatpvs_capacity;
 
+static fatpvs_t	sv_clientfatpvs[MAX_SCOREBOARD];
+
 void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz -- added worldmodel as a parameter
 {
 	int		i;
@@ -645,6 +1135,113 @@ byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel) //johnfitz -- added worldmode
 	return fatpvs;
 }
 
+/*
+=============
+SV_FindFatPVSLeafs
+
+Collects the non-solid leafs SV_AddToFatPVS would visit, in the same order.
+Returns false if there are more than MAX_FATPVS_LEAFS of them.
+=============
+*/
+static qboolean SV_FindFatPVSLeafs (vec3_t org, mnode_t *node, qmodel_t *worldmodel, int *leafs, int *numleafs)
+{
+	mplane_t	*plane;
+	float		d;
+
+	while (1)
+	{
+		if (node->contents < 0)
+		{
+			if (node->contents != CONTENTS_SOLID)
+			{
+				if (*numleafs == MAX_FATPVS_LEAFS)
+					return false;
+				leafs[(*numleafs)++] = (mleaf_t *)node - worldmodel->leafs;
+			}
+			return true;
+		}
+
+		plane = node->plane;
+		d = DotProduct (org, plane->normal) - plane->dist;
+		if (d > 8)
+			node = node->children[0];
+		else if (d < -8)
+			node = node->children[1];
+		else
+		{	// go down both
+			if (!SV_FindFatPVSLeafs (org, node->children[0], worldmodel, leafs, numleafs))
+				return false;
+			node = node->children[1];
+		}
+	}
+}
+
+/*
+=============
+SV_ClearFatPVS
+=============
+*/
+void SV_ClearFatPVS (fatpvs_t *cache)
+{
+	cache->model = NULL;
+	cache->numleafs = 0;
+}
+
+/*
+=============
+SV_CachedFatPVS
+
+Same as SV_FatPVS, but the result is kept in cache and only rebuilt when
+the set of leafs within 8 units of org changes.  The returned buffer
+always belongs to the cache, even when it couldn't be reused.
+=============
+*/
+byte *SV_CachedFatPVS (vec3_t org, qmodel_t *worldmodel, fatpvs_t *cache)
+{
+	int		leafs[MAX_FATPVS_LEAFS];
+	int		numleafs, bytes, i, j;
+	qboolean	cacheable;
+	byte	*pvs;
+
+	numleafs = 0;
+	cacheable = SV_FindFatPVSLeafs (org, worldmodel->nodes, worldmodel, leafs, &numleafs);
+	if (cacheable && cache->model == worldmodel && cache->numleafs == numleafs &&
+		!memcmp (cache->leafs, leafs, numleafs * sizeof (leafs[0])))
+		return cache->pvs;
+
+	bytes = (worldmodel->numleafs+7)>>3;
+	if (cache->pvs == NULL || bytes > cache->capacity)
+	{
+		cache->capacity = bytes;
+		cache->pvs = (byte *) realloc (cache->pvs, cache->capacity);
+		if (!cache->pvs)
+			Sys_Error ("SV_CachedFatPVS: realloc() failed on %d bytes", cache->capacity);
+	}
+
+	if (!cacheable)
+	{
+		SV_ClearFatPVS (cache);
+		memcpy (cache->pvs, SV_FatPVS (org, worldmodel), bytes);
+		return cache->pvs;
+	}
+
+	Q_memset (cache->pvs, 0, bytes);
+	for (i = 0; i < numleafs; i++)
+	{
+		pvs = Mod_LeafPVS (worldmodel->leafs + leafs[i], worldmodel);
+		for (j = 0; j < bytes; j++)
+			cache->pvs[j] |= pvs[j];
+	}
+
+	cache->model = worldmodel;
+	cache->numleafs = numleafs;
+	memcpy (cache->leafs, leafs, numleafs * sizeof (leafs[0]));
+
+	return cache->pvs;
+}
+
+extern qboolean SV_BoxInPVS (vec3_t mins, vec3_t maxs, byte *pvs, mnode_t *node);
+
 /*
 =============
 SV_EdictInPVS
@@ -653,6 +1250,11 @@ SV_EdictInPVS
 qboolean SV_EdictInPVS (edict_t *test, byte *pvs)
 {
 	int i;
+
+	// the leaf list is truncated, so walk the subtree the bounds fall in instead
+	if (test->num_leafs == MAX_ENT_LEAFS)
+		return SV_BoxInPVS (test->v.absmin, test->v.absmax, pvs, sv.worldmodel->nodes + test->headnode);
+
 	for (i = 0 ; i < test->num_leafs ; i++)
 		if (pvs[test->leafnums[i] >> 3] & (1 << (test->leafnums[i] & 7)))
 			return true;
@@ -679,54 +1281,416 @@ qboolean SV_VisibleToClient (edict_t *client, edict_t *test, qmodel_t *worldmode
 
 //=============================================================================
 
-#define MAX_NET_EDICTS 65536
+#define MAX_NET_EDICTS 65536
+
+// per-thread working set of SV_WriteVisibleEntities
+typedef struct
+{
+	uint16_t		edicts[MAX_NET_EDICTS];
+	byte			edict_dists[MAX_NET_EDICTS];
+	int				edict_bins[256];
+	uint16_t		edicts_sorted[MAX_NET_EDICTS];
+	byte			sorted_dists[MAX_NET_EDICTS];	// edict_dists in edicts_sorted order
+	int				candidates[MAX_EDICTS];
+	edictmarks_t	marks;
+} netscratch_t;
+
+static netscratch_t	net_mainscratch;
+static netscratch_t	*net_scratch[MAX_TASK_WORKERS] = {&net_mainscratch};
+
+// entity updates encoded during the current SV_SendClientMessages call
+#define MAX_ENTITY_UPDATE 40
+
+typedef struct
+{
+	int		frame;		// net_encodeframe when the update was encoded
+	int		offset;		// into net_encodebuf
+	int		length;		// 0 if the entity is not sent
+} encodedent_t;
+
+static encodedent_t	net_encoded[MAX_EDICTS];
+static byte			net_encodedata[MAX_EDICTS * MAX_ENTITY_UPDATE];
+static sizebuf_t	net_encodebuf = {false, false, net_encodedata, sizeof (net_encodedata), 0};
+static int			net_encodeframe;
+static qboolean		net_encodelocked;	// set while worker threads read net_encoded
+
+/*
+=============
+SV_PrepareEntityUpdate
+
+Refreshes the alpha and scale of an entity, returns false if it
+shouldn't be sent at all.  Only needed once per frame.
+=============
+*/
+static qboolean SV_PrepareEntityUpdate (edict_t *ent)
+{
+	eval_t	*val;
+
+	//johnfitz -- alpha
+	// TODO: find a cleaner place to put this code
+	val = GetEdictFieldValueByName(ent, "alpha");
+	if (val)
+		ent->alpha = ENTALPHA_ENCODE(val->_float);
+
+	//don't send invisible entities unless they have effects
+	if (ent->alpha == ENTALPHA_ZERO && !((int)ent->v.effects & qcvm->effects_mask))
+		return false;
+	//johnfitz
+
+	val = GetEdictFieldValueByName(ent, "scale");
+	if (val)
+		ent->scale = ENTSCALE_ENCODE(val->_float);
+	else
+		ent->scale = ENTSCALE_DEFAULT;
+
+	return true;
+}
+
+/*
+=============
+SV_WriteEntityDelta
+
+Writes the update of entity e relative to the state in from.  If to is
+not NULL, it receives the state the client ends up with.  Only reads the
+entity, so it is safe to call from worker threads.
+=============
+*/
+static void SV_WriteEntityDelta (edict_t *ent, int e, const entity_state_t *from, entity_state_t *to, sizebuf_t *msg)
+{
+	int		i, bits;
+	float	miss;
+
+	bits = 0;
+
+	for (i=0 ; i<3 ; i++)
+	{
+		miss = ent->v.origin[i] - from->origin[i];
+		if ( miss < -0.1 || miss > 0.1 )
+			bits |= U_ORIGIN1<<i;
+	}
+
+	if ( ent->v.angles[0] != from->angles[0] )
+		bits |= U_ANGLE1;
+
+	if ( ent->v.angles[1] != from->angles[1] )
+		bits |= U_ANGLE2;
+
+	if ( ent->v.angles[2] != from->angles[2] )
+		bits |= U_ANGLE3;
+
+	if (ent->v.movetype == MOVETYPE_STEP)
+		bits |= U_STEP;	// don't mess up the step animation
+
+	if (from->colormap != ent->v.colormap)
+		bits |= U_COLORMAP;
+
+	if (from->skin != ent->v.skin)
+		bits |= U_SKIN;
+
+	if (from->frame != ent->v.frame)
+		bits |= U_FRAME;
+
+	if ((from->effects ^ (int)ent->v.effects) & qcvm->effects_mask)
+		bits |= U_EFFECTS;
+
+	if (from->modelindex != ent->v.modelindex)
+		bits |= U_MODEL;
+
+	//johnfitz -- PROTOCOL_FITZQUAKE
+	if (sv.protocol != PROTOCOL_NETQUAKE)
+	{
+
+		if (from->alpha != ent->alpha) bits |= U_ALPHA;
+		if (from->scale != ent->scale) bits |= U_SCALE;
+		if (bits & U_FRAME && (int)ent->v.frame & 0xFF00) bits |= U_FRAME2;
+		if (bits & U_MODEL && (int)ent->v.modelindex & 0xFF00) bits |= U_MODEL2;
+		if (ent->sendinterval) bits |= U_LERPFINISH;
+		if (bits >= 65536) bits |= U_EXTEND1;
+		if (bits >= 16777216) bits |= U_EXTEND2;
+	}
+	//johnfitz
+
+	if (e >= 256)
+		bits |= U_LONGENTITY;
+
+	if (bits >= 256)
+		bits |= U_MOREBITS;
+
+//
+// write the message
+//
+	MSG_WriteByte (msg, bits | U_SIGNAL);
+
+	if (bits & U_MOREBITS)
+		MSG_WriteByte (msg, bits>>8);
+
+	//johnfitz -- PROTOCOL_FITZQUAKE
+	if (bits & U_EXTEND1)
+		MSG_WriteByte(msg, bits>>16);
+	if (bits & U_EXTEND2)
+		MSG_WriteByte(msg, bits>>24);
+	//johnfitz
+
+	if (bits & U_LONGENTITY)
+		MSG_WriteShort (msg,e);
+	else
+		MSG_WriteByte (msg,e);
+
+	if (bits & U_MODEL)
+		MSG_WriteByte (msg,	ent->v.modelindex);
+	if (bits & U_FRAME)
+		MSG_WriteByte (msg, ent->v.frame);
+	if (bits & U_COLORMAP)
+		MSG_WriteByte (msg, ent->v.colormap);
+	if (bits & U_SKIN)
+		MSG_WriteByte (msg, ent->v.skin);
+	if (bits & U_EFFECTS)
+		MSG_WriteByte (msg, (int)ent->v.effects & qcvm->effects_mask);
+	if (bits & U_ORIGIN1)
+		MSG_WriteCoord (msg, ent->v.origin[0], sv.protocolflags);
+	if (bits & U_ANGLE1)
+		MSG_WriteAngle(msg, ent->v.angles[0], sv.protocolflags);
+	if (bits & U_ORIGIN2)
+		MSG_WriteCoord (msg, ent->v.origin[1], sv.protocolflags);
+	if (bits & U_ANGLE2)
+		MSG_WriteAngle(msg, ent->v.angles[1], sv.protocolflags);
+	if (bits & U_ORIGIN3)
+		MSG_WriteCoord (msg, ent->v.origin[2], sv.protocolflags);
+	if (bits & U_ANGLE3)
+		MSG_WriteAngle(msg, ent->v.angles[2], sv.protocolflags);
+
+	//johnfitz -- PROTOCOL_FITZQUAKE
+	if (bits & U_ALPHA)
+		MSG_WriteByte(msg, ent->alpha);
+	if (bits & U_SCALE)
+		MSG_WriteByte(msg, ent->scale);
+	if (bits & U_FRAME2)
+		MSG_WriteByte(msg, (int)ent->v.frame >> 8);
+	if (bits & U_MODEL2)
+		MSG_WriteByte(msg, (int)ent->v.modelindex >> 8);
+	if (bits & U_LERPFINISH)
+		MSG_WriteByte(msg, (byte)(Q_rint((ent->v.nextthink-qcvm->time)*255)));
+	//johnfitz
+
+	if (!to)
+		return;
+	for (i=0 ; i<3 ; i++)
+		to->origin[i] = (bits & (U_ORIGIN1<<i)) ? ent->v.origin[i] : from->origin[i];
+	to->angles[0] = (bits & U_ANGLE1) ? ent->v.angles[0] : from->angles[0];
+	to->angles[1] = (bits & U_ANGLE2) ? ent->v.angles[1] : from->angles[1];
+	to->angles[2] = (bits & U_ANGLE3) ? ent->v.angles[2] : from->angles[2];
+	to->modelindex = (bits & U_MODEL) ? (int)ent->v.modelindex & ((bits & U_MODEL2) ? 0xFFFF : 0xFF) : from->modelindex;
+	to->frame = (bits & U_FRAME) ? (int)ent->v.frame & ((bits & U_FRAME2) ? 0xFFFF : 0xFF) : from->frame;
+	to->colormap = (bits & U_COLORMAP) ? (byte)ent->v.colormap : from->colormap;
+	to->skin = (bits & U_SKIN) ? (byte)ent->v.skin : from->skin;
+	to->effects = (bits & U_EFFECTS) ? (byte)((int)ent->v.effects & qcvm->effects_mask) : from->effects;
+	to->alpha = (bits & U_ALPHA) ? ent->alpha : from->alpha;
+	to->scale = (bits & U_SCALE) ? ent->scale : from->scale;
+}
+
+/*
+=============
+SV_WriteEntityHold
+
+Writes an update of entity e that leaves the client with the state in
+from, for entities that can wait for a later frame.  Costs two or three
+bytes, but the client would remove the entity if it got nothing at all.
+=============
+*/
+static void SV_WriteEntityHold (edict_t *ent, int e, const entity_state_t *from, entity_state_t *to, sizebuf_t *msg)
+{
+	int		bits;
+
+	bits = 0;
+	if (ent->v.movetype == MOVETYPE_STEP)
+		bits |= U_STEP;	// don't mess up the step animation
+	if (e >= 256)
+		bits |= U_LONGENTITY;
+	if (bits >= 256)
+		bits |= U_MOREBITS;
+
+	MSG_WriteByte (msg, bits | U_SIGNAL);
+	if (bits & U_MOREBITS)
+		MSG_WriteByte (msg, bits>>8);
+	if (bits & U_LONGENTITY)
+		MSG_WriteShort (msg, e);
+	else
+		MSG_WriteByte (msg, e);
+
+	*to = *from;
+}
+
+/*
+=============
+SV_WriteEntityUpdate
+
+Writes the update of entity e against its baseline, returns false
+if the entity shouldn't be sent at all.  The result only depends on
+the entity and the server state, not on the client it is sent to.
+=============
+*/
+static qboolean SV_WriteEntityUpdate (edict_t *ent, int e, sizebuf_t *msg)
+{
+	if (!SV_PrepareEntityUpdate (ent))
+		return false;
+	SV_WriteEntityDelta (ent, e, &ent->baseline, NULL, msg);
+	return true;
+}
+
+/*
+=============
+SV_BeginDeltaFrame
+
+Writes svc_deltaframe and returns the frame to record the entities sent
+to clent in, or NULL if the client doesn't use delta frames.  ref is set
+to the last frame the client acknowledged, or NULL to use the baselines.
+=============
+*/
+static deltaframe_t *SV_BeginDeltaFrame (edict_t *clent, sizebuf_t *msg, const deltaframe_t **ref)
+{
+	client_t		*client;
+	deltaframe_t	*frames;
+	int				num, sequence, ack;
+
+	*ref = NULL;
+
+	num = NUM_FOR_EDICT (clent);
+	if (num < 1 || num > svs.maxclients)
+		return NULL;
+	client = &svs.clients[num - 1];
+	if (!client->deltaframes)
+		return NULL;
+
+	frames = sv_deltahistory[num - 1];
+	sequence = ++client->deltasequence;
+	ack = client->deltaack;
+	if (ack > 0 && sequence - ack < DELTA_BACKUP && frames[ack & DELTA_MASK].sequence == ack)
+		*ref = &frames[ack & DELTA_MASK];
+	else
+		ack = 0;
+
+	MSG_WriteByte (msg, svc_deltaframe);
+	MSG_WriteLong (msg, sequence);
+	MSG_WriteLong (msg, ack);
+
+	Delta_BeginFrame (&frames[sequence & DELTA_MASK], sequence);
+	return &frames[sequence & DELTA_MASK];
+}
+
+/*
+=============
+SV_SortByPriority
+
+Adds to the priority of every entity in edicts_sorted according to its
+distance and direction, then stores them in edicts by decreasing priority.
+The client's own entity and entities missing from ref come first, since
+they can't be held.
+=============
+*/
+#define RATE_NEARDIST	16		// sort keys below this are updated every frame
+
+static void SV_SortByPriority (netscratch_t *scratch, int numents, const deltaframe_t *ref, float *priority)
+{
+	int		i, j, e, key;
+	float	weight;
+
+	memset (scratch->edict_bins, 0, sizeof (scratch->edict_bins));
+
+	for (j=0 ; j<numents ; j++)
+	{
+		e = scratch->edicts_sorted[j];
+		if (j == 0 || !Delta_FindEntity (ref, e))
+			key = 255;
+		else
+		{
+			weight = 1.f;
+			if (sv_netsort.value)
+			{
+				key = scratch->sorted_dists[j];
+				if ((key & 127) > RATE_NEARDIST)
+					weight = (float) RATE_NEARDIST / (key & 127);
+				if (key & 128)
+					weight *= 0.5f;	// behind the client
+			}
+			priority[e] += weight;
+			key = (int) q_min (priority[e] * 16.f, 254.f);
+		}
+		scratch->edict_dists[j] = 255 - key;
+		scratch->edict_bins[255 - key]++;
+	}
+
+	e = 0;
+	for (i=0 ; i<countof(scratch->edict_bins) ; i++)
+	{
+		int tmp = scratch->edict_bins[i];
+		scratch->edict_bins[i] = e;
+		e += tmp;
+	}
 
-static uint16_t		net_edicts[MAX_NET_EDICTS];
-static byte			net_edict_dists[MAX_NET_EDICTS];
-static int			net_edict_bins[256];
-static uint16_t		net_edicts_sorted[MAX_NET_EDICTS];
+	for (j=0 ; j<numents ; j++)
+		scratch->edicts[scratch->edict_bins[scratch->edict_dists[j]]++] = scratch->edicts_sorted[j];
+}
 
 /*
 =============
-SV_WriteEntitiesToClient
-
+SV_WriteVisibleEntities
+
+Writes the entities in pvs to msg, closest first, until it is full.
+Clients with a byte budget get them by priority instead, see
+SV_SortByPriority.
+Returns false if some of them didn't fit.  Doesn't touch any shared state
+besides net_encodebuf when net_encodelocked is clear, so it can run for
+different clients on different threads.
 =============
 */
-void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
+static qboolean SV_WriteVisibleEntities (edict_t *clent, byte *pvs, sizebuf_t *msg, netscratch_t *scratch)
 {
-	int		e, i, j, numents;
-	int		bits;
-	byte	*pvs;
+	int		e, i, j, k, numents, numcandidates;
 	vec3_t	org, forward, right, up;
-	float	miss, dist, size;
-	eval_t	*val;
+	float	dist, size;
 	edict_t	*ent;
+	qboolean	complete = true;
+	deltaframe_t		*frame;
+	const deltaframe_t	*ref;
+	const entity_state_t	*from;
+	const uint16_t	*list;
+	float		*priority;
+	int			ratelimit;
+	client_t	*client;
 
-// find the client's PVS
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org, sv.worldmodel);
 
 // find the client's orientation
 	AngleVectors (clent->v.v_angle, forward, right, up);
 
 // reset sorting bins
-	memset (net_edict_bins, 0, sizeof (net_edict_bins));
+	memset (scratch->edict_bins, 0, sizeof (scratch->edict_bins));
 
 // add clent
 	if (sv_netsort.value)
 	{
-		net_edicts[0] = NUM_FOR_EDICT (clent);
-		net_edict_dists[0] = 0;
-		net_edict_bins[0] = 1;
+		scratch->edicts[0] = NUM_FOR_EDICT (clent);
+		scratch->edict_dists[0] = 0;
+		scratch->edict_bins[0] = 1;
 	}
 	else
-		net_edicts_sorted[0] = NUM_FOR_EDICT (clent);
+		scratch->edicts_sorted[0] = NUM_FOR_EDICT (clent);
 	numents = 1;
 
 // add all other entities that touch the pvs
-	ent = NEXT_EDICT(qcvm->edicts);
-	for (e=1 ; e<qcvm->num_edicts ; e++, ent = NEXT_EDICT(ent))
+	if (sv_pvsindex.value)
+		numcandidates = SV_FindPVSEdicts (pvs, scratch->candidates, &scratch->marks);
+	else
+	{
+		for (e=1 ; e<qcvm->num_edicts ; e++)
+			scratch->candidates[e-1] = e;
+		numcandidates = qcvm->num_edicts - 1;
+	}
+
+	for (k=0 ; k<numcandidates ; k++)
 	{
+		e = scratch->candidates[k];
+		ent = EDICT_NUM(e);
 		if (ent != clent)	// clent already added before the loop
 		{
 			// ignore ents without visible models
@@ -738,17 +1702,9 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 				continue;
 
 			// ignore if not touching a PV leaf
-			for (i=0 ; i < ent->num_leafs ; i++)
-				if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
-					break;
-			
-			// ericw -- added ent->num_leafs < MAX_ENT_LEAFS condition.
-			//
-			// if ent->num_leafs == MAX_ENT_LEAFS, the ent is visible from too many leafs
-			// for us to say whether it's in the PVS, so don't try to vis cull it.
-			// this commonly happens with rotators, because they often have huge bboxes
-			// spanning the entire map, or really tall lifts, etc.
-			if (i == ent->num_leafs && ent->num_leafs < MAX_ENT_LEAFS)
+			// entities with more than MAX_ENT_LEAFS leafs (rotators with huge bboxes,
+			// really tall lifts, etc.) are tested against the BSP subtree under their headnode
+			if (!SV_EdictInPVS (ent, pvs))
 				continue;		// not visible
 
 			if (sv_netsort.value)
@@ -766,20 +1722,20 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 
 				// use scaled square root of (distance/size) as sort key
 				dist = 8.f * sqrt (sqrt (dist/size));
-				net_edict_dists[numents] = (int) q_min (dist, 255.f);
-				net_edicts[numents] = e;
+				scratch->edict_dists[numents] = (int) q_min (dist, 255.f);
+				scratch->edicts[numents] = e;
 
 				// compute max distance along forward axis
 				dist = 0.f;
 				for (i=0 ; i<3 ; i++)
 					dist += ((forward[i] < 0.f ? ent->v.absmin[i] : ent->v.absmax[i]) - org[i]) * forward[i];
 				if (dist < 0.f)
-					net_edict_dists[numents] |= 128; // deprioritize entities behind the client
+					scratch->edict_dists[numents] |= 128; // deprioritize entities behind the client
 
-				net_edict_bins[net_edict_dists[numents]]++;
+				scratch->edict_bins[scratch->edict_dists[numents]]++;
 			}
 			else
-				net_edicts_sorted[numents] = e;
+				scratch->edicts_sorted[numents] = e;
 
 			if (++numents == MAX_NET_EDICTS)
 				break;
@@ -792,173 +1748,126 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 	{
 		// compute bin offsets
 		e = 0;
-		for (i=0 ; i<countof(net_edict_bins) ; i++)
+		for (i=0 ; i<countof(scratch->edict_bins) ; i++)
 		{
-			int tmp = net_edict_bins[i];
-			net_edict_bins[i] = e;
+			int tmp = scratch->edict_bins[i];
+			scratch->edict_bins[i] = e;
 			e += tmp;
 		}
 
 		// generate sorted list
 		for (e=0 ; e<numents ; e++)
-			net_edicts_sorted[net_edict_bins[net_edict_dists[e]]++] = net_edicts[e];
+		{
+			i = scratch->edict_bins[scratch->edict_dists[e]]++;
+			scratch->edicts_sorted[i] = scratch->edicts[e];
+			scratch->sorted_dists[i] = scratch->edict_dists[e];
+		}
+	}
+
+// start a new delta frame if the client acknowledges them
+	frame = SV_BeginDeltaFrame (clent, msg, &ref);
+
+// with a byte budget, the entities that waited longest for their distance
+// go first and the rest are held at what the client already has
+	list = scratch->edicts_sorted;
+	priority = NULL;
+	ratelimit = 0;
+	if (frame && ref)
+	{
+		client = &svs.clients[NUM_FOR_EDICT (clent) - 1];
+		ratelimit = client->ratelimit;
+		if (ratelimit)
+		{
+			priority = sv_entpriority[client - svs.clients];
+			SV_SortByPriority (scratch, numents, ref, priority);
+			list = scratch->edicts;
+		}
 	}
 
 // send entities (closest first)
 	for (j=0 ; j<numents ; j++)
 	{
-		e = net_edicts_sorted[j];
+		e = list[j];
 		ent = EDICT_NUM (e);
 
 		// johnfitz -- max size for protocol 15 is 18 bytes, not 16 as originally
 		// assumed here.  And, for protocol 85 the max size is actually 24 bytes.
 		// For float coords and angles the limit is 40.
 		// FIXME: Use tighter limit according to protocol flags and send bits.
-		if (msg->cursize + 40 > msg->maxsize)
+		if (msg->cursize + MAX_ENTITY_UPDATE > msg->maxsize)
 		{
-			//johnfitz -- less spammy overflow message
-			if (!dev_overflows.packetsize || dev_overflows.packetsize + CONSOLE_RESPAM_TIME < realtime )
-			{
-				Con_Printf ("Packet overflow!\n");
-				dev_overflows.packetsize = realtime;
-			}
-			goto stats;
-			//johnfitz
+			complete = false;
+			break;
 		}
 
 // send an update
-		bits = 0;
-
-		for (i=0 ; i<3 ; i++)
+		if (!sv_sharedencode.value)
 		{
-			miss = ent->v.origin[i] - ent->baseline.origin[i];
-			if ( miss < -0.1 || miss > 0.1 )
-				bits |= U_ORIGIN1<<i;
+			if (!SV_PrepareEntityUpdate (ent))
+				continue;
+			if (!frame)
+			{
+				SV_WriteEntityDelta (ent, e, &ent->baseline, NULL, msg);
+				continue;
+			}
 		}
-
-		if ( ent->v.angles[0] != ent->baseline.angles[0] )
-			bits |= U_ANGLE1;
-
-		if ( ent->v.angles[1] != ent->baseline.angles[1] )
-			bits |= U_ANGLE2;
-
-		if ( ent->v.angles[2] != ent->baseline.angles[2] )
-			bits |= U_ANGLE3;
-
-		if (ent->v.movetype == MOVETYPE_STEP)
-			bits |= U_STEP;	// don't mess up the step animation
-
-		if (ent->baseline.colormap != ent->v.colormap)
-			bits |= U_COLORMAP;
-
-		if (ent->baseline.skin != ent->v.skin)
-			bits |= U_SKIN;
-
-		if (ent->baseline.frame != ent->v.frame)
-			bits |= U_FRAME;
-
-		if ((ent->baseline.effects ^ (int)ent->v.effects) & qcvm->effects_mask)
-			bits |= U_EFFECTS;
-
-		if (ent->baseline.modelindex != ent->v.modelindex)
-			bits |= U_MODEL;
-
-		//johnfitz -- alpha
-		// TODO: find a cleaner place to put this code
-		val = GetEdictFieldValueByName(ent, "alpha");
-		if (val)
-			ent->alpha = ENTALPHA_ENCODE(val->_float);
-
-		//don't send invisible entities unless they have effects
-		if (ent->alpha == ENTALPHA_ZERO && !((int)ent->v.effects & qcvm->effects_mask))
-			continue;
-		//johnfitz
-
-		val = GetEdictFieldValueByName(ent, "scale");
-		if (val)
-			ent->scale = ENTSCALE_ENCODE(val->_float);
 		else
-			ent->scale = ENTSCALE_DEFAULT;
-
-		//johnfitz -- PROTOCOL_FITZQUAKE
-		if (sv.protocol != PROTOCOL_NETQUAKE)
 		{
-
-			if (ent->baseline.alpha != ent->alpha) bits |= U_ALPHA;
-			if (ent->baseline.scale != ent->scale) bits |= U_SCALE;
-			if (bits & U_FRAME && (int)ent->v.frame & 0xFF00) bits |= U_FRAME2;
-			if (bits & U_MODEL && (int)ent->v.modelindex & 0xFF00) bits |= U_MODEL2;
-			if (ent->sendinterval) bits |= U_LERPFINISH;
-			if (bits >= 65536) bits |= U_EXTEND1;
-			if (bits >= 16777216) bits |= U_EXTEND2;
+			// encode each entity once per frame and share the bytes between all clients
+			if (net_encoded[e].frame != net_encodeframe)
+			{
+				if (net_encodelocked)
+					continue;	// SV_EncodeEntityUpdates only skips entities that are never sent
+				net_encoded[e].frame = net_encodeframe;
+				net_encoded[e].offset = net_encodebuf.cursize;
+				if (SV_WriteEntityUpdate (ent, e, &net_encodebuf))
+					net_encoded[e].length = net_encodebuf.cursize - net_encoded[e].offset;
+				else
+					net_encoded[e].length = 0;
+			}
+			if (!net_encoded[e].length)
+				continue;
+			if (!frame)
+			{
+				SZ_Write (msg, net_encodebuf.data + net_encoded[e].offset, net_encoded[e].length);
+				continue;
+			}
 		}
-		//johnfitz
-
-		if (e >= 256)
-			bits |= U_LONGENTITY;
-
-		if (bits >= 256)
-			bits |= U_MOREBITS;
-
-	//
-	// write the message
-	//
-		MSG_WriteByte (msg, bits | U_SIGNAL);
 
-		if (bits & U_MOREBITS)
-			MSG_WriteByte (msg, bits>>8);
+		// delta against what the client had in the reference frame
+		from = ref ? Delta_FindEntity (ref, e) : NULL;
+		if (priority && from && msg->cursize >= ratelimit && ent != clent && from->modelindex == (int)ent->v.modelindex)
+		{
+			SV_WriteEntityHold (ent, e, from, Delta_AddEntity (frame, e), msg);
+			continue;
+		}
+		SV_WriteEntityDelta (ent, e, from ? from : &ent->baseline, Delta_AddEntity (frame, e), msg);
+		if (priority)
+			priority[e] = 0.f;
+	}
 
-		//johnfitz -- PROTOCOL_FITZQUAKE
-		if (bits & U_EXTEND1)
-			MSG_WriteByte(msg, bits>>16);
-		if (bits & U_EXTEND2)
-			MSG_WriteByte(msg, bits>>24);
-		//johnfitz
+	if (frame)
+		Delta_EndFrame (frame);
 
-		if (bits & U_LONGENTITY)
-			MSG_WriteShort (msg,e);
-		else
-			MSG_WriteByte (msg,e);
-
-		if (bits & U_MODEL)
-			MSG_WriteByte (msg,	ent->v.modelindex);
-		if (bits & U_FRAME)
-			MSG_WriteByte (msg, ent->v.frame);
-		if (bits & U_COLORMAP)
-			MSG_WriteByte (msg, ent->v.colormap);
-		if (bits & U_SKIN)
-			MSG_WriteByte (msg, ent->v.skin);
-		if (bits & U_EFFECTS)
-			MSG_WriteByte (msg, (int)ent->v.effects & qcvm->effects_mask);
-		if (bits & U_ORIGIN1)
-			MSG_WriteCoord (msg, ent->v.origin[0], sv.protocolflags);
-		if (bits & U_ANGLE1)
-			MSG_WriteAngle(msg, ent->v.angles[0], sv.protocolflags);
-		if (bits & U_ORIGIN2)
-			MSG_WriteCoord (msg, ent->v.origin[1], sv.protocolflags);
-		if (bits & U_ANGLE2)
-			MSG_WriteAngle(msg, ent->v.angles[1], sv.protocolflags);
-		if (bits & U_ORIGIN3)
-			MSG_WriteCoord (msg, ent->v.origin[2], sv.protocolflags);
-		if (bits & U_ANGLE3)
-			MSG_WriteAngle(msg, ent->v.angles[2], sv.protocolflags);
+	return complete;
+}
 
-		//johnfitz -- PROTOCOL_FITZQUAKE
-		if (bits & U_ALPHA)
-			MSG_WriteByte(msg, ent->alpha);
-		if (bits & U_SCALE)
-			MSG_WriteByte(msg, ent->scale);
-		if (bits & U_FRAME2)
-			MSG_WriteByte(msg, (int)ent->v.frame >> 8);
-		if (bits & U_MODEL2)
-			MSG_WriteByte(msg, (int)ent->v.modelindex >> 8);
-		if (bits & U_LERPFINISH)
-			MSG_WriteByte(msg, (byte)(Q_rint((ent->v.nextthink-qcvm->time)*255)));
-		//johnfitz
+/*
+=============
+SV_EntityPacketStats
+=============
+*/
+static void SV_EntityPacketStats (sizebuf_t *msg, qboolean complete)
+{
+	//johnfitz -- less spammy overflow message
+	if (!complete && (!dev_overflows.packetsize || dev_overflows.packetsize + CONSOLE_RESPAM_TIME < realtime))
+	{
+		Con_Printf ("Packet overflow!\n");
+		dev_overflows.packetsize = realtime;
 	}
+	//johnfitz
 
 	//johnfitz -- devstats
-stats:
 	if (msg->cursize > 1024 && dev_peakstats.packetsize <= 1024)
 		Con_DWarning ("%i byte packet exceeds standard limit of 1024 (max = %d).\n", msg->cursize, msg->maxsize);
 	dev_stats.packetsize = msg->cursize;
@@ -966,6 +1875,37 @@ stats:
 	//johnfitz
 }
 
+/*
+=============
+SV_ClientPVS
+=============
+*/
+static byte *SV_ClientPVS (edict_t *clent)
+{
+	vec3_t	org;
+	int		e;
+
+	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
+	e = NUM_FOR_EDICT (clent);
+	if (e >= 1 && e <= MAX_SCOREBOARD)
+		return SV_CachedFatPVS (org, sv.worldmodel, &sv_clientfatpvs[e - 1]);
+	return SV_FatPVS (org, sv.worldmodel);
+}
+
+/*
+=============
+SV_WriteEntitiesToClient
+
+=============
+*/
+void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
+{
+	qboolean	complete;
+
+	complete = SV_WriteVisibleEntities (clent, SV_ClientPVS (clent), msg, &net_mainscratch);
+	SV_EntityPacketStats (msg, complete);
+}
+
 /*
 =============
 SV_CleanupEnts
@@ -1178,41 +2118,289 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 
 /*
 =======================
-SV_SendClientDatagram
+SV_WritePlayerState
+
+Tells a predicting client where its last move left the player
 =======================
 */
-qboolean SV_SendClientDatagram (client_t *client)
+static void SV_WritePlayerState (client_t *client, sizebuf_t *msg)
 {
-	byte		buf[MAX_DATAGRAM];
-	sizebuf_t	msg;
+	edict_t	*ent = client->edict;
+	int		i, flags;
+
+	flags = 0;
+	if ((int)ent->v.flags & FL_ONGROUND)
+		flags |= PS_ONGROUND;
+	if ((int)ent->v.flags & FL_JUMPRELEASED)
+		flags |= PS_JUMPRELEASED;
+	if ((int)ent->v.flags & FL_WATERJUMP)
+		flags |= PS_WATERJUMP;
+
+	MSG_WriteByte (msg, svc_playerstate);
+	MSG_WriteLong (msg, client->moveseq);
+	MSG_WriteByte (msg, flags);
+	MSG_WriteByte (msg, (int)ent->v.movetype);
+	for (i = 0; i < 3; i++)
+		MSG_WriteFloat (msg, ent->v.origin[i]);
+	for (i = 0; i < 3; i++)
+		MSG_WriteFloat (msg, ent->v.velocity[i]);
+}
 
-	msg.data = buf;
-	msg.maxsize = sizeof(buf);
-	msg.cursize = 0;
+/*
+=======================
+SV_WriteMovevars
+
+Sends a predicting client the physics settings whenever they change.  They
+go on the reliable stream, a lost datagram would leave the client predicting
+with stale ones, or not at all.
+=======================
+*/
+static void SV_WriteMovevars (client_t *client)
+{
+	float	movevars[NUM_MOVEVARS];
+	int		i;
+
+	SV_GetMovevars (client->edict, movevars);
+
+	if (client->movevarsvalid && !memcmp (movevars, client->movevars, sizeof (movevars)))
+		return;
+
+	MSG_WriteByte (&client->message, svc_movevars);
+	for (i = 0; i < NUM_MOVEVARS; i++)
+		MSG_WriteFloat (&client->message, movevars[i]);
+	memcpy (client->movevars, movevars, sizeof (movevars));
+	client->movevarsvalid = true;
+}
+
+/*
+=======================
+SV_UpdateRateBudget
+
+Refills the byte budget of a remote client for the time since the last
+frame, returns true if it is still in debt and gets no datagram this frame.
+Entity updates held back for the budget still cost a few bytes each, and
+reliable messages are always sent, so skipping whole datagrams is what
+keeps the client at its rate.
+=======================
+*/
+#define RATE_MIN	1000		// bytes per second
+#define RATE_BURST	0.25		// seconds worth of budget that can pile up
+
+static qboolean SV_UpdateRateBudget (client_t *client)
+{
+	int		rate;
+
+	rate = client->rate;
+	if (sv_maxrate.value > 0 && (!rate || rate > sv_maxrate.value))
+		rate = (int) sv_maxrate.value;
+	if (rate <= 0 || SV_IsLocalClient (client))
+	{
+		client->ratetime = 0;
+		return false;
+	}
+	rate = q_max (rate, RATE_MIN);
+
+	if (client->ratetime)
+		client->ratebudget += rate * (realtime - client->ratetime);
+	else
+		client->ratebudget = rate * RATE_BURST;
+	client->ratebudget = CLAMP (-rate, client->ratebudget, rate * RATE_BURST);
+	client->ratetime = realtime;
+
+	return client->ratebudget < 0;
+}
+
+/*
+=======================
+SV_BeginClientDatagram
+
+Sets up msg and writes everything but the entities
+=======================
+*/
+static void SV_BeginClientDatagram (client_t *client, sizebuf_t *msg, byte *buf)
+{
+	msg->data = buf;
+	msg->maxsize = MAX_DATAGRAM;
+	msg->cursize = 0;
+	msg->allowoverflow = false;
+	msg->overflowed = false;
 
 	//johnfitz -- if client is nonlocal, use smaller max size so packets aren't fragmented
 	if (Q_strcmp(NET_QSocketGetAddressString(client->netconnection), "LOCAL") != 0)
-		msg.maxsize = DATAGRAM_MTU;
+		msg->maxsize = DATAGRAM_MTU;
 	//johnfitz
 
-	MSG_WriteByte (&msg, svc_time);
-	MSG_WriteFloat (&msg, qcvm->time);
+	MSG_WriteByte (msg, svc_time);
+	MSG_WriteFloat (msg, qcvm->time);
 
 // add the client specific data to the datagram
-	SV_WriteClientdataToMessage (client->edict, &msg);
+	SV_WriteClientdataToMessage (client->edict, msg);
 
-	SV_WriteEntitiesToClient (client->edict, &msg);
+	if (client->moveseqs)
+		SV_WritePlayerState (client, msg);
+
+// how far entity updates may grow msg
+	if (client->ratetime)
+		client->ratelimit = q_max (msg->cursize, (int) client->ratebudget);
+	else
+		client->ratelimit = 0;
+}
 
+/*
+=======================
+SV_FinishClientDatagram
+=======================
+*/
+static qboolean SV_FinishClientDatagram (client_t *client, sizebuf_t *msg)
+{
 // copy the server datagram if there is space
-	if (msg.cursize + sv.datagram.cursize < msg.maxsize)
-		SZ_Write (&msg, sv.datagram.data, sv.datagram.cursize);
+	if (msg->cursize + sv.datagram.cursize < msg->maxsize)
+		SZ_Write (msg, sv.datagram.data, sv.datagram.cursize);
+	SV_WriteMulticasts (client, msg);
 
 // send the datagram
-	if (NET_SendUnreliableMessage (client->netconnection, &msg) == -1)
+	if (NET_SendUnreliableMessage (client->netconnection, msg) == -1)
 	{
 		SV_DropClient (true);// if the message couldn't send, kick off
 		return false;
 	}
+	if (client->ratetime)
+		client->ratebudget -= msg->cursize;
+
+	return true;
+}
+
+/*
+=======================
+SV_SendClientDatagram
+=======================
+*/
+qboolean SV_SendClientDatagram (client_t *client)
+{
+	byte		buf[MAX_DATAGRAM];
+	sizebuf_t	msg;
+
+	SV_BeginClientDatagram (client, &msg, buf);
+
+	SV_ProfileEnter (SVPROF_ENCODE);
+	SV_WriteEntitiesToClient (client->edict, &msg);
+	SV_ProfileLeave ();
+
+	return SV_FinishClientDatagram (client, &msg);
+}
+
+/*
+=======================
+SV_EncodeEntityUpdates
+
+Fills net_encoded with every entity SV_WriteVisibleEntities could send
+this frame, so worker threads only have to read it
+=======================
+*/
+static void SV_EncodeEntityUpdates (void)
+{
+	int			e;
+	edict_t		*ent;
+
+	for (e = 1, ent = NEXT_EDICT (qcvm->edicts); e < qcvm->num_edicts; e++, ent = NEXT_EDICT (ent))
+	{
+		if (e > svs.maxclients && (!ent->v.modelindex || !PR_GetString (ent->v.model)[0]))
+			continue;
+		net_encoded[e].frame = net_encodeframe;
+		net_encoded[e].offset = net_encodebuf.cursize;
+		if (SV_WriteEntityUpdate (ent, e, &net_encodebuf))
+			net_encoded[e].length = net_encodebuf.cursize - net_encoded[e].offset;
+		else
+			net_encoded[e].length = 0;
+	}
+}
+
+typedef struct
+{
+	qboolean	built;		// waiting to be sent
+	qboolean	choked;		// over its rate, skipped this frame
+	qboolean	complete;	// all visible entities fit
+	byte		*pvs;
+	sizebuf_t	msg;
+	byte		buf[MAX_DATAGRAM];
+} clientdatagram_t;
+
+static clientdatagram_t	net_datagrams[MAX_SCOREBOARD];	// indexed like svs.clients
+static int				net_buildlist[MAX_SCOREBOARD];
+static int				net_numbuild;
+
+/*
+=======================
+SV_BuildDatagramTask
+=======================
+*/
+static void SV_BuildDatagramTask (int index, int worker, void *param)
+{
+	int					num = net_buildlist[index];
+	clientdatagram_t	*dg = &net_datagrams[num];
+	qcvm_t				*oldvm;
+
+	PR_PushQCVM ((qcvm_t *) param, &oldvm);
+	dg->complete = SV_WriteVisibleEntities (svs.clients[num].edict, dg->pvs, &dg->msg, net_scratch[worker]);
+	PR_PopQCVM (oldvm);
+}
+
+/*
+=======================
+SV_BuildClientDatagrams
+
+Builds the datagrams of all spawned clients, with the entity part of each
+one written on a worker thread.  Returns false if it isn't worth it, the
+datagrams are then built by SV_SendClientDatagram as they are sent.
+=======================
+*/
+static qboolean SV_BuildClientDatagrams (void)
+{
+	int			i, numworkers;
+	client_t	*client;
+
+	numworkers = Tasks_NumWorkers ();
+	if (!sv_threads.value || !sv_sharedencode.value || numworkers < 2)
+		return false;
+
+	net_numbuild = 0;
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+		if (client->active && client->spawned && !net_datagrams[i].choked)
+			net_buildlist[net_numbuild++] = i;
+	if (net_numbuild < 2)
+		return false;
+
+	for (i = 1; i < numworkers; i++)
+	{
+		if (net_scratch[i])
+			continue;
+		net_scratch[i] = (netscratch_t *) calloc (1, sizeof (netscratch_t));
+		if (!net_scratch[i])
+			Sys_Error ("SV_BuildClientDatagrams: out of memory");
+	}
+
+// everything that touches shared state runs here, on the main thread
+	for (i = 0; i < net_numbuild; i++)
+	{
+		clientdatagram_t *dg = &net_datagrams[net_buildlist[i]];
+		client = &svs.clients[net_buildlist[i]];
+		SV_BeginClientDatagram (client, &dg->msg, dg->buf);
+		dg->pvs = SV_ClientPVS (client->edict);
+	}
+
+	SV_ProfileEnter (SVPROF_ENCODE);
+	SV_EncodeEntityUpdates ();
+	net_encodelocked = true;
+	Tasks_ParallelFor (net_numbuild, SV_BuildDatagramTask, qcvm);
+	net_encodelocked = false;
+	SV_ProfileLeave ();
+
+	for (i = 0; i < net_numbuild; i++)
+	{
+		clientdatagram_t *dg = &net_datagrams[net_buildlist[i]];
+		SV_EntityPacketStats (&dg->msg, dg->complete);
+		dg->built = true;
+	}
 
 	return true;
 }
@@ -1334,6 +2522,8 @@ void SV_UpdateToReliableMessages (void)
 			continue;
 		SV_WriteStats (client);
 		SV_WriteUnderwaterOverride (client);
+		if (client->moveseqs)
+			SV_WriteMovevars (client);
 		SZ_Write (&client->message, sv.reliable_datagram.data, sv.reliable_datagram.cursize);
 	}
 
@@ -1365,6 +2555,43 @@ void SV_SendNop (client_t *client)
 	client->last_message = realtime;
 }
 
+/*
+=======================
+SV_DeflateMessage
+
+Returns the reliable message to send to client, as a single svc_deflate if
+the client accepts them and that makes it smaller
+=======================
+*/
+#define DEFLATE_MINSIZE		512
+
+static sizebuf_t *SV_DeflateMessage (client_t *client)
+{
+	static byte			buf[MAX_MSGLEN];
+	static sizebuf_t	msg;
+	int					size;
+
+	if (!client->deflate || client->message.cursize < DEFLATE_MINSIZE)
+		return &client->message;
+
+	msg.data = buf;
+	msg.maxsize = sizeof (buf);
+	SZ_Clear (&msg);
+	MSG_WriteByte (&msg, svc_deflate);
+	MSG_WriteLong (&msg, client->message.cursize);
+
+	// anything that doesn't end up smaller goes out as is
+	size = COM_Deflate (client->message.data, client->message.cursize, msg.data + msg.cursize, client->message.cursize - msg.cursize - 1);
+	if (!size)
+		return &client->message;
+	msg.cursize += size;
+
+	client->deflatein += client->message.cursize;
+	client->deflateout += msg.cursize;
+
+	return &msg;
+}
+
 /*
 =======================
 SV_SendClientMessages
@@ -1377,7 +2604,22 @@ void SV_SendClientMessages (void)
 // update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
+// temp entities QC broadcast only go where they can be seen
+	SV_SplitBroadcasts ();
+
+// invalidate the entity updates encoded for the previous frame
+	net_encodeframe++;
+	SZ_Clear (&net_encodebuf);
+
+// remote clients over their rate sit this frame out
+	for (i=0, host_client = svs.clients ; i<svs.maxclients ; i++, host_client++)
+		net_datagrams[i].choked = host_client->active && host_client->spawned && SV_UpdateRateBudget (host_client);
+
 // build individual updates
+	SV_BuildClientDatagrams ();
+
+	NET_BeginSendBatch ();
+
 	for (i=0, host_client = svs.clients ; i<svs.maxclients ; i++, host_client++)
 	{
 		if (!host_client->active)
@@ -1385,7 +2627,14 @@ void SV_SendClientMessages (void)
 
 		if (host_client->spawned)
 		{
-			if (!SV_SendClientDatagram (host_client))
+			// datagrams built in parallel are still sent one by one, in client order
+			if (net_datagrams[i].built)
+			{
+				net_datagrams[i].built = false;
+				if (!SV_FinishClientDatagram (host_client, &net_datagrams[i].msg))
+					continue;
+			}
+			else if (!net_datagrams[i].choked && !SV_SendClientDatagram (host_client))
 				continue;
 		}
 		else
@@ -1403,7 +2652,8 @@ void SV_SendClientMessages (void)
 			}
 			if (host_client->sendsignon == PRESPAWN_SIGNONBUFS)
 			{
-				qboolean local = SV_IsLocalClient (host_client);
+				// clients that inflate svc_deflate get as many buffers as fit, too
+				qboolean local = SV_IsLocalClient (host_client) || host_client->deflate;
 				while (host_client->signonidx < sv.num_signon_buffers)
 				{
 					sizebuf_t *signon = sv.signon_buffers[host_client->signonidx];
@@ -1453,17 +2703,25 @@ void SV_SendClientMessages (void)
 				SV_DropClient (false);	// went to another level
 			else
 			{
-				if (NET_SendMessage (host_client->netconnection
-				, &host_client->message) == -1)
+				sizebuf_t *reliable = SV_DeflateMessage (host_client);
+				if (NET_SendMessage (host_client->netconnection, reliable) == -1)
 					SV_DropClient (true);	// if the message couldn't send, kick off
+				else if (host_client->ratetime)
+					host_client->ratebudget -= reliable->cursize;
 				SZ_Clear (&host_client->message);
 				host_client->last_message = realtime;
 				if (host_client->sendsignon == PRESPAWN_FLUSH)
+				{
 					host_client->sendsignon = PRESPAWN_DONE;
+					if (host_client->deflatein)
+						Con_DPrintf ("%s: signon deflated from %i to %i bytes\n",
+							host_client->name, host_client->deflatein, host_client->deflateout);
+				}
 			}
 		}
 	}
 
+	NET_EndSendBatch ();
 
 // clear muzzle flashes
 	SV_CleanupEnts ();
@@ -1727,6 +2985,10 @@ void SV_SpawnServer (const char *server)
 
 	Con_DPrintf ("SpawnServer: %s\n",server);
 	svs.changelevel_issued = false;		// now safe to issue another
+	SV_BenchServerSpawning ();
+
+	for (i = 0; i < MAX_SCOREBOARD; i++)
+		SV_ClearFatPVS (&sv_clientfatpvs[i]);
 
 	PR_SwitchQCVM(NULL);
 
@@ -1766,6 +3028,12 @@ void SV_SpawnServer (const char *server)
 		// set up the protocol flags used by this server
 		// (note - these could be cvar-ised so that server admins could choose the protocol features used by their servers)
 		sv.protocolflags = PRFL_INT32COORD | PRFL_SHORTANGLE;
+		if (sv_deltaframes.value)
+			sv.protocolflags |= PRFL_DELTAFRAMES;
+		if (sv_moveseq.value)
+			sv.protocolflags |= PRFL_MOVESEQ;
+		if (sv_deflate.value)
+			sv.protocolflags |= PRFL_DEFLATE;
 	}
 	else sv.protocolflags = 0;
 
@@ -1778,11 +3046,16 @@ void SV_SpawnServer (const char *server)
 	qcvm->max_edicts = CLAMP (MIN_EDICTS,(int)max_edicts.value,MAX_EDICTS); //johnfitz -- max_edicts cvar
 	qcvm->edicts = (edict_t *) malloc (qcvm->max_edicts*qcvm->edict_size); // ericw -- sv.edicts switched to use malloc()
 	ClearLink (&qcvm->free_edicts);
+	SV_InitPhysicsLists ();
 
 	sv.datagram.maxsize = sizeof(sv.datagram_buf);
 	sv.datagram.cursize = 0;
 	sv.datagram.data = sv.datagram_buf;
 
+	sv.multicast.maxsize = sizeof(sv.multicast_buf);
+	sv.multicast.cursize = 0;
+	sv.multicast.data = sv.multicast_buf;
+
 	sv.reliable_datagram.maxsize = sizeof(sv.reliable_datagram_buf);
 	sv.reliable_datagram.cursize = 0;
 	sv.reliable_datagram.data = sv.reliable_datagram_buf;
@@ -1814,6 +3087,7 @@ void SV_SpawnServer (const char *server)
 		return;
 	}
 	sv.models[1] = sv.worldmodel;
+	SV_CalcPHS ();
 
 //
 // clear world interaction links
@@ -1878,6 +3152,8 @@ void SV_SpawnServer (const char *server)
 		if (host_client->active)
 			SV_SendServerinfo (host_client);
 
+	SV_BenchServerSpawned ();
+
 	Con_DPrintf ("Server spawned.\n");
 }
 
@@ -0,0 +1,568 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// sv_metrics.c -- periodic server metrics for monitoring agents
+//
+// Every sv_metrics seconds a snapshot of the server state is rendered in the
+// Prometheus text exposition format.  It is written to sv_metrics_file, which
+// is replaced atomically so that a textfile collector never sees a partial
+// file, and on unix it is also handed to every connection accepted on the
+// local socket named by sv_metrics_socket.  Building the snapshot only reads
+// counters the engine keeps anyway, and the socket is never waited on.
+
+#include "quakedef.h"
+#include "q_stdinc.h"
+#include "arch_def.h"
+#include "net_sys.h"
+
+#if defined(PLATFORM_UNIX)
+#include <sys/un.h>
+#include <fcntl.h>
+#define SV_METRICS_SOCKET
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL	0
+#endif
+
+static cvar_t	sv_metrics = {"sv_metrics", "0", CVAR_NONE};							// seconds between snapshots, 0 = off
+static cvar_t	sv_metrics_file = {"sv_metrics_file", "metrics.prom", CVAR_NONE};		// written to the game directory
+static cvar_t	sv_metrics_socket = {"sv_metrics_socket", "", CVAR_NONE};			// unix socket path serving the last snapshot
+
+#define MAX_METRICS_TICKS	4096
+
+static struct
+{
+	float		times[MAX_METRICS_TICKS];	// tick durations since the last snapshot
+	int			count;						// may exceed MAX_METRICS_TICKS, the ring keeps the latest
+	double		start;
+	double		sum;						// totals since startup
+	double		ticks;
+} svmetrics_ticks;
+
+static char		*svmetrics_text;			// last snapshot
+static int		svmetrics_len;
+static int		svmetrics_size;
+static double	svmetrics_last;
+
+#ifdef SV_METRICS_SOCKET
+static int		svmetrics_sock = -1;
+static char		svmetrics_sockname[MAX_OSPATH];
+#endif
+
+/*
+==================
+SV_MetricsPrintf
+
+Appends to the snapshot being built
+==================
+*/
+static void SV_MetricsPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
+static void SV_MetricsPrintf (const char *fmt, ...)
+{
+	va_list	argptr;
+	int		len;
+
+	while (1)
+	{
+		va_start (argptr, fmt);
+		len = q_vsnprintf (svmetrics_text + svmetrics_len, svmetrics_size - svmetrics_len, fmt, argptr);
+		va_end (argptr);
+		if (len < 0)
+			return;
+		if (svmetrics_len + len < svmetrics_size)
+			break;
+		svmetrics_size = q_max (svmetrics_size * 2, svmetrics_len + len + 1);
+		svmetrics_text = (char *) realloc (svmetrics_text, svmetrics_size);
+		if (!svmetrics_text)
+			Sys_Error ("SV_MetricsPrintf: out of memory");
+	}
+	svmetrics_len += len;
+}
+
+static void SV_MetricsHeader (const char *name, const char *type, const char *help)
+{
+	SV_MetricsPrintf ("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/*
+==================
+SV_MetricsLabel
+
+Quake names may contain any byte, label values have to be printable
+==================
+*/
+static const char *SV_MetricsLabel (const char *in)
+{
+	static char	buf[64];
+	int			i, c;
+
+	for (i = 0; *in && i < (int) sizeof (buf) - 2; in++)
+	{
+		c = *in & 127;
+		if (c == '\\' || c == '"')
+			buf[i++] = '\\';
+		else if (c < 32 || c == 127)
+			c = '_';
+		buf[i++] = c;
+	}
+	buf[i] = '\0';
+
+	return buf;
+}
+
+/*
+==================
+SV_ResidentBytes
+
+Resident set size of the process, or -1 where it isn't known
+==================
+*/
+static double SV_ResidentBytes (void)
+{
+#if defined(__linux__)
+	FILE	*f;
+	long	size, resident;
+
+	f = fopen ("/proc/self/statm", "r");
+	if (!f)
+		return -1.0;
+	if (fscanf (f, "%ld %ld", &size, &resident) != 2)
+		resident = -1;
+	fclose (f);
+
+	return resident < 0 ? -1.0 : (double) resident * sysconf (_SC_PAGESIZE);
+#else
+	return -1.0;
+#endif
+}
+
+static int SV_CompareTickTimes (const void *a, const void *b)
+{
+	float fa = *(const float *)a;
+	float fb = *(const float *)b;
+	return (fa > fb) - (fa < fb);
+}
+
+/*
+==================
+SV_MetricsClients
+
+Writes one family of per-client samples
+==================
+*/
+typedef enum
+{
+	CM_RTT,
+	CM_CONNECTED,
+	CM_BYTES_SENT,
+	CM_BYTES_RECEIVED,
+	CM_PACKETS_SENT,
+	CM_PACKETS_RESENT,
+	CM_PACKETS_RECEIVED,
+	CM_PACKETS_DROPPED,
+	CM_RETRANSMIT_TIMEOUTS,
+} clientmetric_t;
+
+static void SV_MetricsClients (clientmetric_t metric, const char *name, const char *type, const char *help)
+{
+	client_t			*client;
+	const netstats_t	*stats;
+	double				value;
+	int					i, j;
+
+	SV_MetricsHeader (name, type, help);
+
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		if (!client->active || !client->netconnection)
+			continue;
+
+		stats = NET_QSocketGetStats (client->netconnection);
+		switch (metric)
+		{
+		case CM_RTT:
+			for (j = 0, value = 0.0; j < NUM_PING_TIMES; j++)
+				value += client->ping_times[j];
+			value /= NUM_PING_TIMES;
+			break;
+		case CM_CONNECTED:
+			value = net_time - NET_QSocketGetTime (client->netconnection);
+			break;
+		case CM_BYTES_SENT:
+			value = stats->bytesSent;
+			break;
+		case CM_BYTES_RECEIVED:
+			value = stats->bytesReceived;
+			break;
+		case CM_PACKETS_SENT:
+			value = stats->packetsSent;
+			break;
+		case CM_PACKETS_RESENT:
+			value = stats->packetsReSent;
+			break;
+		case CM_PACKETS_RECEIVED:
+			value = stats->packetsReceived;
+			break;
+		case CM_PACKETS_DROPPED:
+			value = stats->droppedDatagrams;
+			break;
+		case CM_RETRANSMIT_TIMEOUTS:
+			value = stats->retransmitTimeouts;
+			break;
+		default:
+			value = 0.0;
+			break;
+		}
+
+		SV_MetricsPrintf ("%s{slot=\"%d\",name=\"%s\",", name, i, SV_MetricsLabel (client->name));
+		SV_MetricsPrintf ("address=\"%s\"} %.17g\n", SV_MetricsLabel (NET_QSocketGetAddressString (client->netconnection)), value);
+	}
+}
+
+/*
+==================
+SV_MetricsBuild
+==================
+*/
+static void SV_MetricsBuild (void)
+{
+	static float	sorted[MAX_METRICS_TICKS];
+	static const double quantiles[] = {0.5, 0.9, 0.99, 1.0};
+	netstats_t		totals;
+	edict_t			*ent;
+	int				i, n, edicts, clients, used, size;
+
+	svmetrics_len = 0;
+	if (!svmetrics_text)
+	{
+		svmetrics_size = 16384;
+		svmetrics_text = (char *) malloc (svmetrics_size);
+		if (!svmetrics_text)
+			Sys_Error ("SV_MetricsBuild: out of memory");
+	}
+
+	n = q_min (svmetrics_ticks.count, MAX_METRICS_TICKS);
+	memcpy (sorted, svmetrics_ticks.times, n * sizeof (sorted[0]));
+	qsort (sorted, n, sizeof (sorted[0]), SV_CompareTickTimes);
+	SV_MetricsHeader ("quake_tick_seconds", "summary", "Server tick duration, quantiles over the ticks since the previous snapshot.");
+	for (i = 0; i < (int) countof (quantiles); i++)
+		SV_MetricsPrintf ("quake_tick_seconds{quantile=\"%g\"} %.9g\n", quantiles[i],
+			n ? sorted[q_min ((int)(n * quantiles[i]), n - 1)] : 0.0);
+	SV_MetricsPrintf ("quake_tick_seconds_sum %.9g\n", svmetrics_ticks.sum);
+	SV_MetricsPrintf ("quake_tick_seconds_count %.0f\n", svmetrics_ticks.ticks);
+
+	for (i = 0, edicts = 0, ent = qcvm->edicts; i < qcvm->num_edicts; i++, ent = NEXT_EDICT (ent))
+		if (!ent->free)
+			edicts++;
+	SV_MetricsHeader ("quake_edicts", "gauge", "Edicts in use.");
+	SV_MetricsPrintf ("quake_edicts %d\n", edicts);
+	SV_MetricsHeader ("quake_edicts_max", "gauge", "Edict limit of the current map.");
+	SV_MetricsPrintf ("quake_edicts_max %d\n", qcvm->max_edicts);
+
+	for (i = 0, clients = 0; i < svs.maxclients; i++)
+		if (svs.clients[i].active)
+			clients++;
+	SV_MetricsHeader ("quake_clients", "gauge", "Connected clients.");
+	SV_MetricsPrintf ("quake_clients %d\n", clients);
+	SV_MetricsHeader ("quake_clients_max", "gauge", "Client slots.");
+	SV_MetricsPrintf ("quake_clients_max %d\n", svs.maxclients);
+	SV_MetricsHeader ("quake_hibernating", "gauge", "1 while an empty server is hibernating.");
+	SV_MetricsPrintf ("quake_hibernating %d\n", svs.hibernating ? 1 : 0);
+
+	SV_MetricsHeader ("quake_resident_bytes", "gauge", "Resident memory of the process, -1 if unknown.");
+	SV_MetricsPrintf ("quake_resident_bytes %.0f\n", SV_ResidentBytes ());
+
+	SV_MetricsHeader ("quake_qc_runaways_total", "counter", "QuakeC runaway loop errors.");
+	SV_MetricsPrintf ("quake_qc_runaways_total %d\n", pr_runaways);
+
+	Hunk_GetUsage (&used, &size);
+	SV_MetricsHeader ("quake_hunk_used_bytes", "gauge", "Hunk memory in use.");
+	SV_MetricsPrintf ("quake_hunk_used_bytes %d\n", used);
+	SV_MetricsHeader ("quake_hunk_size_bytes", "gauge", "Hunk size.");
+	SV_MetricsPrintf ("quake_hunk_size_bytes %d\n", size);
+	Z_GetUsage (&used, &size);
+	SV_MetricsHeader ("quake_zone_used_bytes", "gauge", "Zone memory in use.");
+	SV_MetricsPrintf ("quake_zone_used_bytes %d\n", used);
+	SV_MetricsHeader ("quake_zone_size_bytes", "gauge", "Zone size.");
+	SV_MetricsPrintf ("quake_zone_size_bytes %d\n", size);
+
+	NET_GetTotals (&totals);
+	SV_MetricsHeader ("quake_net_bytes_sent_total", "counter", "Datagram bytes sent, including headers.");
+	SV_MetricsPrintf ("quake_net_bytes_sent_total %.0f\n", (double) totals.bytesSent);
+	SV_MetricsHeader ("quake_net_bytes_received_total", "counter", "Datagram bytes received, including headers.");
+	SV_MetricsPrintf ("quake_net_bytes_received_total %.0f\n", (double) totals.bytesReceived);
+	SV_MetricsHeader ("quake_net_packets_sent_total", "counter", "Reliable packets sent.");
+	SV_MetricsPrintf ("quake_net_packets_sent_total %d\n", totals.packetsSent);
+	SV_MetricsHeader ("quake_net_packets_resent_total", "counter", "Reliable packets retransmitted.");
+	SV_MetricsPrintf ("quake_net_packets_resent_total %d\n", totals.packetsReSent);
+	SV_MetricsHeader ("quake_net_packets_received_total", "counter", "Packets received.");
+	SV_MetricsPrintf ("quake_net_packets_received_total %d\n", totals.packetsReceived);
+	SV_MetricsHeader ("quake_net_datagrams_dropped_total", "counter", "Unreliable datagrams lost on the way in.");
+	SV_MetricsPrintf ("quake_net_datagrams_dropped_total %d\n", totals.droppedDatagrams);
+	SV_MetricsHeader ("quake_net_fast_retransmits_total", "counter", "Reliable fragments resent after a gap in the acks.");
+	SV_MetricsPrintf ("quake_net_fast_retransmits_total %d\n", totals.fastRetransmits);
+	SV_MetricsHeader ("quake_net_retransmit_timeouts_total", "counter", "Reliable retransmissions after a timeout.");
+	SV_MetricsPrintf ("quake_net_retransmit_timeouts_total %d\n", totals.retransmitTimeouts);
+
+	SV_MetricsClients (CM_RTT, "quake_client_rtt_seconds", "gauge", "Average ping of the client.");
+	SV_MetricsClients (CM_CONNECTED, "quake_client_connected_seconds", "gauge", "Time since the client connected.");
+	SV_MetricsClients (CM_BYTES_SENT, "quake_client_bytes_sent_total", "counter", "Bytes sent to the client.");
+	SV_MetricsClients (CM_BYTES_RECEIVED, "quake_client_bytes_received_total", "counter", "Bytes received from the client.");
+	SV_MetricsClients (CM_PACKETS_SENT, "quake_client_packets_sent_total", "counter", "Reliable packets sent to the client.");
+	SV_MetricsClients (CM_PACKETS_RESENT, "quake_client_packets_resent_total", "counter", "Reliable packets retransmitted to the client.");
+	SV_MetricsClients (CM_PACKETS_RECEIVED, "quake_client_packets_received_total", "counter", "Packets received from the client.");
+	SV_MetricsClients (CM_PACKETS_DROPPED, "quake_client_datagrams_dropped_total", "counter", "Unreliable datagrams from the client that were lost.");
+	SV_MetricsClients (CM_RETRANSMIT_TIMEOUTS, "quake_client_retransmit_timeouts_total", "counter", "Reliable retransmissions to the client after a timeout.");
+}
+
+/*
+==================
+SV_MetricsWriteFile
+
+Writes to a temporary file first, readers only ever see complete snapshots
+==================
+*/
+static void SV_MetricsWriteFile (void)
+{
+	char	path[MAX_OSPATH], tmppath[MAX_OSPATH];
+	FILE	*f;
+
+	if (!sv_metrics_file.string[0])
+		return;
+
+	if (strstr (sv_metrics_file.string, ".."))
+	{
+		Con_Printf ("sv_metrics_file: relative pathnames are not allowed\n");
+		Cvar_SetQuick (&sv_metrics_file, "");
+		return;
+	}
+
+	q_snprintf (path, sizeof (path), "%s/%s", com_gamedir, sv_metrics_file.string);
+	q_snprintf (tmppath, sizeof (tmppath), "%s.tmp", path);
+	f = Sys_fopen (tmppath, "wb");
+	if (!f)
+	{
+		Con_Printf ("sv_metrics_file: couldn't open %s\n", tmppath);
+		Cvar_SetQuick (&sv_metrics_file, "");
+		return;
+	}
+	fwrite (svmetrics_text, 1, svmetrics_len, f);
+	fclose (f);
+
+	Sys_remove (path);	// rename doesn't replace existing files on windows
+	if (Sys_rename (tmppath, path) != 0)
+		Con_Printf ("sv_metrics_file: couldn't rename %s\n", tmppath);
+}
+
+#ifdef SV_METRICS_SOCKET
+static void SV_MetricsCloseSocket (void)
+{
+	if (svmetrics_sock == -1)
+		return;
+	close (svmetrics_sock);
+	unlink (svmetrics_sockname);
+	svmetrics_sock = -1;
+	svmetrics_sockname[0] = '\0';
+}
+
+/*
+==================
+SV_MetricsOpenSocket
+
+(Re)creates the listening socket if sv_metrics_socket changed
+==================
+*/
+static void SV_MetricsOpenSocket (void)
+{
+	struct sockaddr_un	addr;
+
+	if (!strcmp (svmetrics_sockname, sv_metrics_socket.string))
+		return;
+
+	SV_MetricsCloseSocket ();
+	if (!sv_metrics_socket.string[0])
+		return;
+
+	if (strlen (sv_metrics_socket.string) >= sizeof (addr.sun_path))
+	{
+		Con_Printf ("sv_metrics_socket: path too long\n");
+		Cvar_SetQuick (&sv_metrics_socket, "");
+		return;
+	}
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	q_strlcpy (addr.sun_path, sv_metrics_socket.string, sizeof (addr.sun_path));
+	unlink (addr.sun_path);		// left behind by a previous run
+
+	svmetrics_sock = socket (AF_UNIX, SOCK_STREAM, 0);
+	if (svmetrics_sock == -1 ||
+		fcntl (svmetrics_sock, F_SETFL, O_NONBLOCK) == -1 ||
+		bind (svmetrics_sock, (struct sockaddr *) &addr, sizeof (addr)) == -1 ||
+		listen (svmetrics_sock, 8) == -1)
+	{
+		Con_Printf ("sv_metrics_socket: couldn't listen on %s: %s\n", addr.sun_path, strerror (errno));
+		if (svmetrics_sock != -1)
+			close (svmetrics_sock);
+		svmetrics_sock = -1;
+		Cvar_SetQuick (&sv_metrics_socket, "");
+		return;
+	}
+	q_strlcpy (svmetrics_sockname, sv_metrics_socket.string, sizeof (svmetrics_sockname));
+}
+
+/*
+==================
+SV_MetricsServeSocket
+
+Hands the last snapshot to pending connections.  The write never blocks, a
+reader that doesn't keep up with its socket buffer gets a truncated reply.
+==================
+*/
+static void SV_MetricsServeSocket (void)
+{
+	int		conn, flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+
+	SV_MetricsOpenSocket ();
+	if (svmetrics_sock == -1)
+		return;
+
+	while ((conn = accept (svmetrics_sock, NULL, NULL)) != -1)
+	{
+#ifdef SO_NOSIGPIPE
+		int	one = 1;
+		setsockopt (conn, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof (one));
+#endif
+		if (svmetrics_len && send (conn, svmetrics_text, svmetrics_len, flags) == -1)
+			Con_DPrintf ("sv_metrics_socket: %s\n", strerror (errno));
+		close (conn);
+	}
+}
+#endif	/* SV_METRICS_SOCKET */
+
+/*
+==================
+SV_MetricsBeginTick
+
+Called at the start of Host_ServerFrame
+==================
+*/
+void SV_MetricsBeginTick (void)
+{
+	svmetrics_ticks.start = sv_metrics.value > 0.f ? Sys_DoubleTime () : 0.0;
+}
+
+/*
+==================
+SV_MetricsEndTick
+
+Called at the end of Host_ServerFrame
+==================
+*/
+void SV_MetricsEndTick (void)
+{
+	double	time;
+
+	if (!svmetrics_ticks.start)
+		return;
+
+	time = Sys_DoubleTime () - svmetrics_ticks.start;
+	svmetrics_ticks.times[svmetrics_ticks.count++ % MAX_METRICS_TICKS] = time;
+	svmetrics_ticks.sum += time;
+	svmetrics_ticks.ticks++;
+}
+
+/*
+==================
+SV_MetricsFrame
+
+Called every host frame while the server is active
+==================
+*/
+void SV_MetricsFrame (void)
+{
+	if (sv_metrics.value <= 0.f)
+	{
+#ifdef SV_METRICS_SOCKET
+		SV_MetricsCloseSocket ();
+#endif
+		svmetrics_len = 0;
+		return;
+	}
+
+	if (realtime - svmetrics_last >= sv_metrics.value || realtime < svmetrics_last)
+	{
+		svmetrics_last = realtime;
+		SV_MetricsBuild ();
+		svmetrics_ticks.count = 0;
+		SV_MetricsWriteFile ();
+	}
+
+#ifdef SV_METRICS_SOCKET
+	SV_MetricsServeSocket ();
+#endif
+}
+
+/*
+==================
+SV_MetricsFlush
+
+Writes a snapshot right away.  Host_Error calls it before the server is shut
+down, so that the reason for a crash shows up in the last snapshot.
+==================
+*/
+void SV_MetricsFlush (void)
+{
+	qcvm_t	*oldvm;
+
+	if (sv_metrics.value <= 0.f || !sv.active)
+		return;
+
+	PR_PushQCVM (&sv.qcvm, &oldvm);
+	SV_MetricsBuild ();
+	PR_PopQCVM (oldvm);
+	SV_MetricsWriteFile ();
+}
+
+/*
+==================
+SV_MetricsShutdown
+==================
+*/
+void SV_MetricsShutdown (void)
+{
+	SV_MetricsFlush ();
+
+#ifdef SV_METRICS_SOCKET
+	SV_MetricsCloseSocket ();
+#endif
+}
+
+/*
+==================
+SV_Metrics_Init
+==================
+*/
+void SV_Metrics_Init (void)
+{
+	Cvar_RegisterVariable (&sv_metrics);
+	Cvar_RegisterVariable (&sv_metrics_file);
+	Cvar_RegisterVariable (&sv_metrics_socket);
+}
@@ -47,6 +47,7 @@ cvar_t	sv_gravity = {"sv_gravity","800",CVAR_NOTIFY|CVAR_SERVERINFO};
 cvar_t	sv_maxvelocity = {"sv_maxvelocity","2000",CVAR_NONE};
 cvar_t	sv_nostep = {"sv_nostep","0",CVAR_NONE};
 cvar_t	sv_freezenonclients = {"sv_freezenonclients","0",CVAR_NONE};
+cvar_t	sv_physicsbuckets = {"sv_physicsbuckets","0",CVAR_NONE}; // 0 = edict order, 1 = grouped by movetype
 
 
 #define	MOVE_EPSILON	0.01
@@ -140,7 +141,9 @@ qboolean SV_RunThink (edict_t *ent)
 	pr_global_struct->time = thinktime;
 	pr_global_struct->self = EDICT_TO_PROG(ent);
 	pr_global_struct->other = EDICT_TO_PROG(qcvm->edicts);
+	SV_ProfileEnter (SVPROF_THINK);
 	PR_ExecuteProgram (ent->v.think);
+	SV_ProfileLeave ();
 
 	return !ent->free;
 }
@@ -164,14 +167,18 @@ void SV_Impact (edict_t *e1, edict_t *e2)
 	{
 		pr_global_struct->self = EDICT_TO_PROG(e1);
 		pr_global_struct->other = EDICT_TO_PROG(e2);
+		SV_ProfileEnter (SVPROF_TOUCH);
 		PR_ExecuteProgram (e1->v.touch);
+		SV_ProfileLeave ();
 	}
 
 	if (e2->v.touch && e2->v.solid != SOLID_NOT)
 	{
 		pr_global_struct->self = EDICT_TO_PROG(e2);
 		pr_global_struct->other = EDICT_TO_PROG(e1);
+		SV_ProfileEnter (SVPROF_TOUCH);
 		PR_ExecuteProgram (e2->v.touch);
+		SV_ProfileLeave ();
 	}
 
 	pr_global_struct->self = old_self;
@@ -180,187 +187,130 @@ void SV_Impact (edict_t *e1, edict_t *e2)
 
 
 /*
-==================
-ClipVelocity
-
-Slide off of the impacting object
-returns the blocked flags (1 = floor, 2 = step / wall)
-==================
+================
+SV_PmoveMove
+================
 */
-#define	STOP_EPSILON	0.1
+static trace_t SV_PmoveMove (pmove_t *pm, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type)
+{
+	return SV_Move (start, mins, maxs, end, type, (edict_t *) pm->user);
+}
 
-int ClipVelocity (vec3_t in, vec3_t normal, vec3_t out, float overbounce)
+/*
+================
+SV_PmovePointContents
+================
+*/
+static int SV_PmovePointContents (pmove_t *pm, vec3_t p)
 {
-	float	backoff;
-	float	change;
-	int		i, blocked;
+	return SV_PointContents (p);
+}
+
+/*
+================
+SV_PmoveGround
 
-	blocked = 0;
-	if (normal[2] > 0)
-		blocked |= 1;		// floor
-	if (!normal[2])
-		blocked |= 2;		// step
+Only bsp models are something to stand on
+================
+*/
+static void SV_PmoveGround (pmove_t *pm, const trace_t *trace)
+{
+	edict_t	*ent = (edict_t *) pm->user;
 
-	backoff = DotProduct (in, normal) * overbounce;
+	if (!trace->ent)
+		Sys_Error ("SV_PmoveGround: !trace.ent");
 
-	for (i=0 ; i<3 ; i++)
+	if (trace->ent->v.solid == SOLID_BSP)
 	{
-		change = normal[i]*backoff;
-		out[i] = in[i] - change;
-		if (out[i] > -STOP_EPSILON && out[i] < STOP_EPSILON)
-			out[i] = 0;
+		ent->v.flags =	(int)ent->v.flags | FL_ONGROUND;
+		ent->v.groundentity = EDICT_TO_PROG(trace->ent);
 	}
-
-	return blocked;
 }
 
-
 /*
-============
-SV_FlyMove
-
-The basic solid body movement clip that slides along multiple planes
-Returns the clipflags if the velocity was modified (hit something solid)
-1 = floor
-2 = wall / step
-4 = dead stop
-If steptrace is not NULL, the trace of any vertical wall hit will be stored
-============
+================
+SV_PmoveTouch
+================
 */
-#define	MAX_CLIP_PLANES	5
-int SV_FlyMove (edict_t *ent, float time, trace_t *steptrace)
+static qboolean SV_PmoveTouch (pmove_t *pm, const trace_t *trace)
 {
-	int			bumpcount, numbumps;
-	vec3_t		dir;
-	float		d;
-	int			numplanes;
-	vec3_t		planes[MAX_CLIP_PLANES];
-	vec3_t		primal_velocity, original_velocity, new_velocity;
-	int			i, j;
-	trace_t		trace;
-	vec3_t		end;
-	float		time_left;
-	int			blocked;
-
-	numbumps = 4;
-
-	blocked = 0;
-	VectorCopy (ent->v.velocity, original_velocity);
-	VectorCopy (ent->v.velocity, primal_velocity);
-	numplanes = 0;
-
-	time_left = time;
-
-	for (bumpcount=0 ; bumpcount<numbumps ; bumpcount++)
-	{
-		if (!ent->v.velocity[0] && !ent->v.velocity[1] && !ent->v.velocity[2])
-			break;
+	edict_t	*ent = (edict_t *) pm->user;
 
-		for (i=0 ; i<3 ; i++)
-			end[i] = ent->v.origin[i] + time_left * ent->v.velocity[i];
-
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, false, ent);
-
-		if (trace.allsolid)
-		{	// entity is trapped in another solid
-			VectorCopy (vec3_origin, ent->v.velocity);
-			return 3;
-		}
-
-		if (trace.fraction > 0)
-		{	// actually covered some distance
-			VectorCopy (trace.endpos, ent->v.origin);
-			VectorCopy (ent->v.velocity, original_velocity);
-			numplanes = 0;
-		}
+	if (!trace->ent)
+		Sys_Error ("SV_PmoveTouch: !trace.ent");
 
-		if (trace.fraction == 1)
-			 break;		// moved the entire distance
-
-		if (!trace.ent)
-			Sys_Error ("SV_FlyMove: !trace.ent");
-
-		if (trace.plane.normal[2] > 0.7)
-		{
-			blocked |= 1;		// floor
-			if (trace.ent->v.solid == SOLID_BSP)
-			{
-				ent->v.flags =	(int)ent->v.flags | FL_ONGROUND;
-				ent->v.groundentity = EDICT_TO_PROG(trace.ent);
-			}
-		}
-		if (!trace.plane.normal[2])
-		{
-			blocked |= 2;		// step
-			if (steptrace)
-				*steptrace = trace;	// save for player extrafriction
-		}
-
-//
-// run the impact function
-//
-		SV_Impact (ent, trace.ent);
-		if (ent->free)
-			break;		// removed by the impact function
+	SV_Impact (ent, trace->ent);
+	return !ent->free;
+}
 
+/*
+================
+SV_PmoveLink
+================
+*/
+static void SV_PmoveLink (pmove_t *pm)
+{
+	SV_LinkEdict ((edict_t *) pm->user, true);
+}
 
-		time_left -= time_left * trace.fraction;
+/*
+================
+SV_InitPmove
 
-	// cliped to another plane
-		if (numplanes >= MAX_CLIP_PLANES)
-		{	// this shouldn't really happen
-			VectorCopy (vec3_origin, ent->v.velocity);
-			return 3;
-		}
+Sets up the shared movement code to move ent through the world, with the
+fields of the edict changed in place
+================
+*/
+void SV_InitPmove (pmove_t *pm, edict_t *ent)
+{
+	memset (pm, 0, sizeof (*pm));
+
+	pm->origin = ent->v.origin;
+	pm->velocity = ent->v.velocity;
+	pm->flags = &ent->v.flags;
+	pm->waterlevel = &ent->v.waterlevel;
+	pm->watertype = &ent->v.watertype;
+	pm->movetype = &ent->v.movetype;
+	pm->mins = ent->v.mins;
+	pm->maxs = ent->v.maxs;
+	pm->angles = ent->v.angles;
+	pm->v_angle = ent->v.v_angle;
+	pm->viewheight = ent->v.view_ofs[2];
+	pm->solid = ent->v.solid;
+	pm->teleported = qcvm->time < ent->v.teleport_time;
+
+	// same as SV_PushEntity
+	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
+		pm->pushtype = MOVE_MISSILE;
+	else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
+		pm->pushtype = MOVE_NOMONSTERS;
+	else
+		pm->pushtype = MOVE_NORMAL;
 
-		VectorCopy (trace.plane.normal, planes[numplanes]);
-		numplanes++;
+	pm->frametime = host_frametime;
+	SV_GetMovevars (ent, pm->movevars);
 
-//
-// modify original_velocity so it parallels all of the clip planes
-//
-		for (i=0 ; i<numplanes ; i++)
-		{
-			ClipVelocity (original_velocity, planes[i], new_velocity, 1);
-			for (j=0 ; j<numplanes ; j++)
-				if (j != i)
-				{
-					if (DotProduct (new_velocity, planes[j]) < 0)
-						break;	// not ok
-				}
-			if (j == numplanes)
-				break;
-		}
+	pm->move = SV_PmoveMove;
+	pm->pointcontents = SV_PmovePointContents;
+	pm->ground = SV_PmoveGround;
+	pm->touch = SV_PmoveTouch;
+	pm->link = SV_PmoveLink;
+	pm->user = ent;
+}
 
-		if (i != numplanes)
-		{	// go along this plane
-			VectorCopy (new_velocity, ent->v.velocity);
-		}
-		else
-		{	// go along the crease
-			if (numplanes != 2)
-			{
-//				Con_Printf ("clip velocity, numplanes == %i\n",numplanes);
-				VectorCopy (vec3_origin, ent->v.velocity);
-				return 7;
-			}
-			CrossProduct (planes[0], planes[1], dir);
-			d = DotProduct (dir, ent->v.velocity);
-			VectorScale (dir, d, ent->v.velocity);
-		}
+/*
+============
+SV_FlyMove
 
-//
-// if original velocity is against the original velocity, stop dead
-// to avoid tiny occilations in sloping corners
-//
-		if (DotProduct (ent->v.velocity, primal_velocity) <= 0)
-		{
-			VectorCopy (vec3_origin, ent->v.velocity);
-			return blocked;
-		}
-	}
+See PM_FlyMove
+============
+*/
+int SV_FlyMove (edict_t *ent, float time, trace_t *steptrace)
+{
+	pmove_t		pm;
 
-	return blocked;
+	SV_InitPmove (&pm, ent);
+	return PM_FlyMove (&pm, time, steptrace);
 }
 
 
@@ -537,7 +487,9 @@ void SV_PushMove (edict_t *pusher, float movetime)
 			{
 				pr_global_struct->self = EDICT_TO_PROG(pusher);
 				pr_global_struct->other = EDICT_TO_PROG(check);
+				SV_ProfileEnter (SVPROF_TOUCH);
 				PR_ExecuteProgram (pusher->v.blocked);
+				SV_ProfileLeave ();
 			}
 
 		// move back any entities we already moved
@@ -590,7 +542,9 @@ void SV_Physics_Pusher (edict_t *ent)
 		pr_global_struct->time = qcvm->time;
 		pr_global_struct->self = EDICT_TO_PROG(ent);
 		pr_global_struct->other = EDICT_TO_PROG(qcvm->edicts);
+		SV_ProfileEnter (SVPROF_THINK);
 		PR_ExecuteProgram (ent->v.think);
+		SV_ProfileLeave ();
 		if (ent->free)
 			return;
 	}
@@ -662,122 +616,10 @@ SV_CheckWater
 */
 qboolean SV_CheckWater (edict_t *ent)
 {
-	vec3_t	point;
-	int		cont;
+	pmove_t		pm;
 
-	point[0] = ent->v.origin[0];
-	point[1] = ent->v.origin[1];
-	point[2] = ent->v.origin[2] + ent->v.mins[2] + 1;
-
-	ent->v.waterlevel = 0;
-	ent->v.watertype = CONTENTS_EMPTY;
-	cont = SV_PointContents (point);
-	if (cont <= CONTENTS_WATER)
-	{
-		ent->v.watertype = cont;
-		ent->v.waterlevel = 1;
-		point[2] = ent->v.origin[2] + (ent->v.mins[2] + ent->v.maxs[2])*0.5;
-		cont = SV_PointContents (point);
-		if (cont <= CONTENTS_WATER)
-		{
-			ent->v.waterlevel = 2;
-			point[2] = ent->v.origin[2] + ent->v.view_ofs[2];
-			cont = SV_PointContents (point);
-			if (cont <= CONTENTS_WATER)
-				ent->v.waterlevel = 3;
-		}
-	}
-
-	return ent->v.waterlevel > 1;
-}
-
-/*
-============
-SV_WallFriction
-
-============
-*/
-void SV_WallFriction (edict_t *ent, trace_t *trace)
-{
-	vec3_t		forward, right, up;
-	float		d, i;
-	vec3_t		into, side;
-
-	AngleVectors (ent->v.v_angle, forward, right, up);
-	d = DotProduct (trace->plane.normal, forward);
-
-	d += 0.5;
-	if (d >= 0)
-		return;
-
-// cut the tangential velocity
-	i = DotProduct (trace->plane.normal, ent->v.velocity);
-	VectorScale (trace->plane.normal, i, into);
-	VectorSubtract (ent->v.velocity, into, side);
-
-	ent->v.velocity[0] = side[0] * (1 + d);
-	ent->v.velocity[1] = side[1] * (1 + d);
-}
-
-/*
-=====================
-SV_TryUnstick
-
-Player has come to a dead stop, possibly due to the problem with limited
-float precision at some angle joins in the BSP hull.
-
-Try fixing by pushing one pixel in each direction.
-
-This is a hack, but in the interest of good gameplay...
-======================
-*/
-int SV_TryUnstick (edict_t *ent, vec3_t oldvel)
-{
-	int		i;
-	vec3_t	oldorg;
-	vec3_t	dir;
-	int		clip;
-	trace_t	steptrace;
-
-	VectorCopy (ent->v.origin, oldorg);
-	VectorCopy (vec3_origin, dir);
-
-	for (i=0 ; i<8 ; i++)
-	{
-// try pushing a little in an axial direction
-		switch (i)
-		{
-			case 0:	dir[0] = 2; dir[1] = 0; break;
-			case 1:	dir[0] = 0; dir[1] = 2; break;
-			case 2:	dir[0] = -2; dir[1] = 0; break;
-			case 3:	dir[0] = 0; dir[1] = -2; break;
-			case 4:	dir[0] = 2; dir[1] = 2; break;
-			case 5:	dir[0] = -2; dir[1] = 2; break;
-			case 6:	dir[0] = 2; dir[1] = -2; break;
-			case 7:	dir[0] = -2; dir[1] = -2; break;
-		}
-
-		SV_PushEntity (ent, dir);
-
-// retry the original move
-		ent->v.velocity[0] = oldvel[0];
-		ent->v. velocity[1] = oldvel[1];
-		ent->v. velocity[2] = 0;
-		clip = SV_FlyMove (ent, 0.1, &steptrace);
-
-		if ( fabs(oldorg[1] - ent->v.origin[1]) > 4
-			|| fabs(oldorg[0] - ent->v.origin[0]) > 4 )
-		{
-		//	Con_DPrintf ("unstuck!\n");
-			return clip;
-		}
-
-// go back to the original pos and try again
-		VectorCopy (oldorg, ent->v.origin);
-	}
-
-	VectorCopy (vec3_origin, ent->v.velocity);
-	return 7;		// still not moving
+	SV_InitPmove (&pm, ent);
+	return PM_CheckWater (&pm);
 }
 
 /*
@@ -787,98 +629,12 @@ SV_WalkMove
 Only used by players
 ======================
 */
-#define	STEPSIZE	18
 void SV_WalkMove (edict_t *ent)
 {
-	vec3_t		upmove, downmove;
-	vec3_t		oldorg, oldvel;
-	vec3_t		nosteporg, nostepvel;
-	int			clip;
-	int			oldonground;
-	trace_t		steptrace, downtrace;
+	pmove_t		pm;
 
-//
-// do a regular slide move unless it looks like you ran into a step
-//
-	oldonground = (int)ent->v.flags & FL_ONGROUND;
-	ent->v.flags = (int)ent->v.flags & ~FL_ONGROUND;
-
-	VectorCopy (ent->v.origin, oldorg);
-	VectorCopy (ent->v.velocity, oldvel);
-
-	clip = SV_FlyMove (ent, host_frametime, &steptrace);
-
-	if ( !(clip & 2) )
-		return;		// move didn't block on a step
-
-	if (!oldonground && ent->v.waterlevel == 0)
-		return;		// don't stair up while jumping
-
-	if (ent->v.movetype != MOVETYPE_WALK)
-		return;		// gibbed by a trigger
-
-	if (sv_nostep.value)
-		return;
-
-	if ( (int)sv_player->v.flags & FL_WATERJUMP )
-		return;
-
-	VectorCopy (ent->v.origin, nosteporg);
-	VectorCopy (ent->v.velocity, nostepvel);
-
-//
-// try moving up and forward to go up a step
-//
-	VectorCopy (oldorg, ent->v.origin);	// back to start pos
-
-	VectorCopy (vec3_origin, upmove);
-	VectorCopy (vec3_origin, downmove);
-	upmove[2] = STEPSIZE;
-	downmove[2] = -STEPSIZE + oldvel[2]*host_frametime;
-
-// move up
-	SV_PushEntity (ent, upmove);	// FIXME: don't link?
-
-// move forward
-	ent->v.velocity[0] = oldvel[0];
-	ent->v. velocity[1] = oldvel[1];
-	ent->v. velocity[2] = 0;
-	clip = SV_FlyMove (ent, host_frametime, &steptrace);
-
-// check for stuckness, possibly due to the limited precision of floats
-// in the clipping hulls
-	if (clip)
-	{
-		if ( fabs(oldorg[1] - ent->v.origin[1]) < 0.03125
-		&& fabs(oldorg[0] - ent->v.origin[0]) < 0.03125 )
-		{	// stepping up didn't make any progress
-			clip = SV_TryUnstick (ent, oldvel);
-		}
-	}
-
-// extra friction based on view angle
-	if ( clip & 2 )
-		SV_WallFriction (ent, &steptrace);
-
-// move down
-	downtrace = SV_PushEntity (ent, downmove);	// FIXME: don't link?
-
-	if (downtrace.plane.normal[2] > 0.7)
-	{
-		if (ent->v.solid == SOLID_BSP)
-		{
-			ent->v.flags =	(int)ent->v.flags | FL_ONGROUND;
-			ent->v.groundentity = EDICT_TO_PROG(downtrace.ent);
-		}
-	}
-	else
-	{
-// if the push down didn't end up on good ground, use the move without
-// the step up.  This happens near wall / slope combinations, and can
-// cause the player to hop up higher on a slope too steep to climb
-		VectorCopy (nosteporg, ent->v.origin);
-		VectorCopy (nostepvel, ent->v.velocity);
-	}
+	SV_InitPmove (&pm, ent);
+	PM_WalkMove (&pm);
 }
 
 
@@ -901,7 +657,9 @@ void SV_Physics_Client (edict_t	*ent, int num)
 //
 	pr_global_struct->time = qcvm->time;
 	pr_global_struct->self = EDICT_TO_PROG(ent);
+	SV_ProfileEnter (SVPROF_THINK);
 	PR_ExecuteProgram (pr_global_struct->PlayerPreThink);
+	SV_ProfileLeave ();
 
 //
 // do a move
@@ -958,7 +716,9 @@ void SV_Physics_Client (edict_t	*ent, int num)
 
 	pr_global_struct->time = qcvm->time;
 	pr_global_struct->self = EDICT_TO_PROG(ent);
+	SV_ProfileEnter (SVPROF_THINK);
 	PR_ExecuteProgram (pr_global_struct->PlayerPostThink);
+	SV_ProfileLeave ();
 
 	forceunderwater = !wasunderwater && ent->v.waterlevel >= 3;
 	if (forceunderwater != ent->forcewater)
@@ -1093,7 +853,7 @@ void SV_Physics_Toss (edict_t *ent)
 	else
 		backoff = 1;
 
-	ClipVelocity (ent->v.velocity, trace.plane.normal, ent->v.velocity, backoff);
+	PM_ClipVelocity (ent->v.velocity, trace.plane.normal, ent->v.velocity, backoff);
 
 // stop if on ground
 	if (trace.plane.normal[2] > 0.7)
@@ -1161,28 +921,284 @@ void SV_Physics_Step (edict_t *ent)
 }
 
 
+//============================================================================
+
+/*
+===============================================================================
+
+PHYSICS LISTS
+
+Every active edict is kept on a dense list for its dispatch class, so that
+sv_physicsbuckets can run each class in its own loop without visiting free
+slots.  ED_Alloc appends to the lists, while freed edicts and movetype
+changes made by QC are picked up lazily by SV_SyncPhysicsLists at the start
+of each frame.
+
+===============================================================================
+*/
+
+/*
+=============
+SV_PhysicsClass
+=============
+*/
+static physclass_t SV_PhysicsClass (edict_t *ent, int num)
+{
+	if (num > 0 && num <= svs.maxclients)
+		return PHYS_CLIENT;
+
+	switch ((int)ent->v.movetype)
+	{
+	case MOVETYPE_PUSH:
+		return PHYS_PUSH;
+	case MOVETYPE_NONE:
+		return PHYS_NONE;
+	case MOVETYPE_NOCLIP:
+		return PHYS_NOCLIP;
+	case MOVETYPE_STEP:
+		return PHYS_STEP;
+	case MOVETYPE_TOSS:
+	case MOVETYPE_GIB:
+	case MOVETYPE_BOUNCE:
+	case MOVETYPE_FLY:
+	case MOVETYPE_FLYMISSILE:
+		return PHYS_TOSS;
+	default:
+		return PHYS_BAD;
+	}
+}
+
+/*
+=============
+SV_InitPhysicsLists
+
+Called by SV_SpawnServer once max_edicts is known
+=============
+*/
+void SV_InitPhysicsLists (void)
+{
+	int		i;
+
+	for (i = PHYS_CLIENT; i < NUM_PHYS_CLASSES; i++)
+	{
+		sv.physlists[i].ents = (int *) Hunk_AllocName (qcvm->max_edicts * sizeof (int), "physlist");
+		sv.physlists[i].count = 0;
+		sv.physlists[i].unsorted = false;
+	}
+	sv.physlistsvalid = false;
+}
+
+/*
+=============
+SV_AppendToPhysicsList
+=============
+*/
+static void SV_AppendToPhysicsList (edict_t *ent, int num, physclass_t pc)
+{
+	physlist_t	*list = &sv.physlists[pc];
+
+	if (list->count > 0 && list->ents[list->count - 1] > num)
+		list->unsorted = true;
+	list->ents[list->count++] = num;
+	ent->physclass = pc;
+}
+
+/*
+=============
+SV_AddToPhysicsList
+
+Called by ED_Alloc for every edict handed out by the server qcvm
+=============
+*/
+void SV_AddToPhysicsList (edict_t *ent)
+{
+	int		num;
+
+	if (!sv.physlistsvalid || ent->physclass != PHYS_UNLISTED)
+		return;
+
+	num = NUM_FOR_EDICT (ent);
+	ent->physmovetype = ent->v.movetype;
+	SV_AppendToPhysicsList (ent, num, SV_PhysicsClass (ent, num));
+}
+
+/*
+=============
+SV_RebuildPhysicsLists
+
+Used after map spawn and savegame loads, which set up edicts without ED_Alloc
+=============
+*/
+static void SV_RebuildPhysicsLists (void)
+{
+	int		i;
+	edict_t	*ent;
+
+	for (i = PHYS_CLIENT; i < NUM_PHYS_CLASSES; i++)
+	{
+		sv.physlists[i].count = 0;
+		sv.physlists[i].unsorted = false;
+	}
+
+	for (i = 0, ent = qcvm->edicts; i < qcvm->num_edicts; i++, ent = NEXT_EDICT (ent))
+	{
+		ent->physclass = PHYS_UNLISTED;
+		if (ent->free)
+			continue;
+		ent->physmovetype = ent->v.movetype;
+		SV_AppendToPhysicsList (ent, i, SV_PhysicsClass (ent, i));
+	}
+
+	sv.physlistsvalid = true;
+}
+
+/*
+=============
+SV_ComparePhysicsListEntries
+=============
+*/
+static int SV_ComparePhysicsListEntries (const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+=============
+SV_SyncPhysicsLists
+
+Drops freed edicts, moves edicts whose movetype changed and restores
+ascending edict order within each list
+=============
+*/
+static void SV_SyncPhysicsLists (void)
+{
+	int			i, num;
+	physclass_t	pc, newpc;
+	physlist_t	*list;
+	edict_t		*ent;
+
+	if (!sv.physlistsvalid)
+	{
+		SV_RebuildPhysicsLists ();
+		return;
+	}
+
+	for (pc = PHYS_CLIENT; pc < NUM_PHYS_CLASSES; pc++)
+	{
+		list = &sv.physlists[pc];
+		for (i = 0; i < list->count; )
+		{
+			num = list->ents[i];
+			ent = EDICT_NUM (num);
+			if (!ent->free && ent->v.movetype == ent->physmovetype)
+			{
+				i++;
+				continue;
+			}
+
+			newpc = PHYS_UNLISTED;
+			if (!ent->free)
+			{
+				ent->physmovetype = ent->v.movetype;
+				newpc = SV_PhysicsClass (ent, num);
+				if (newpc == pc)
+				{
+					i++;
+					continue;
+				}
+			}
+
+			list->ents[i] = list->ents[--list->count];
+			list->unsorted = true;
+			ent->physclass = PHYS_UNLISTED;
+			if (newpc != PHYS_UNLISTED)
+				SV_AppendToPhysicsList (ent, num, newpc);
+		}
+	}
+
+	for (pc = PHYS_CLIENT; pc < NUM_PHYS_CLASSES; pc++)
+	{
+		list = &sv.physlists[pc];
+		if (list->unsorted)
+		{
+			qsort (list->ents, list->count, sizeof (list->ents[0]), SV_ComparePhysicsListEntries);
+			list->unsorted = false;
+		}
+	}
+}
+
 //============================================================================
 
 /*
 ================
-SV_Physics
+SV_RunPhysicsClass
+================
+*/
+static void SV_RunPhysicsClass (edict_t *ent, int num, physclass_t pc)
+{
+	if (pc != PHYS_BAD)
+		SV_ProfileEnter (SVPROF_PHYS_CLIENT + (pc - PHYS_CLIENT));
+
+	switch (pc)
+	{
+	case PHYS_CLIENT:
+		SV_Physics_Client (ent, num);
+		break;
+	case PHYS_PUSH:
+		SV_Physics_Pusher (ent);
+		break;
+	case PHYS_NONE:
+		SV_Physics_None (ent);
+		break;
+	case PHYS_NOCLIP:
+		SV_Physics_Noclip (ent);
+		break;
+	case PHYS_STEP:
+		SV_Physics_Step (ent);
+		break;
+	case PHYS_TOSS:
+		SV_Physics_Toss (ent);
+		break;
+	default:
+		Sys_Error ("SV_Physics: bad movetype %i", (int)ent->v.movetype);
+	}
+
+	SV_ProfileLeave ();
+}
+
+/*
+================
+SV_CheckSendInterval
 
+johnfitz -- PROTOCOL_FITZQUAKE
+capture interval to nextthink here and send it to client for better
+lerp timing, but only if interval is not 0.1 (which client assumes)
 ================
 */
-void SV_Physics (void)
+static void SV_CheckSendInterval (edict_t *ent)
+{
+	ent->sendinterval = false;
+	if (!ent->free && ent->v.nextthink > qcvm->time && (ent->v.movetype == MOVETYPE_STEP || ent->v.movetype == MOVETYPE_WALK || ent->v.frame != ent->oldframe))
+	{
+		int j = Q_rint((ent->v.nextthink-ent->oldthinktime)*255);
+		if (j >= 0 && j < 256 && j != 25 && j != 26) //25 and 26 are close enough to 0.1 to not send
+			ent->sendinterval = true;
+	}
+}
+
+/*
+================
+SV_PhysicsInEdictOrder
+
+Runs every edict in ascending edict order, exactly like the original engine
+================
+*/
+static void SV_PhysicsInEdictOrder (void)
 {
 	int	i;
 	int	entity_cap; // For sv_freezenonclients 
 	edict_t	*ent;
 
-// let the progs know that a new frame has started
-	pr_global_struct->self = EDICT_TO_PROG(qcvm->edicts);
-	pr_global_struct->other = EDICT_TO_PROG(qcvm->edicts);
-	pr_global_struct->time = qcvm->time;
-	PR_ExecuteProgram (pr_global_struct->StartFrame);
-
-//SV_CheckAllEnts ();
-
 //
 // treat each object in turn
 //
@@ -1204,37 +1220,88 @@ void SV_Physics (void)
 			SV_LinkEdict (ent, true);	// force retouch even for stationary
 		}
 
-		if (i > 0 && i <= svs.maxclients)
-			SV_Physics_Client (ent, i);
-		else if (ent->v.movetype == MOVETYPE_PUSH)
-			SV_Physics_Pusher (ent);
-		else if (ent->v.movetype == MOVETYPE_NONE)
-			SV_Physics_None (ent);
-		else if (ent->v.movetype == MOVETYPE_NOCLIP)
-			SV_Physics_Noclip (ent);
-		else if (ent->v.movetype == MOVETYPE_STEP)
-			SV_Physics_Step (ent);
-		else if (ent->v.movetype == MOVETYPE_TOSS
-		|| ent->v.movetype == MOVETYPE_GIB
-		|| ent->v.movetype == MOVETYPE_BOUNCE
-		|| ent->v.movetype == MOVETYPE_FLY
-		|| ent->v.movetype == MOVETYPE_FLYMISSILE)
-			SV_Physics_Toss (ent);
-		else
-			Sys_Error ("SV_Physics: bad movetype %i", (int)ent->v.movetype);
+		SV_RunPhysicsClass (ent, i, SV_PhysicsClass (ent, i));
+
+		SV_CheckSendInterval (ent);
+	}
+}
 
-	//johnfitz -- PROTOCOL_FITZQUAKE
-	//capture interval to nextthink here and send it to client for better
-	//lerp timing, but only if interval is not 0.1 (which client assumes)
-		ent->sendinterval = false;
-		if (!ent->free && ent->v.nextthink > qcvm->time && (ent->v.movetype == MOVETYPE_STEP || ent->v.movetype == MOVETYPE_WALK || ent->v.frame != ent->oldframe))
+/*
+================
+SV_PhysicsInClassOrder
+
+Runs each dispatch class in its own loop.  Within a class edicts still run
+in ascending order, but classes run one after another (clients, pushers,
+none, noclip, step, toss) and edicts spawned during the frame wait for the
+next one.
+================
+*/
+static void SV_PhysicsInClassOrder (void)
+{
+	int			i, num, count;
+	physclass_t	pc;
+	physlist_t	*list;
+	edict_t		*ent;
+
+	SV_SyncPhysicsLists ();
+
+	if (pr_global_struct->force_retouch)
+	{
+		for (pc = PHYS_CLIENT; pc < NUM_PHYS_CLASSES; pc++)
 		{
-			int j = Q_rint((ent->v.nextthink-ent->oldthinktime)*255);
-			if (j >= 0 && j < 256 && j != 25 && j != 26) //25 and 26 are close enough to 0.1 to not send
-				ent->sendinterval = true;
+			list = &sv.physlists[pc];
+			for (i = 0, count = list->count; i < count; i++)
+			{
+				ent = EDICT_NUM (list->ents[i]);
+				if (!ent->free)
+					SV_LinkEdict (ent, true);	// force retouch even for stationary
+			}
+		}
+	}
+
+	for (pc = PHYS_CLIENT; pc < NUM_PHYS_CLASSES; pc++)
+	{
+		list = &sv.physlists[pc];
+		for (i = 0, count = list->count; i < count; i++)
+		{
+			num = list->ents[i];
+			ent = EDICT_NUM (num);
+			if (ent->free)
+				continue;
+
+			// QC may have changed the movetype since the lists were synced
+			if (ent->v.movetype == ent->physmovetype)
+				SV_RunPhysicsClass (ent, num, pc);
+			else
+				SV_RunPhysicsClass (ent, num, SV_PhysicsClass (ent, num));
+
+			SV_CheckSendInterval (ent);
 		}
-	//johnfitz
 	}
+}
+
+/*
+================
+SV_Physics
+
+================
+*/
+void SV_Physics (void)
+{
+// let the progs know that a new frame has started
+	pr_global_struct->self = EDICT_TO_PROG(qcvm->edicts);
+	pr_global_struct->other = EDICT_TO_PROG(qcvm->edicts);
+	pr_global_struct->time = qcvm->time;
+	SV_ProfileEnter (SVPROF_STARTFRAME);
+	PR_ExecuteProgram (pr_global_struct->StartFrame);
+	SV_ProfileLeave ();
+
+//SV_CheckAllEnts ();
+
+	if (sv_physicsbuckets.value && !sv_freezenonclients.value)
+		SV_PhysicsInClassOrder ();
+	else
+		SV_PhysicsInEdictOrder ();
 
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;
@@ -0,0 +1,334 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// sv_profile.c -- server tick phase profiler
+//
+// Every server tick is split into phases that are timed exclusively: when a
+// phase is entered the time spent so far is charged to the enclosing one, so
+// a QC think function called from toss physics counts as "think" and not as
+// "toss", and all phases of a tick add up to its total time.
+
+#include "quakedef.h"
+
+cvar_t	sv_profile = {"sv_profile", "0", CVAR_NONE};			// print interval in seconds
+cvar_t	sv_profile_csv = {"sv_profile_csv", "", CVAR_NONE};	// append per-tick rows to this file
+
+svprofile_t	sv_prof;
+
+#define MAX_SVPROF_DEPTH	32
+
+static const char *svprof_names[NUM_SVPROF_PHASES] =
+{
+	"other",
+	"clients",
+	"startframe",
+	"phys client",
+	"phys push",
+	"phys none",
+	"phys noclip",
+	"phys step",
+	"phys toss",
+	"think",
+	"touch",
+	"encode",
+	"send",
+};
+
+static struct
+{
+	double		mark;							// time of the last phase switch
+	double		start;							// start of the current tick
+	int			stack[MAX_SVPROF_DEPTH];
+	int			depth;
+	int			overflow;						// unbalanced enters beyond MAX_SVPROF_DEPTH
+	double		times[NUM_SVPROF_PHASES];		// current tick
+} svprof_tick;
+
+static struct
+{
+	double		start;							// wall clock time the window started
+	int			ticks;
+	double		total, maxtotal;
+	double		times[NUM_SVPROF_PHASES];
+	double		maxtimes[NUM_SVPROF_PHASES];
+	double		traces, links;
+} svprof_window;
+
+static FILE		*svprof_csv;
+static char		svprof_csvname[MAX_OSPATH];
+
+/*
+==================
+SV_ProfileCloseCSV
+==================
+*/
+static void SV_ProfileCloseCSV (void)
+{
+	if (!svprof_csv)
+		return;
+	fclose (svprof_csv);
+	svprof_csv = NULL;
+	svprof_csvname[0] = '\0';
+}
+
+/*
+==================
+SV_ProfileOpenCSV
+
+(Re)opens the file named by sv_profile_csv if it changed
+==================
+*/
+static void SV_ProfileOpenCSV (void)
+{
+	char	path[MAX_OSPATH];
+	int		i;
+
+	if (svprof_csv && !strcmp (svprof_csvname, sv_profile_csv.string))
+		return;
+
+	SV_ProfileCloseCSV ();
+
+	if (strstr (sv_profile_csv.string, ".."))
+	{
+		Con_Printf ("sv_profile_csv: relative pathnames are not allowed\n");
+		Cvar_SetQuick (&sv_profile_csv, "");
+		return;
+	}
+
+	q_snprintf (path, sizeof (path), "%s/%s", com_gamedir, sv_profile_csv.string);
+	svprof_csv = Sys_fopen (path, "a");
+	if (!svprof_csv)
+	{
+		Con_Printf ("sv_profile_csv: couldn't open %s\n", path);
+		Cvar_SetQuick (&sv_profile_csv, "");
+		return;
+	}
+	q_strlcpy (svprof_csvname, sv_profile_csv.string, sizeof (svprof_csvname));
+
+	// new file, write the column names first
+	fseek (svprof_csv, 0, SEEK_END);
+	if (ftell (svprof_csv) == 0)
+	{
+		fprintf (svprof_csv, "time,frametime,total");
+		for (i = 0; i < NUM_SVPROF_PHASES; i++)
+			fprintf (svprof_csv, ",%s", svprof_names[i]);
+		fprintf (svprof_csv, ",traces,links,edicts,clients\n");
+	}
+}
+
+/*
+==================
+SV_ProfileWriteCSV
+==================
+*/
+static void SV_ProfileWriteCSV (double total)
+{
+	int		i, clients;
+
+	SV_ProfileOpenCSV ();
+	if (!svprof_csv)
+		return;
+
+	for (i = 0, clients = 0; i < svs.maxclients; i++)
+		if (svs.clients[i].active)
+			clients++;
+
+	fprintf (svprof_csv, "%.4f,%.3f,%.4f", qcvm->time, host_frametime * 1000.0, total * 1000.0);
+	for (i = 0; i < NUM_SVPROF_PHASES; i++)
+		fprintf (svprof_csv, ",%.4f", svprof_tick.times[i] * 1000.0);
+	fprintf (svprof_csv, ",%d,%d,%d,%d\n", sv_prof.traces, sv_prof.links, qcvm->num_edicts, clients);
+}
+
+/*
+==================
+SV_ProfilePrint
+
+Prints the averages and peaks of the current window
+==================
+*/
+static void SV_ProfilePrint (void)
+{
+	double	scale;
+	int		i;
+
+	if (!svprof_window.ticks)
+		return;
+
+	scale = 1000.0 / svprof_window.ticks;
+	Con_Printf ("svprof: %d ticks, %.3f ms avg, %.3f ms max, %.0f traces, %.0f links per tick\n",
+		svprof_window.ticks,
+		svprof_window.total * scale,
+		svprof_window.maxtotal * 1000.0,
+		svprof_window.traces / svprof_window.ticks,
+		svprof_window.links / svprof_window.ticks);
+
+	for (i = 0; i < NUM_SVPROF_PHASES; i++)
+	{
+		if (!svprof_window.maxtimes[i])
+			continue;
+		Con_Printf ("  %-12s %7.3f avg %7.3f max %5.1f%%\n",
+			svprof_names[i],
+			svprof_window.times[i] * scale,
+			svprof_window.maxtimes[i] * 1000.0,
+			svprof_window.total > 0.0 ? 100.0 * svprof_window.times[i] / svprof_window.total : 0.0);
+	}
+}
+
+/*
+==================
+SV_ProfileBeginTick
+
+Called at the start of Host_ServerFrame
+==================
+*/
+void SV_ProfileBeginTick (void)
+{
+	sv_prof.traces = 0;
+	sv_prof.links = 0;
+	sv_prof.active = sv_profile.value > 0.f || sv_profile_csv.string[0] || sv_prof.capture;
+
+	if (!sv_prof.active)
+	{
+		SV_ProfileCloseCSV ();
+		svprof_window.start = 0.0;
+		return;
+	}
+
+	memset (svprof_tick.times, 0, sizeof (svprof_tick.times));
+	svprof_tick.depth = 0;
+	svprof_tick.overflow = 0;
+	svprof_tick.stack[0] = SVPROF_OTHER;
+	svprof_tick.start = svprof_tick.mark = Sys_DoubleTime ();
+
+	if (!svprof_window.start)
+	{
+		memset (&svprof_window, 0, sizeof (svprof_window));
+		svprof_window.start = svprof_tick.start;
+	}
+}
+
+/*
+==================
+SV_ProfileEndTick
+
+Called at the end of Host_ServerFrame
+==================
+*/
+void SV_ProfileEndTick (void)
+{
+	double	now, total;
+	int		i;
+
+	if (!sv_prof.active)
+		return;
+
+	now = Sys_DoubleTime ();
+	svprof_tick.times[svprof_tick.stack[svprof_tick.depth]] += now - svprof_tick.mark;
+	total = now - svprof_tick.start;
+	sv_prof.active = false;
+	sv_prof.total = total;
+	memcpy (sv_prof.times, svprof_tick.times, sizeof (sv_prof.times));
+
+	svprof_window.ticks++;
+	svprof_window.total += total;
+	svprof_window.maxtotal = q_max (svprof_window.maxtotal, total);
+	svprof_window.traces += sv_prof.traces;
+	svprof_window.links += sv_prof.links;
+	for (i = 0; i < NUM_SVPROF_PHASES; i++)
+	{
+		svprof_window.times[i] += svprof_tick.times[i];
+		svprof_window.maxtimes[i] = q_max (svprof_window.maxtimes[i], svprof_tick.times[i]);
+	}
+
+	if (sv_profile_csv.string[0])
+		SV_ProfileWriteCSV (total);
+	else
+		SV_ProfileCloseCSV ();
+
+	if (now - svprof_window.start >= q_max (sv_profile.value, 1.f))
+	{
+		if (sv_profile.value > 0.f)
+			SV_ProfilePrint ();
+		if (svprof_csv)
+			fflush (svprof_csv);
+		svprof_window.start = 0.0;
+	}
+}
+
+/*
+==================
+SV_ProfileEnter
+
+Starts charging time to phase until the matching SV_ProfileLeave
+==================
+*/
+void SV_ProfileEnter (svprofphase_t phase)
+{
+	double	now;
+
+	if (!sv_prof.active)
+		return;
+
+	if (svprof_tick.depth == MAX_SVPROF_DEPTH - 1)
+	{
+		svprof_tick.overflow++;
+		return;
+	}
+
+	now = Sys_DoubleTime ();
+	svprof_tick.times[svprof_tick.stack[svprof_tick.depth]] += now - svprof_tick.mark;
+	svprof_tick.mark = now;
+	svprof_tick.stack[++svprof_tick.depth] = phase;
+}
+
+/*
+==================
+SV_ProfileLeave
+==================
+*/
+void SV_ProfileLeave (void)
+{
+	double	now;
+
+	if (!sv_prof.active)
+		return;
+
+	if (svprof_tick.overflow)
+	{
+		svprof_tick.overflow--;
+		return;
+	}
+
+	now = Sys_DoubleTime ();
+	svprof_tick.times[svprof_tick.stack[svprof_tick.depth]] += now - svprof_tick.mark;
+	svprof_tick.mark = now;
+	if (svprof_tick.depth > 0)
+		svprof_tick.depth--;
+}
+
+/*
+==================
+SV_Profile_Init
+==================
+*/
+void SV_Profile_Init (void)
+{
+	Cvar_RegisterVariable (&sv_profile);
+	Cvar_RegisterVariable (&sv_profile_csv);
+}
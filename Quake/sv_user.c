@@ -25,19 +25,21 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 edict_t	*sv_player;
 
+extern	cvar_t	sv_gravity;
 extern	cvar_t	sv_friction;
 cvar_t	sv_edgefriction = {"edgefriction", "2", CVAR_NONE};
 extern	cvar_t	sv_stopspeed;
+extern	cvar_t	sv_nostep;
+cvar_t	sv_maxspeed = {"sv_maxspeed", "320", CVAR_NOTIFY|CVAR_SERVERINFO};
+cvar_t	sv_accelerate = {"sv_accelerate", "10", CVAR_NONE};
+cvar_t	sv_jumpvelocity = {"sv_jumpvelocity", "270", CVAR_NONE};	// what PlayerPreThink adds on a jump, for client prediction only, 0 = the progs jump differently, don't predict jumps
 
 static	vec3_t		forward, right, up;
 
 // world
 float	*angles;
-float	*origin;
 float	*velocity;
 
-qboolean	onground;
-
 usercmd_t	cmd;
 
 cvar_t	sv_idealpitchscale = {"sv_idealpitchscale","0.8",CVAR_NONE};
@@ -114,96 +116,27 @@ void SV_SetIdealPitch (void)
 
 /*
 ==================
-SV_UserFriction
+SV_GetMovevars
 
+The settings the shared movement code runs with, sent to predicting clients
+with svc_movevars
 ==================
 */
-void SV_UserFriction (void)
+void SV_GetMovevars (edict_t *ent, float *movevars)
 {
-	float	*vel;
-	float	speed, newspeed, control;
-	vec3_t	start, stop;
-	float	friction;
-	trace_t	trace;
-
-	vel = velocity;
-
-	speed = sqrt(vel[0]*vel[0] +vel[1]*vel[1]);
-	if (!speed)
-		return;
-
-// if the leading edge is over a dropoff, increase friction
-	start[0] = stop[0] = origin[0] + vel[0]/speed*16;
-	start[1] = stop[1] = origin[1] + vel[1]/speed*16;
-	start[2] = origin[2] + sv_player->v.mins[2];
-	stop[2] = start[2] - 34;
-
-	trace = SV_Move (start, vec3_origin, vec3_origin, stop, true, sv_player);
-
-	if (trace.fraction == 1.0)
-		friction = sv_friction.value*sv_edgefriction.value;
-	else
-		friction = sv_friction.value;
-
-// apply friction
-	control = speed < sv_stopspeed.value ? sv_stopspeed.value : speed;
-	newspeed = speed - host_frametime*control*friction;
-
-	if (newspeed < 0)
-		newspeed = 0;
-	newspeed /= speed;
-
-	vel[0] = vel[0] * newspeed;
-	vel[1] = vel[1] * newspeed;
-	vel[2] = vel[2] * newspeed;
+	eval_t	*val;
+
+	val = GetEdictFieldValue (ent, qcvm->extfields.gravity);
+	movevars[MV_GRAVITY] = sv_gravity.value * (val && val->_float ? val->_float : 1.f);
+	movevars[MV_FRICTION] = sv_friction.value;
+	movevars[MV_STOPSPEED] = sv_stopspeed.value;
+	movevars[MV_MAXSPEED] = sv_maxspeed.value;
+	movevars[MV_ACCELERATE] = sv_accelerate.value;
+	movevars[MV_EDGEFRICTION] = sv_edgefriction.value;
+	movevars[MV_NOSTEP] = sv_nostep.value;
+	movevars[MV_JUMPVELOCITY] = sv_jumpvelocity.value;
 }
 
-/*
-==============
-SV_Accelerate
-==============
-*/
-cvar_t	sv_maxspeed = {"sv_maxspeed", "320", CVAR_NOTIFY|CVAR_SERVERINFO};
-cvar_t	sv_accelerate = {"sv_accelerate", "10", CVAR_NONE};
-void SV_Accelerate (float wishspeed, const vec3_t wishdir)
-{
-	int			i;
-	float		addspeed, accelspeed, currentspeed;
-
-	currentspeed = DotProduct (velocity, wishdir);
-	addspeed = wishspeed - currentspeed;
-	if (addspeed <= 0)
-		return;
-	accelspeed = sv_accelerate.value*host_frametime*wishspeed;
-	if (accelspeed > addspeed)
-		accelspeed = addspeed;
-
-	for (i=0 ; i<3 ; i++)
-		velocity[i] += accelspeed*wishdir[i];
-}
-
-void SV_AirAccelerate (float wishspeed, vec3_t wishveloc)
-{
-	int			i;
-	float		addspeed, wishspd, accelspeed, currentspeed;
-
-	wishspd = VectorNormalize (wishveloc);
-	if (wishspd > 30)
-		wishspd = 30;
-	currentspeed = DotProduct (velocity, wishveloc);
-	addspeed = wishspd - currentspeed;
-	if (addspeed <= 0)
-		return;
-//	accelspeed = sv_accelerate.value * host_frametime;
-	accelspeed = sv_accelerate.value*wishspeed * host_frametime;
-	if (accelspeed > addspeed)
-		accelspeed = addspeed;
-
-	for (i=0 ; i<3 ; i++)
-		velocity[i] += accelspeed*wishveloc[i];
-}
-
-
 void DropPunchAngle (void)
 {
 	float	len;
@@ -216,72 +149,6 @@ void DropPunchAngle (void)
 	VectorScale (sv_player->v.punchangle, len, sv_player->v.punchangle);
 }
 
-/*
-===================
-SV_WaterMove
-
-===================
-*/
-void SV_WaterMove (void)
-{
-	int		i;
-	vec3_t	wishvel;
-	float	speed, newspeed, wishspeed, addspeed, accelspeed;
-
-//
-// user intentions
-//
-	AngleVectors (sv_player->v.v_angle, forward, right, up);
-
-	for (i=0 ; i<3 ; i++)
-		wishvel[i] = forward[i]*cmd.forwardmove + right[i]*cmd.sidemove;
-
-	if (!cmd.forwardmove && !cmd.sidemove && !cmd.upmove)
-		wishvel[2] -= 60;		// drift towards bottom
-	else
-		wishvel[2] += cmd.upmove;
-
-	wishspeed = VectorLength(wishvel);
-	if (wishspeed > sv_maxspeed.value)
-	{
-		VectorScale (wishvel, sv_maxspeed.value/wishspeed, wishvel);
-		wishspeed = sv_maxspeed.value;
-	}
-	wishspeed *= 0.7;
-
-//
-// water friction
-//
-	speed = VectorLength (velocity);
-	if (speed)
-	{
-		newspeed = speed - host_frametime * speed * sv_friction.value;
-		if (newspeed < 0)
-			newspeed = 0;
-		VectorScale (velocity, newspeed/speed, velocity);
-	}
-	else
-		newspeed = 0;
-
-//
-// water acceleration
-//
-	if (!wishspeed)
-		return;
-
-	addspeed = wishspeed - newspeed;
-	if (addspeed <= 0)
-		return;
-
-	VectorNormalize (wishvel);
-	accelspeed = sv_accelerate.value * wishspeed * host_frametime;
-	if (accelspeed > addspeed)
-		accelspeed = addspeed;
-
-	for (i=0 ; i<3 ; i++)
-		velocity[i] += accelspeed * wishvel[i];
-}
-
 void SV_WaterJump (void)
 {
 	if (qcvm->time > sv_player->v.teleport_time
@@ -298,7 +165,7 @@ void SV_WaterJump (void)
 ===================
 SV_NoclipMove -- johnfitz
 
-new, alternate noclip. old noclip is still handled in SV_AirMove
+new, alternate noclip. old noclip is still handled in PM_AirMove
 ===================
 */
 void SV_NoclipMove (void)
@@ -317,58 +184,6 @@ void SV_NoclipMove (void)
 	}
 }
 
-/*
-===================
-SV_AirMove
-===================
-*/
-void SV_AirMove (void)
-{
-	int			i;
-	vec3_t		wishvel, wishdir;
-	float		wishspeed;
-	float		fmove, smove;
-
-	AngleVectors (sv_player->v.angles, forward, right, up);
-
-	fmove = cmd.forwardmove;
-	smove = cmd.sidemove;
-
-// hack to not let you back into teleporter
-	if (qcvm->time < sv_player->v.teleport_time && fmove < 0)
-		fmove = 0;
-
-	for (i=0 ; i<3 ; i++)
-		wishvel[i] = forward[i]*fmove + right[i]*smove;
-
-	if ( (int)sv_player->v.movetype != MOVETYPE_WALK)
-		wishvel[2] = cmd.upmove;
-	else
-		wishvel[2] = 0;
-
-	VectorCopy (wishvel, wishdir);
-	wishspeed = VectorNormalize(wishdir);
-	if (wishspeed > sv_maxspeed.value)
-	{
-		VectorScale (wishvel, sv_maxspeed.value/wishspeed, wishvel);
-		wishspeed = sv_maxspeed.value;
-	}
-
-	if ( sv_player->v.movetype == MOVETYPE_NOCLIP)
-	{	// noclip
-		VectorCopy (wishvel, velocity);
-	}
-	else if ( onground )
-	{
-		SV_UserFriction ();
-		SV_Accelerate (wishspeed, wishdir);
-	}
-	else
-	{	// not on ground, so little effect on velocity
-		SV_AirAccelerate (wishspeed, wishvel);
-	}
-}
-
 /*
 ===================
 SV_ClientThink
@@ -380,13 +195,11 @@ the angle fields specify an exact angular motion in degrees
 void SV_ClientThink (void)
 {
 	vec3_t		v_angle;
+	pmove_t		pm;
 
 	if (sv_player->v.movetype == MOVETYPE_NONE)
 		return;
 
-	onground = (int)sv_player->v.flags & FL_ONGROUND;
-
-	origin = sv_player->v.origin;
 	velocity = sv_player->v.velocity;
 
 	DropPunchAngle ();
@@ -422,10 +235,15 @@ void SV_ClientThink (void)
 	//johnfitz -- alternate noclip
 	if (sv_player->v.movetype == MOVETYPE_NOCLIP && sv_altnoclip.value)
 		SV_NoclipMove ();
-	else if (sv_player->v.waterlevel >= 2 && sv_player->v.movetype != MOVETYPE_NOCLIP)
-		SV_WaterMove ();
 	else
-		SV_AirMove ();
+	{
+		SV_InitPmove (&pm, sv_player);
+		pm.cmd = cmd;
+		if (sv_player->v.waterlevel >= 2 && sv_player->v.movetype != MOVETYPE_NOCLIP)
+			PM_WaterMove (&pm);
+		else
+			PM_AirMove (&pm);
+	}
 	//johnfitz
 }
 
@@ -470,6 +288,8 @@ void SV_ReadClientMove (usercmd_t *move)
 	i = MSG_ReadByte ();
 	if (i)
 		host_client->edict->v.impulse = i;
+
+	SV_RecordClientMove (host_client - svs.clients, angle, move, bits, i);
 }
 
 /*
@@ -483,6 +303,7 @@ qboolean SV_ReadClientMessage (void)
 {
 	int		ret;
 	int		ccmd;
+	int		ack;
 	const char	*s;
 
 	do
@@ -527,6 +348,7 @@ nextmsg:
 
 			case clc_stringcmd:
 				s = MSG_ReadString ();
+				SV_RecordClientCommand (host_client - svs.clients, s);
 				if (q_strncasecmp(s, "spawn", 5) && q_strncasecmp(s, "begin", 5) && q_strncasecmp(s, "prespawn", 8) && qcvm->extfuncs.SV_ParseClientCommand)
 				{	//the spawn/begin/prespawn are because of numerous mods that disobey the rules.
 					//at a minimum, we must be able to join the server, so that we can see any sprints/bprints (because dprint sucks, yes there's proper ways to deal with this, but moders don't always know them).
@@ -602,6 +424,30 @@ nextmsg:
 			case clc_move:
 				SV_ReadClientMove (&host_client->cmd);
 				break;
+
+			case clc_ackframe:
+				ack = MSG_ReadLong ();
+				if (sv.protocolflags & PRFL_DELTAFRAMES)
+				{
+					host_client->deltaframes = true;
+					if (ack >= 0 && ack <= host_client->deltasequence)
+						host_client->deltaack = ack;
+				}
+				break;
+
+			case clc_moveseq:
+				ack = MSG_ReadLong ();
+				if (sv.protocolflags & PRFL_MOVESEQ)
+				{
+					host_client->moveseqs = true;
+					host_client->moveseq = ack;
+				}
+				break;
+
+			case clc_deflate:
+				if (sv.protocolflags & PRFL_DEFLATE)
+					host_client->deflate = true;
+				break;
 			}
 		}
 	} while (ret == 1);
@@ -610,6 +456,49 @@ nextmsg:
 }
 
 
+/*
+==================
+SV_ReadClient
+
+Reads the messages of host_client, returns false if it was dropped
+==================
+*/
+static qboolean SV_ReadClient (void)
+{
+	sv_player = host_client->edict;
+
+	if (!SV_ReadClientMessage ())
+	{
+		SV_RecordClientDrop (host_client - svs.clients);
+		SV_DropClient (false);	// client misbehaved...
+		return false;
+	}
+
+	return true;
+}
+
+/*
+==================
+SV_ReadClients
+
+Reads what the clients sent without running their moves, for a dedicated
+server woken up between ticks.  The last move of each client is run by the
+next SV_RunClients.
+==================
+*/
+void SV_ReadClients (void)
+{
+	int				i;
+
+	SV_CheckForNewClients ();
+	if (svs.hibernating)
+		return;
+
+	for (i=0, host_client = svs.clients ; i<svs.maxclients ; i++, host_client++)
+		if (host_client->active)
+			SV_ReadClient ();
+}
+
 /*
 ==================
 SV_RunClients
@@ -624,13 +513,8 @@ void SV_RunClients (void)
 		if (!host_client->active)
 			continue;
 
-		sv_player = host_client->edict;
-
-		if (!SV_ReadClientMessage ())
-		{
-			SV_DropClient (false);	// client misbehaved...
+		if (!SV_ReadClient ())
 			continue;
-		}
 
 		if (!host_client->spawned)
 		{
@@ -121,6 +121,12 @@ const char *Sys_ConsoleInput (void);
 void Sys_Sleep (unsigned long msecs);
 // yield for about 'msecs' milliseconds.
 
+#ifndef _WIN32
+qboolean Sys_WaitForInput (const int *fds, int numfds, double endtime);
+// blocks until one of fds or the console is readable or Sys_DoubleTime
+// reaches endtime, returns false if it couldn't wait
+#endif
+
 void Sys_SendKeyEvents (void);
 // Perform Key_Event () callbacks until the input que is empty
 
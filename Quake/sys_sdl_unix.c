@@ -37,6 +37,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <time.h>
 #include <dirent.h>
 #include <pwd.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
 
 #if defined(SDL_FRAMEWORK) || defined(NO_SDL_CONFIG)
 #if defined(USE_SDL2)
@@ -54,6 +58,7 @@ qboolean		isDedicated;
 #define	MAX_HANDLES		32	/* johnfitz -- was 10 */
 static FILE		*sys_handles[MAX_HANDLES];
 static qboolean		stdinIsATTY;	/* from ioquake3 source */
+static qboolean		stdinEOF;
 
 static double rcp_counter_freq;
 
@@ -775,14 +780,13 @@ double Sys_DoubleTime (void)
 
 const char *Sys_ConsoleInput (void)
 {
-	static qboolean	con_eof = false;
 	static char	con_text[256];
 	static int	textlen;
 	char		c;
 	fd_set		set;
 	struct timeval	timeout;
 
-	if (!stdinIsATTY || con_eof)
+	if (!stdinIsATTY || stdinEOF)
 		return NULL;
 
 	FD_ZERO (&set);
@@ -796,7 +800,7 @@ const char *Sys_ConsoleInput (void)
 		{
 			// Finish processing whatever is already in the
 			// buffer (if anything), then stop reading
-			con_eof = true;
+			stdinEOF = true;
 			c = '\n';
 		}
 		if (c == '\n' || c == '\r')
@@ -831,6 +835,79 @@ const char *Sys_ConsoleInput (void)
 	return NULL;
 }
 
+#define MAX_WAIT_FDS	64
+
+/*
+================
+Sys_WaitForInput
+
+On Linux the deadline is kept by a timerfd polled along with the other
+descriptors, elsewhere poll's own millisecond timeout is used
+================
+*/
+qboolean Sys_WaitForInput (const int *fds, int numfds, double endtime)
+{
+	struct pollfd	pfd[MAX_WAIT_FDS + 2];
+	int				i, n, timeout;
+	double			wait;
+#ifdef __linux__
+	static int			timerfd = -2;
+	struct itimerspec	spec;
+	uint64_t			expirations;
+#endif
+
+	if (numfds > MAX_WAIT_FDS)
+		return false;
+
+	wait = endtime - Sys_DoubleTime ();
+	if (wait <= 0.0)
+		return true;
+
+	for (n = 0; n < numfds; n++)
+	{
+		pfd[n].fd = fds[n];
+		pfd[n].events = POLLIN;
+	}
+	if (stdinIsATTY && !stdinEOF)
+	{
+		pfd[n].fd = STDIN_FILENO;
+		pfd[n++].events = POLLIN;
+	}
+
+	timeout = (int) ceil (wait * 1000.0);
+#ifdef __linux__
+	if (timerfd == -2)
+		timerfd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (timerfd >= 0)
+	{
+		memset (&spec, 0, sizeof (spec));
+		spec.it_value.tv_sec = (time_t) wait;
+		spec.it_value.tv_nsec = (long) ((wait - (double) spec.it_value.tv_sec) * 1e9);
+		if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec)
+			spec.it_value.tv_nsec = 1;
+		if (timerfd_settime (timerfd, 0, &spec, NULL) == 0)
+		{
+			pfd[n].fd = timerfd;
+			pfd[n++].events = POLLIN;
+			timeout = -1;
+		}
+	}
+#endif
+
+	for (i = 0; i < n; i++)
+		pfd[i].revents = 0;
+	if (poll (pfd, n, timeout) < 0 && errno != EINTR)
+		return false;
+
+#ifdef __linux__
+	// drain the timer, it stays readable once expired
+	if (timeout == -1 && read (timerfd, &expirations, sizeof (expirations)) != sizeof (expirations))
+		expirations = 0;
+#endif
+
+	return true;
+}
+
 void Sys_Sleep (unsigned long msecs)
 {
 /*	usleep (msecs * 1000);*/
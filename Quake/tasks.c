@@ -0,0 +1,196 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+// tasks.c -- worker thread pool
+//
+// A fixed set of worker threads sleeps until Tasks_ParallelFor publishes a
+// job, then all of them (and the main thread) pull indices off a shared
+// atomic counter until the range is exhausted.  Only one job runs at a time
+// and only the main thread may start one.
+
+#include "quakedef.h"
+
+static SDL_Thread	*task_threads[MAX_TASK_WORKERS];
+static int			task_numworkers = 1;
+static SDL_mutex	*task_mutex;
+static SDL_cond		*task_wake;
+static SDL_cond		*task_done;
+
+static struct
+{
+	taskfunc_t		func;
+	void			*param;
+	int				count;
+	SDL_atomic_t	next;
+	int				generation;		// bumped for every job
+	int				busy;			// workers that haven't finished the current job
+	qboolean		quit;
+} task_job;
+
+/*
+==================
+Tasks_RunJob
+==================
+*/
+static void Tasks_RunJob (int worker)
+{
+	int		i;
+
+	while ((i = SDL_AtomicAdd (&task_job.next, 1)) < task_job.count)
+		task_job.func (i, worker, task_job.param);
+}
+
+/*
+==================
+Tasks_WorkerThread
+==================
+*/
+static int SDLCALL Tasks_WorkerThread (void *data)
+{
+	int		worker = (int)(intptr_t) data;
+	int		generation = 0;
+
+	SDL_LockMutex (task_mutex);
+	while (1)
+	{
+		while (!task_job.quit && task_job.generation == generation)
+			SDL_CondWait (task_wake, task_mutex);
+		if (task_job.quit)
+			break;
+		generation = task_job.generation;
+		SDL_UnlockMutex (task_mutex);
+
+		Tasks_RunJob (worker);
+
+		SDL_LockMutex (task_mutex);
+		if (--task_job.busy == 0)
+			SDL_CondSignal (task_done);
+	}
+	SDL_UnlockMutex (task_mutex);
+
+	return 0;
+}
+
+/*
+==================
+Tasks_Init
+
+Starts one worker per additional logical CPU, or as many as -threads asks for
+==================
+*/
+void Tasks_Init (void)
+{
+	int		i, count;
+
+	count = SDL_GetCPUCount ();
+	i = COM_CheckParm ("-threads");
+	if (i && i < com_argc - 1)
+		count = Q_atoi (com_argv[i + 1]);
+	count = CLAMP (1, count, MAX_TASK_WORKERS);
+
+	task_mutex = SDL_CreateMutex ();
+	task_wake = SDL_CreateCond ();
+	task_done = SDL_CreateCond ();
+	if (!task_mutex || !task_wake || !task_done)
+		Sys_Error ("Tasks_Init: could not create synchronization objects");
+
+	for (task_numworkers = 1; task_numworkers < count; task_numworkers++)
+	{
+		task_threads[task_numworkers] = SDL_CreateThread (Tasks_WorkerThread, "Worker", (void *)(intptr_t) task_numworkers);
+		if (!task_threads[task_numworkers])
+		{
+			Con_Printf ("Tasks_Init: could not create worker thread: %s\n", SDL_GetError ());
+			break;
+		}
+	}
+
+	Con_Printf ("Using %d worker thread%s\n", task_numworkers - 1, task_numworkers == 2 ? "" : "s");
+}
+
+/*
+==================
+Tasks_Shutdown
+==================
+*/
+void Tasks_Shutdown (void)
+{
+	int		i;
+
+	if (!task_mutex)
+		return;
+
+	SDL_LockMutex (task_mutex);
+	task_job.quit = true;
+	SDL_CondBroadcast (task_wake);
+	SDL_UnlockMutex (task_mutex);
+
+	for (i = 1; i < task_numworkers; i++)
+	{
+		SDL_WaitThread (task_threads[i], NULL);
+		task_threads[i] = NULL;
+	}
+	task_numworkers = 1;
+}
+
+/*
+==================
+Tasks_NumWorkers
+==================
+*/
+int Tasks_NumWorkers (void)
+{
+	return task_numworkers;
+}
+
+/*
+==================
+Tasks_ParallelFor
+==================
+*/
+void Tasks_ParallelFor (int count, taskfunc_t func, void *param)
+{
+	int		i;
+
+	if (count <= 0)
+		return;
+
+	if (task_numworkers == 1 || count == 1)
+	{
+		for (i = 0; i < count; i++)
+			func (i, 0, param);
+		return;
+	}
+
+	SDL_LockMutex (task_mutex);
+	task_job.func = func;
+	task_job.param = param;
+	task_job.count = count;
+	SDL_AtomicSet (&task_job.next, 0);
+	task_job.busy = task_numworkers - 1;
+	task_job.generation++;
+	SDL_CondBroadcast (task_wake);
+	SDL_UnlockMutex (task_mutex);
+
+	Tasks_RunJob (0);
+
+	SDL_LockMutex (task_mutex);
+	while (task_job.busy)
+		SDL_CondWait (task_done, task_mutex);
+	SDL_UnlockMutex (task_mutex);
+}
@@ -0,0 +1,39 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _QUAKE_TASKS_H
+#define _QUAKE_TASKS_H
+
+// tasks.h -- worker thread pool
+
+#define MAX_TASK_WORKERS	32	// including the main thread
+
+typedef void (*taskfunc_t) (int index, int worker, void *param);
+
+void Tasks_Init (void);
+void Tasks_Shutdown (void);
+
+// number of threads that can run a job, including the main thread
+int Tasks_NumWorkers (void);
+
+// calls func for every index in [0, count) and returns when all calls
+// are done; worker is in [0, Tasks_NumWorkers ()), 0 being the main thread
+void Tasks_ParallelFor (int count, taskfunc_t func, void *param);
+
+#endif	/* _QUAKE_TASKS_H */
@@ -0,0 +1,446 @@
+/*
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// vid_null.c -- video, renderer and 2d interface for builds without a GPU
+//
+// Server-only builds link this instead of the SDL window code, the GL
+// renderer, the menus and the status bar.  A dedicated server never opens a
+// window, so the functions here only have to satisfy the client code that
+// is still linked in.  Cvars that the server or the model loader read keep
+// the defaults of the real definitions, since a normal build running with
+// -dedicated never registers them either.
+
+#include "quakedef.h"
+
+viddef_t	vid;
+qboolean	scr_skipupdate;
+qboolean	scr_disabled_for_loading;
+int			clearnotify;
+int			scr_tileclear_updates;
+float		scr_centertime_off;
+int			glx, gly, glwidth, glheight;
+
+refdef_t	r_refdef;
+vec3_t		r_origin, vpn, vright, vup;
+qboolean	use_simd;
+qboolean	use_avx2;
+
+unsigned int	d_8to24table[256];
+uint32_t		is_fullbright[256/32];
+qpic_t			*pic_ovr, *pic_ins;
+
+int			fragsort[MAX_SCOREBOARD];
+int			scoreboardlines;
+
+enum m_state_e	m_state;
+enum m_state_e	m_return_state;
+qboolean		m_return_onerror;
+char			m_return_reason [32];
+
+cvar_t	scr_viewsize = {"viewsize","100", CVAR_ARCHIVE};
+cvar_t	r_novis = {"r_novis","0",CVAR_ARCHIVE};
+cvar_t	r_lerpmodels = {"r_lerpmodels", "1", CVAR_ARCHIVE};
+cvar_t	r_lerpmove = {"r_lerpmove", "1", CVAR_ARCHIVE};
+cvar_t	r_nolerp_list = {"r_nolerp_list", "progs/flame.mdl,progs/flame2.mdl,progs/braztall.mdl,progs/brazshrt.mdl,progs/longtrch.mdl,progs/flame_pyre.mdl,progs/v_saw.mdl,progs/v_xfist.mdl,progs/h2stuff/newfire.mdl", CVAR_NONE};
+cvar_t	r_noshadow_list = {"r_noshadow_list", "progs/flame2.mdl,progs/flame.mdl,progs/bolt1.mdl,progs/bolt2.mdl,progs/bolt3.mdl,progs/laser.mdl", CVAR_NONE};
+
+/*
+==============================================================================
+
+VIDEO
+
+==============================================================================
+*/
+
+void VID_Init (void)
+{
+	Sys_Error ("VID_Init: this build has no video, run it with -dedicated");
+}
+
+void VID_Shutdown (void)
+{
+}
+
+void VID_Toggle (void)
+{
+}
+
+void *VID_GetWindow (void)
+{
+	return NULL;
+}
+
+qboolean VID_HasMouseOrInputFocus (void)
+{
+	return false;
+}
+
+qboolean VID_IsMinimized (void)
+{
+	return false;
+}
+
+void VID_Lock (void)
+{
+}
+
+void VID_SetWindowTitle (const char *title)
+{
+}
+
+void VID_SetMouseCursor (mousecursor_t cursor)
+{
+}
+
+/*
+==============================================================================
+
+RENDERER
+
+==============================================================================
+*/
+
+void R_Init (void)
+{
+}
+
+void R_NewGame (void)
+{
+}
+
+void R_NewMap (void)
+{
+}
+
+void R_RenderView (void)
+{
+}
+
+void V_PolyBlend (void)
+{
+}
+
+void R_CheckEfrags (void)
+{
+}
+
+void R_AddEfrags (entity_t *ent)
+{
+}
+
+void R_TranslatePlayerSkin (int playernum)
+{
+}
+
+void R_TranslateNewPlayerSkin (int playernum)
+{
+}
+
+void D_FlushCaches (void)
+{
+}
+
+void Fog_ParseServerMessage (void)
+{
+	MSG_ReadByte ();	// density
+	MSG_ReadByte ();	// red
+	MSG_ReadByte ();	// green
+	MSG_ReadByte ();	// blue
+	MSG_ReadShort ();	// time
+}
+
+void Sky_ClearAll (void)
+{
+}
+
+void Sky_LoadSkyBox (const char *name)
+{
+}
+
+void Sky_LoadTexture (qmodel_t *m, texture_t *mt)
+{
+}
+
+void Sky_LoadTextureQ64 (qmodel_t *m, texture_t *mt)
+{
+}
+
+void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *hdr)
+{
+}
+
+void GLMesh_DeleteVertexBuffers (void)
+{
+}
+
+void TexMgr_Init (void)
+{
+}
+
+void TexMgr_NewGame (void)
+{
+}
+
+void TexMgr_FreeTexturesForOwner (qmodel_t *owner)
+{
+}
+
+gltexture_t *TexMgr_LoadImage (qmodel_t *owner, const char *name, int width, int height, enum srcformat format,
+			       byte *data, const char *source_file, src_offset_t source_offset, unsigned flags)
+{
+	return NULL;
+}
+
+int TexMgr_PadConditional (int s)
+{
+	return s;
+}
+
+byte *Image_LoadImage (const char *name, int *width, int *height)
+{
+	return NULL;
+}
+
+/*
+==============================================================================
+
+PARTICLES
+
+==============================================================================
+*/
+
+void R_ClearParticles (void)
+{
+}
+
+void R_ParseParticleEffect (void)
+{
+	int		i;
+
+	for (i = 0; i < 3; i++)
+		MSG_ReadCoord (cl.protocolflags);	// origin
+	for (i = 0; i < 3; i++)
+		MSG_ReadChar ();					// direction
+	MSG_ReadByte ();						// count
+	MSG_ReadByte ();						// color
+}
+
+void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
+{
+}
+
+void R_RocketTrail (vec3_t start, vec3_t end, int type)
+{
+}
+
+void R_EntityParticles (entity_t *ent)
+{
+}
+
+void R_BlobExplosion (vec3_t org)
+{
+}
+
+void R_ParticleExplosion (vec3_t org)
+{
+}
+
+void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
+{
+}
+
+void R_LavaSplash (vec3_t org)
+{
+}
+
+void R_TeleportSplash (vec3_t org)
+{
+}
+
+void CL_RunParticles (void)
+{
+}
+
+/*
+==============================================================================
+
+SCREEN AND 2D DRAWING
+
+==============================================================================
+*/
+
+void SCR_Init (void)
+{
+}
+
+void SCR_UpdateScreen (void)
+{
+}
+
+void SCR_UpdateZoom (void)
+{
+}
+
+void SCR_CenterPrint (const char *str)
+{
+}
+
+void SCR_BeginLoadingPlaque (void)
+{
+}
+
+void SCR_EndLoadingPlaque (void)
+{
+}
+
+int SCR_ModalMessage (const char *text, float timeout)
+{
+	return true;
+}
+
+void Draw_Init (void)
+{
+}
+
+void Draw_NewGame (void)
+{
+}
+
+qpic_t *Draw_PicFromWad2 (const char *name, unsigned int texflags)
+{
+	return NULL;
+}
+
+qpic_t *Draw_TryCachePic (const char *path, unsigned int texflags)
+{
+	return NULL;
+}
+
+void Draw_Character (int x, int y, int num)
+{
+}
+
+void Draw_CharacterEx (float x, float y, float dimx, float dimy, int num)
+{
+}
+
+void Draw_String (int x, int y, const char *str)
+{
+}
+
+void Draw_Pic (int x, int y, qpic_t *pic)
+{
+}
+
+void Draw_SubPic (float x, float y, float w, float h, qpic_t *pic, float s1, float t1, float s2, float t2, const float *rgb, float alpha)
+{
+}
+
+void Draw_ConsoleBackground (void)
+{
+}
+
+void Draw_Fill (int x, int y, int w, int h, int c, float alpha)
+{
+}
+
+void Draw_FillEx (float x, float y, float w, float h, const float *rgb, float alpha)
+{
+}
+
+void Draw_SetClipRect (float x, float y, float width, float height)
+{
+}
+
+void Draw_ResetClipping (void)
+{
+}
+
+void Draw_GetCanvasTransform (canvastype canvas, drawtransform_t *transform)
+{
+	memset (transform, 0, sizeof (*transform));
+}
+
+void GL_SetCanvas (canvastype newcanvas)
+{
+}
+
+void GL_SetCanvasColor (float r, float g, float b, float a)
+{
+}
+
+/*
+==============================================================================
+
+MENUS AND STATUS BAR
+
+==============================================================================
+*/
+
+void M_Init (void)
+{
+}
+
+void M_CheckMods (void)
+{
+}
+
+void M_RefreshMods (void)
+{
+}
+
+void M_OnModInstall (const char *name)
+{
+}
+
+void M_Keydown (int key)
+{
+}
+
+void M_Charinput (int key)
+{
+}
+
+enum textmode_t M_TextEntry (void)
+{
+	return TEXTMODE_OFF;
+}
+
+void M_ToggleMenu_f (void)
+{
+}
+
+void M_Menu_Main_f (void)
+{
+}
+
+void M_Menu_Quit_f (void)
+{
+}
+
+void M_PrintWhite (int cx, int cy, const char *str)
+{
+}
+
+void Sbar_Init (void)
+{
+}
+
+void Sbar_Changed (void)
+{
+}
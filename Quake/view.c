@@ -538,48 +538,6 @@ void V_UpdateBlend (void)
 		V_CalcBlend ();
 }
 
-/*
-============
-V_PolyBlend -- johnfitz -- moved here from gl_rmain.c
-============
-*/
-void V_PolyBlend (void)
-{
-	if (!gl_polyblend.value || !v_blend[3])
-		return;
-
-	if (softemu)
-	{
-		// If softemu is active then it's generally best to perform color shifting through
-		// palette remapping, which is consistent with the old software renderers, and also
-		// avoids palettization artifacts (e.g. underwater).
-
-		// However, a black v_cshift is sometimes used as a background for centerprint text
-		// to make it easier to read (e.g. books in Arcane Dimensions). Applying the effect
-		// at the end of the frame would defeat its purpose (and make the UI harder to use),
-		// so we detect this case and apply the effect here.
-		int maxcolor = q_max (cshift_empty.destcolor[0], q_max (cshift_empty.destcolor[1], cshift_empty.destcolor[2]));
-		if (!cshift_empty.percent || maxcolor > 0)
-			return;
-	}
-	else
-	{
-		// If we're already rendering to an intermediate FBO (for warp/scale/MSAA)
-		// then we can apply the color blending when blitting the intermediate texture
-		// (to save the memory bandwidth an extra full-screen alpha blend would consume)
-		if (GL_NeedsSceneEffects ())
-			return;
-	}
-
-	GL_UseProgram (glprogs.viewblend);
-	GL_SetState (GLS_BLEND_ALPHA | GLS_NO_ZTEST | GLS_NO_ZWRITE | GLS_CULL_NONE | GLS_ATTRIBS(0));
-	GL_Uniform4fvFunc (0, 1, v_blend);
-
-	glDrawArrays (GL_TRIANGLES, 0, 3);
-
-	v_blend[3] = 0.f; // make sure this doesn't get applied again later in the pipeline
-}
-
 /*
 ==============================================================================
 
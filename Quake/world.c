@@ -32,6 +32,7 @@ line of sight checks trace->crosscontent, but bullets don't
 
 */
 
+cvar_t	sv_fastrelink = {"sv_fastrelink","0",CVAR_NONE};	// skip relinking entities whose bounds did not change.  They keep their place in the area node lists instead of moving to the head, which changes the order touch functions run in
 
 typedef struct
 {
@@ -50,6 +51,199 @@ int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
 /*
 ===============================================================================
 
+LEAF INDEX
+
+Every leaf keeps a list of the edicts whose leafnums contain it, so that the
+edicts touching a pvs can be found without looking at all of them.  Entries
+are never removed: SV_LinkEdict stamps the edict and its new entries with a
+fresh number, older entries of the edict become stale and are dropped when
+their list has to grow.  Edicts with more leafs than MAX_ENT_LEAFS are
+also kept in a separate list, because the pvs may only reach them through
+a leaf that did not fit into leafnums.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	int				edictnum;
+	unsigned int	stamp;
+} leafent_t;
+
+typedef struct
+{
+	leafent_t	*ents;
+	int			count;
+	int			capacity;
+} leafents_t;
+
+static leafents_t	*sv_leafents;			// one list per leaf, indexed like leafnums
+static int			sv_leafents_capacity;
+static leafents_t	sv_overflowents;		// edicts with num_leafs == MAX_ENT_LEAFS
+static unsigned int	sv_leafstamp;			// wraps around, only compared for equality
+
+static edictmarks_t	sv_edictmarks;			// used when the caller doesn't pass its own
+
+/*
+===============
+SV_ClearLeafIndex
+===============
+*/
+static void SV_ClearLeafIndex (void)
+{
+	int		i, numleafs;
+
+	numleafs = sv.worldmodel->numleafs;
+	if (numleafs > sv_leafents_capacity)
+	{
+		sv_leafents = (leafents_t *) realloc (sv_leafents, numleafs * sizeof (leafents_t));
+		if (!sv_leafents)
+			Sys_Error ("SV_ClearLeafIndex: realloc() failed on %d leafs", numleafs);
+		memset (sv_leafents + sv_leafents_capacity, 0, (numleafs - sv_leafents_capacity) * sizeof (leafents_t));
+		sv_leafents_capacity = numleafs;
+	}
+
+	for (i = 0; i < sv_leafents_capacity; i++)
+		sv_leafents[i].count = 0;
+	sv_overflowents.count = 0;
+	sv_leafstamp = 0;
+}
+
+/*
+===============
+SV_AddLeafEnt
+===============
+*/
+static void SV_AddLeafEnt (leafents_t *list, int edictnum, unsigned int stamp)
+{
+	int			i, j;
+	leafent_t	*e;
+
+	if (list->count == list->capacity)
+	{
+		// drop stale entries first
+		for (i = j = 0; i < list->count; i++)
+		{
+			e = &list->ents[i];
+			if (e->edictnum < qcvm->num_edicts && EDICT_NUM (e->edictnum)->leafstamp == e->stamp)
+				list->ents[j++] = *e;
+		}
+		list->count = j;
+
+		if (list->count > list->capacity / 2)
+		{
+			list->capacity = q_max (list->capacity * 2, 4);
+			list->ents = (leafent_t *) realloc (list->ents, list->capacity * sizeof (leafent_t));
+			if (!list->ents)
+				Sys_Error ("SV_AddLeafEnt: realloc() failed on %d entries", list->capacity);
+		}
+	}
+
+	e = &list->ents[list->count++];
+	e->edictnum = edictnum;
+	e->stamp = stamp;
+}
+
+/*
+===============
+SV_IndexEdictLeafs
+
+Called by SV_LinkEdict after leafnums have been rebuilt
+===============
+*/
+static void SV_IndexEdictLeafs (edict_t *ent)
+{
+	int		i, num;
+
+	ent->leafstamp = ++sv_leafstamp;
+	if (!ent->num_leafs)
+		return;
+
+	num = NUM_FOR_EDICT (ent);
+	for (i = 0; i < ent->num_leafs; i++)
+		SV_AddLeafEnt (&sv_leafents[ent->leafnums[i]], num, ent->leafstamp);
+	if (ent->num_leafs == MAX_ENT_LEAFS)
+		SV_AddLeafEnt (&sv_overflowents, num, ent->leafstamp);
+}
+
+/*
+===============
+SV_GatherLeafEnts
+===============
+*/
+static void SV_GatherLeafEnts (const leafents_t *list, edictmarks_t *marks, int *edicts, int *count)
+{
+	int				i, num;
+	const leafent_t	*e;
+
+	for (i = 0, e = list->ents; i < list->count; i++, e++)
+	{
+		num = e->edictnum;
+		if (num >= qcvm->num_edicts || marks->marks[num] == marks->gen)
+			continue;
+		if (EDICT_NUM (num)->leafstamp != e->stamp)
+			continue;	// stale
+		marks->marks[num] = marks->gen;
+		edicts[(*count)++] = num;
+	}
+}
+
+static int SV_CompareEdictNums (const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+===============
+SV_FindPVSEdicts
+
+Fills edicts with the numbers of all edicts that may touch the pvs, in
+ascending order.  The list is a superset: callers still have to test the
+edicts themselves.  edicts must have room for qcvm->num_edicts entries.
+Callers running concurrently must each pass their own marks.
+===============
+*/
+int SV_FindPVSEdicts (byte *pvs, int *edicts, edictmarks_t *marks)
+{
+	int		i, bit, bytes, count;
+	byte	bits;
+
+	if (!marks)
+		marks = &sv_edictmarks;
+	if (qcvm->max_edicts > marks->capacity)
+	{
+		marks->marks = (int *) realloc (marks->marks, qcvm->max_edicts * sizeof (int));
+		if (!marks->marks)
+			Sys_Error ("SV_FindPVSEdicts: realloc() failed on %d edicts", qcvm->max_edicts);
+		memset (marks->marks, 0, qcvm->max_edicts * sizeof (int));
+		marks->capacity = qcvm->max_edicts;
+		marks->gen = 0;
+	}
+	if (++marks->gen == 0)
+	{
+		memset (marks->marks, 0, marks->capacity * sizeof (int));
+		marks->gen = 1;
+	}
+
+	count = 0;
+	bytes = (sv.worldmodel->numleafs + 7) >> 3;
+	for (i = 0; i < bytes; i++)
+	{
+		bits = pvs[i];
+		for (bit = i << 3; bits; bits >>= 1, bit++)
+			if ((bits & 1) && bit < sv.worldmodel->numleafs)
+				SV_GatherLeafEnts (&sv_leafents[bit], marks, edicts, &count);
+	}
+	SV_GatherLeafEnts (&sv_overflowents, marks, edicts, &count);
+
+	qsort (edicts, count, sizeof (edicts[0]), SV_CompareEdictNums);
+
+	return count;
+}
+
+/*
+===============================================================================
+
 HULL BOXES
 
 ===============================================================================
@@ -257,6 +451,8 @@ void SV_ClearWorld (void)
 	memset (sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+
+	SV_ClearLeafIndex ();
 }
 
 
@@ -367,7 +563,9 @@ void SV_TouchLinks (edict_t *ent)
 		pr_global_struct->self = EDICT_TO_PROG(touch);
 		pr_global_struct->other = EDICT_TO_PROG(ent);
 		pr_global_struct->time = qcvm->time;
+		SV_ProfileEnter (SVPROF_TOUCH);
 		PR_ExecuteProgram (touch->v.touch);
+		SV_ProfileLeave ();
 
 		pr_global_struct->self = old_self;
 		pr_global_struct->other = old_other;
@@ -419,6 +617,34 @@ void SV_FindTouchedLeafs (edict_t *ent, mnode_t *node)
 		SV_FindTouchedLeafs (ent, node->children[1]);
 }
 
+/*
+===============
+SV_FindHeadNode
+
+Returns the index of the first node whose plane splits the entity's bounds.
+Used for PVS tests when the entity touches too many leafs to list them all.
+===============
+*/
+static int SV_FindHeadNode (edict_t *ent)
+{
+	mnode_t		*node;
+	int			sides;
+
+	node = sv.worldmodel->nodes;
+	while (node->contents >= 0)
+	{
+		sides = BOX_ON_PLANE_SIDE(ent->v.absmin, ent->v.absmax, node->plane);
+		if (sides == 1)
+			node = node->children[0];
+		else if (sides == 2)
+			node = node->children[1];
+		else
+			break;
+	}
+
+	return node - sv.worldmodel->nodes;
+}
+
 /*
 ===============
 SV_BoxInPVS
@@ -462,19 +688,20 @@ SV_LinkEdict
 void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t	*node;
+	vec3_t		absmin, absmax;
 
-	if (ent->area.prev)
-		SV_UnlinkEdict (ent);	// unlink from old position
-
-	if (ent == qcvm->edicts)
+	if (ent == qcvm->edicts || ent->free)
+	{
+		if (ent->area.prev)
+			SV_UnlinkEdict (ent);	// unlink from old position
 		return;		// don't add the world
+	}
 
-	if (ent->free)
-		return;
+	sv_prof.links++;
 
 // set the abs box
-	VectorAdd (ent->v.origin, ent->v.mins, ent->v.absmin);
-	VectorAdd (ent->v.origin, ent->v.maxs, ent->v.absmax);
+	VectorAdd (ent->v.origin, ent->v.mins, absmin);
+	VectorAdd (ent->v.origin, ent->v.maxs, absmax);
 
 //
 // to make items easier to pick up and allow them to be grabbed off
@@ -482,26 +709,58 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 //
 	if ((int)ent->v.flags & FL_ITEM)
 	{
-		ent->v.absmin[0] -= 15;
-		ent->v.absmin[1] -= 15;
-		ent->v.absmax[0] += 15;
-		ent->v.absmax[1] += 15;
+		absmin[0] -= 15;
+		absmin[1] -= 15;
+		absmax[0] += 15;
+		absmax[1] += 15;
 	}
 	else
 	{	// because movement is clipped an epsilon away from an actual edge,
 		// we must fully check even when bounding boxes don't quite touch
-		ent->v.absmin[0] -= 1;
-		ent->v.absmin[1] -= 1;
-		ent->v.absmin[2] -= 1;
-		ent->v.absmax[0] += 1;
-		ent->v.absmax[1] += 1;
-		ent->v.absmax[2] += 1;
+		absmin[0] -= 1;
+		absmin[1] -= 1;
+		absmin[2] -= 1;
+		absmax[0] += 1;
+		absmax[1] += 1;
+		absmax[2] += 1;
+	}
+
+	VectorCopy (absmin, ent->v.absmin);
+	VectorCopy (absmax, ent->v.absmax);
+
+// keep the current leafs and area node if nothing they depend on has changed
+	if (sv_fastrelink.value && ent->linkvalid
+		&& (ent->area.prev || ent->v.solid == SOLID_NOT)
+		&& ent->linksolid == ent->v.solid
+		&& ent->linkleafs == (ent->v.modelindex != 0)
+		&& VectorCompare (absmin, ent->linkmins)
+		&& VectorCompare (absmax, ent->linkmaxs))
+	{
+		dev_stats.relinks_skipped++;
+		if (touch_triggers && ent->v.solid != SOLID_NOT)
+			SV_TouchLinks (ent);
+		return;
 	}
 
+	if (ent->area.prev)
+		SV_UnlinkEdict (ent);	// unlink from old position
+
+	dev_stats.relinks++;
+	ent->linkvalid = true;
+	ent->linkleafs = (ent->v.modelindex != 0);
+	ent->linksolid = ent->v.solid;
+	VectorCopy (absmin, ent->linkmins);
+	VectorCopy (absmax, ent->linkmaxs);
+
 // link to PVS leafs
 	ent->num_leafs = 0;
 	if (ent->v.modelindex)
+	{
 		SV_FindTouchedLeafs (ent, sv.worldmodel->nodes);
+		if (ent->num_leafs == MAX_ENT_LEAFS)
+			ent->headnode = SV_FindHeadNode (ent);
+	}
+	SV_IndexEdictLeafs (ent);
 
 	if (ent->v.solid == SOLID_NOT)
 		return;
@@ -930,6 +1189,8 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 	moveclip_t	clip;
 	int			i;
 
+	sv_prof.traces++;
+
 	memset ( &clip, 0, sizeof ( moveclip_t ) );
 
 // clip to world
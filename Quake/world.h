@@ -60,8 +60,21 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+typedef struct edictmarks_s
+{
+	int		*marks;		// last gen an edict was gathered in
+	int		capacity;
+	int		gen;
+} edictmarks_t;
+
+int SV_FindPVSEdicts (byte *pvs, int *edicts, edictmarks_t *marks);
+// returns the edicts that may touch the pvs in ascending order, using the
+// leaf index kept up to date by SV_LinkEdict; marks may be NULL when
+// not called concurrently
+
 int SV_PointContents (vec3_t p);
 int SV_TruePointContents (vec3_t p);
+int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
 // does not check any entities at all
 // the non-true version remaps the water current contents to content_water
@@ -281,6 +281,22 @@ void Z_Print (memzone_t *zone)
 	}
 }
 
+/*
+========================
+Z_GetUsage
+========================
+*/
+void Z_GetUsage (int *used, int *size)
+{
+	memblock_t	*block;
+
+	*used = 0;
+	*size = mainzone->size;
+	for (block = mainzone->blocklist.next ; block != &mainzone->blocklist ; block = block->next)
+		if (block->tag)
+			*used += block->size;
+}
+
 
 //============================================================================
 
@@ -465,6 +481,17 @@ void *Hunk_Alloc (int size)
 	return Hunk_AllocName (size, "unknown");
 }
 
+/*
+===================
+Hunk_GetUsage
+===================
+*/
+void Hunk_GetUsage (int *used, int *size)
+{
+	*used = hunk_low_used + hunk_high_used;
+	*size = hunk_size;
+}
+
 int	Hunk_LowMark (void)
 {
 	return hunk_low_used;
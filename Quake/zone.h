@@ -117,6 +117,10 @@ void *Hunk_TempAlloc (int size);
 
 void Hunk_Check (void);
 
+void Hunk_GetUsage (int *used, int *size);
+void Z_GetUsage (int *used, int *size);
+// bytes allocated out of the hunk (both ends) and the zone
+
 typedef struct cache_user_s
 {
 	void	*data;